@@ -0,0 +1,200 @@
+/*
+	parallel_decode: decode one seekable file with several threads
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The file is scanned once to get a complete frame index. Then it is cut into
+	pieces at index points and each piece is decoded by its own handle in its
+	own thread. Every worker seeks to the first sample of its piece (the
+	MPG123_PREFRAMES before that are decoded and thrown away to fill the bit
+	reservoir and the filterbanks) and writes exactly the samples up to the
+	next piece into its place in the output file. Gapless trimming works as
+	for sequential decoding, so the result is the same raw PCM that
+	"mpg123 -s" would produce.
+
+	libmpg123 handles are independent of each other, that is all the threading
+	support needed from the library. Do not share one handle between threads.
+*/
+
+#define _FILE_OFFSET_BITS 64
+#define _XOPEN_SOURCE 500 /* pwrite() */
+#include <mpg123.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define MAX_THREADS 256
+/* The Layer III bit reservoir reaches back up to 511 bytes. At the lowest
+   bitrates, that is up to 9 frames, plus one to settle the filterbanks.
+   The default of 4 preframes is fine for seeking in a player, but here the
+   pieces shall be identical to sequential decoding. */
+#define PREFRAMES 10
+
+struct piece
+{
+	pthread_t thread;
+	const char *file;
+	int out;            /* output file descriptor, shared */
+	off_t *index;       /* frame index from the scan, shared and read-only */
+	off_t step;
+	size_t fill;
+	long rate;
+	int channels;
+	int encoding;
+	off_t begin;        /* first output sample of this piece */
+	off_t end;          /* one after the last sample, <0 for end of track */
+	int err;
+};
+
+static void *decode_piece(void *arg)
+{
+	struct piece *p = arg;
+	mpg123_handle *mh;
+	unsigned char buf[16384];
+	size_t done;
+	off_t pos, sample_bytes;
+	int ret = MPG123_OK;
+
+	p->err = 1;
+	mh = mpg123_new(NULL, &ret);
+	if(mh == NULL)
+	{
+		fprintf(stderr, "Worker cannot create handle: %s\n", mpg123_plain_strerror(ret));
+		return NULL;
+	}
+	mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0.);
+	mpg123_param(mh, MPG123_PREFRAMES, PREFRAMES, 0.);
+	mpg123_format_none(mh);
+	mpg123_format(mh, p->rate, p->channels, p->encoding);
+	if(  mpg123_open(mh, p->file) != MPG123_OK
+	  || mpg123_set_index(mh, p->index, p->step, p->fill) != MPG123_OK
+	  || mpg123_seek(mh, p->begin, SEEK_SET) != p->begin )
+	{
+		fprintf(stderr, "Worker cannot get to its start: %s\n", mpg123_strerror(mh));
+		mpg123_delete(mh);
+		return NULL;
+	}
+	sample_bytes = mpg123_encsize(p->encoding)*p->channels;
+	pos = p->begin*sample_bytes;
+	while(p->end < 0 || pos < p->end*sample_bytes)
+	{
+		size_t want = sizeof(buf) - sizeof(buf) % sample_bytes;
+		if(p->end >= 0 && (off_t)want > p->end*sample_bytes - pos)
+			want = p->end*sample_bytes - pos;
+		ret = mpg123_read(mh, buf, want, &done);
+		if(done && pwrite(p->out, buf, done, pos) != (ssize_t)done)
+		{
+			perror("Worker cannot write");
+			break;
+		}
+		pos += done;
+		if(ret == MPG123_DONE) break;
+		if(ret != MPG123_OK && ret != MPG123_NEW_FORMAT)
+		{
+			fprintf(stderr, "Worker decoding error: %s\n", mpg123_strerror(mh));
+			break;
+		}
+	}
+	if(p->end < 0 || pos == p->end*sample_bytes) p->err = 0;
+	else if(ret == MPG123_DONE)
+		fprintf(stderr, "Worker ended early, at sample %li instead of %li.\n"
+		,	(long)(pos/sample_bytes), (long)p->end);
+
+	mpg123_delete(mh);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	mpg123_handle *m;
+	struct piece pieces[MAX_THREADS];
+	off_t *index;
+	off_t step;
+	size_t fill;
+	long rate;
+	int channels, encoding;
+	int threads, i, out;
+	int ret = 0;
+
+	if(argc != 4 || (threads = atoi(argv[1])) < 1 || threads > MAX_THREADS)
+	{
+		fprintf(stderr, "\nI will decode an MPEG audio file to raw PCM using several threads.\n");
+		fprintf(stderr, "\nUsage: %s <threads> <mpeg audio file> <raw output file>\n\n", argv[0]);
+		return -1;
+	}
+	mpg123_init();
+	m = mpg123_new(NULL, NULL);
+	/* A full index with every frame makes the cuts cheap and exact. */
+	mpg123_param(m, MPG123_INDEX_SIZE, -1000, 0.);
+	if(  mpg123_open(m, argv[2]) != MPG123_OK
+	  || mpg123_scan(m) != MPG123_OK
+	  || mpg123_getformat(m, &rate, &channels, &encoding) != MPG123_OK
+	  || mpg123_index(m, &index, &step, &fill) != MPG123_OK )
+	{
+		fprintf(stderr, "Cannot prepare %s: %s\n", argv[2], mpg123_strerror(m));
+		mpg123_delete(m);
+		mpg123_exit();
+		return -1;
+	}
+	if((size_t)threads > fill) threads = fill ? (int)fill : 1;
+
+	/* Piece boundaries at index points, converted to output samples by seeking
+	   there once. That includes gapless and resampling offsets. */
+	for(i=0; i<threads; ++i)
+	{
+		size_t point = (size_t)i*fill/threads;
+		pieces[i].file  = argv[2];
+		pieces[i].index = index;
+		pieces[i].step  = step;
+		pieces[i].fill  = fill;
+		pieces[i].rate  = rate;
+		pieces[i].channels = channels;
+		pieces[i].encoding = encoding;
+		pieces[i].begin = i ? mpg123_seek_frame(m, (off_t)point*step, SEEK_SET) : 0;
+		if(pieces[i].begin >= 0 && i) pieces[i].begin = mpg123_tell(m);
+		if(pieces[i].begin < 0)
+		{
+			fprintf(stderr, "Cannot seek to frame %li: %s\n", (long)point*step, mpg123_strerror(m));
+			mpg123_delete(m);
+			mpg123_exit();
+			return -1;
+		}
+		if(i) pieces[i-1].end = pieces[i].begin;
+	}
+	pieces[threads-1].end = -1;
+
+	out = open(argv[3], O_WRONLY|O_CREAT|O_TRUNC, 0666);
+	if(out < 0)
+	{
+		perror("Cannot open output");
+		mpg123_delete(m);
+		mpg123_exit();
+		return -1;
+	}
+	fprintf(stderr, "Decoding %s with %i threads.\n", argv[2], threads);
+	for(i=0; i<threads; ++i)
+	{
+		pieces[i].out = out;
+		if(pthread_create(&pieces[i].thread, NULL, decode_piece, &pieces[i]))
+		{
+			fprintf(stderr, "Cannot create thread %i.\n", i);
+			pieces[i].err = 1;
+			pieces[i].thread = pthread_self();
+		}
+	}
+	for(i=0; i<threads; ++i)
+	{
+		if(!pthread_equal(pieces[i].thread, pthread_self()))
+			pthread_join(pieces[i].thread, NULL);
+		if(pieces[i].err) ret = -1;
+	}
+	close(out);
+
+	/* The index belongs to the scanning handle, that one goes last. */
+	mpg123_delete(m);
+	mpg123_exit();
+	return ret;
+}
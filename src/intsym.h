@@ -35,6 +35,8 @@
 #define synth_1to1_stereo_x86_64 INT123_synth_1to1_stereo_x86_64
 #define synth_1to1_avx INT123_synth_1to1_avx
 #define synth_1to1_stereo_avx INT123_synth_1to1_stereo_avx
+#define synth_1to1_avx512 INT123_synth_1to1_avx512
+#define synth_1to1_stereo_avx512 INT123_synth_1to1_stereo_avx512
 #define synth_1to1_arm INT123_synth_1to1_arm
 #define synth_1to1_neon INT123_synth_1to1_neon
 #define synth_1to1_stereo_neon INT123_synth_1to1_stereo_neon
@@ -56,6 +58,18 @@
 #define synth_ntom INT123_synth_ntom
 #define synth_ntom_mono INT123_synth_ntom_mono
 #define synth_ntom_m2s INT123_synth_ntom_m2s
+#define synth_2to1_x86_64 INT123_synth_2to1_x86_64
+#define synth_2to1_avx INT123_synth_2to1_avx
+#define synth_2to1_neon INT123_synth_2to1_neon
+#define synth_2to1_neon64 INT123_synth_2to1_neon64
+#define synth_4to1_x86_64 INT123_synth_4to1_x86_64
+#define synth_4to1_avx INT123_synth_4to1_avx
+#define synth_4to1_neon INT123_synth_4to1_neon
+#define synth_4to1_neon64 INT123_synth_4to1_neon64
+#define synth_ntom_x86_64 INT123_synth_ntom_x86_64
+#define synth_ntom_avx INT123_synth_ntom_avx
+#define synth_ntom_neon INT123_synth_ntom_neon
+#define synth_ntom_neon64 INT123_synth_ntom_neon64
 #define synth_1to1_8bit INT123_synth_1to1_8bit
 #define synth_1to1_8bit_i386 INT123_synth_1to1_8bit_i386
 #define synth_1to1_8bit_wrap INT123_synth_1to1_8bit_wrap
@@ -74,6 +88,18 @@
 #define synth_ntom_8bit INT123_synth_ntom_8bit
 #define synth_ntom_8bit_mono INT123_synth_ntom_8bit_mono
 #define synth_ntom_8bit_m2s INT123_synth_ntom_8bit_m2s
+#define synth_2to1_8bit_x86_64 INT123_synth_2to1_8bit_x86_64
+#define synth_2to1_8bit_avx INT123_synth_2to1_8bit_avx
+#define synth_2to1_8bit_neon INT123_synth_2to1_8bit_neon
+#define synth_2to1_8bit_neon64 INT123_synth_2to1_8bit_neon64
+#define synth_4to1_8bit_x86_64 INT123_synth_4to1_8bit_x86_64
+#define synth_4to1_8bit_avx INT123_synth_4to1_8bit_avx
+#define synth_4to1_8bit_neon INT123_synth_4to1_8bit_neon
+#define synth_4to1_8bit_neon64 INT123_synth_4to1_8bit_neon64
+#define synth_ntom_8bit_x86_64 INT123_synth_ntom_8bit_x86_64
+#define synth_ntom_8bit_avx INT123_synth_ntom_8bit_avx
+#define synth_ntom_8bit_neon INT123_synth_ntom_8bit_neon
+#define synth_ntom_8bit_neon64 INT123_synth_ntom_8bit_neon64
 #define synth_1to1_real INT123_synth_1to1_real
 #define synth_1to1_real_i386 INT123_synth_1to1_real_i386
 #define synth_1to1_real_sse INT123_synth_1to1_real_sse
@@ -82,6 +108,8 @@
 #define synth_1to1_real_stereo_x86_64 INT123_synth_1to1_real_stereo_x86_64
 #define synth_1to1_real_avx INT123_synth_1to1_real_avx
 #define synth_1to1_fltst_avx INT123_synth_1to1_fltst_avx
+#define synth_1to1_real_avx512 INT123_synth_1to1_real_avx512
+#define synth_1to1_fltst_avx512 INT123_synth_1to1_fltst_avx512
 #define synth_1to1_real_altivec INT123_synth_1to1_real_altivec
 #define synth_1to1_fltst_altivec INT123_synth_1to1_fltst_altivec
 #define synth_1to1_real_neon INT123_synth_1to1_real_neon
@@ -101,6 +129,18 @@
 #define synth_ntom_real INT123_synth_ntom_real
 #define synth_ntom_real_mono INT123_synth_ntom_real_mono
 #define synth_ntom_real_m2s INT123_synth_ntom_real_m2s
+#define synth_2to1_real_x86_64 INT123_synth_2to1_real_x86_64
+#define synth_2to1_real_avx INT123_synth_2to1_real_avx
+#define synth_2to1_real_neon INT123_synth_2to1_real_neon
+#define synth_2to1_real_neon64 INT123_synth_2to1_real_neon64
+#define synth_4to1_real_x86_64 INT123_synth_4to1_real_x86_64
+#define synth_4to1_real_avx INT123_synth_4to1_real_avx
+#define synth_4to1_real_neon INT123_synth_4to1_real_neon
+#define synth_4to1_real_neon64 INT123_synth_4to1_real_neon64
+#define synth_ntom_real_x86_64 INT123_synth_ntom_real_x86_64
+#define synth_ntom_real_avx INT123_synth_ntom_real_avx
+#define synth_ntom_real_neon INT123_synth_ntom_real_neon
+#define synth_ntom_real_neon64 INT123_synth_ntom_real_neon64
 #define synth_1to1_s32 INT123_synth_1to1_s32
 #define synth_1to1_s32_i386 INT123_synth_1to1_s32_i386
 #define synth_1to1_s32_sse INT123_synth_1to1_s32_sse
@@ -109,6 +149,8 @@
 #define synth_1to1_s32_stereo_x86_64 INT123_synth_1to1_s32_stereo_x86_64
 #define synth_1to1_s32_avx INT123_synth_1to1_s32_avx
 #define synth_1to1_s32_stereo_avx INT123_synth_1to1_s32_stereo_avx
+#define synth_1to1_s32_avx512 INT123_synth_1to1_s32_avx512
+#define synth_1to1_s32_stereo_avx512 INT123_synth_1to1_s32_stereo_avx512
 #define synth_1to1_s32_altivec INT123_synth_1to1_s32_altivec
 #define synth_1to1_s32_stereo_altivec INT123_synth_1to1_s32_stereo_altivec
 #define synth_1to1_s32_neon INT123_synth_1to1_s32_neon
@@ -128,6 +170,18 @@
 #define synth_ntom_s32 INT123_synth_ntom_s32
 #define synth_ntom_s32_mono INT123_synth_ntom_s32_mono
 #define synth_ntom_s32_m2s INT123_synth_ntom_s32_m2s
+#define synth_2to1_s32_x86_64 INT123_synth_2to1_s32_x86_64
+#define synth_2to1_s32_avx INT123_synth_2to1_s32_avx
+#define synth_2to1_s32_neon INT123_synth_2to1_s32_neon
+#define synth_2to1_s32_neon64 INT123_synth_2to1_s32_neon64
+#define synth_4to1_s32_x86_64 INT123_synth_4to1_s32_x86_64
+#define synth_4to1_s32_avx INT123_synth_4to1_s32_avx
+#define synth_4to1_s32_neon INT123_synth_4to1_s32_neon
+#define synth_4to1_s32_neon64 INT123_synth_4to1_s32_neon64
+#define synth_ntom_s32_x86_64 INT123_synth_ntom_s32_x86_64
+#define synth_ntom_s32_avx INT123_synth_ntom_s32_avx
+#define synth_ntom_s32_neon INT123_synth_ntom_s32_neon
+#define synth_ntom_s32_neon64 INT123_synth_ntom_s32_neon64
 #define dct64 INT123_dct64
 #define dct64_i386 INT123_dct64_i386
 #define dct64_altivec INT123_dct64_altivec
@@ -140,30 +194,74 @@
 #define dct36_avx INT123_dct36_avx
 #define dct36_neon INT123_dct36_neon
 #define dct36_neon64 INT123_dct36_neon64
+#define antialias INT123_antialias
+#define antialias_x86_64 INT123_antialias_x86_64
+#define antialias_avx INT123_antialias_avx
+#define antialias_neon64 INT123_antialias_neon64
+#define stereo_ms INT123_stereo_ms
+#define stereo_ms_x86_64 INT123_stereo_ms_x86_64
+#define stereo_ms_avx INT123_stereo_ms_avx
+#define stereo_ms_neon64 INT123_stereo_ms_neon64
+#define stereo_is INT123_stereo_is
+#define stereo_is_x86_64 INT123_stereo_is_x86_64
+#define stereo_is_avx INT123_stereo_is_avx
+#define stereo_is_neon64 INT123_stereo_is_neon64
+#define dct12_x86_64 INT123_dct12_x86_64
+#define dct12_neon64 INT123_dct12_neon64
+#define dequant_layer12 INT123_dequant_layer12
+#define dequant_layer12_x86_64 INT123_dequant_layer12_x86_64
+#define dequant_layer12_neon64 INT123_dequant_layer12_neon64
 #define synth_ntom_set_step INT123_synth_ntom_set_step
 #define ntom_val INT123_ntom_val
 #define ntom_frame_outsamples INT123_ntom_frame_outsamples
 #define ntom_frmouts INT123_ntom_frmouts
 #define ntom_ins2outs INT123_ntom_ins2outs
 #define ntom_frameoff INT123_ntom_frameoff
+#define resample_init INT123_resample_init
+#define resample_delay INT123_resample_delay
+#define resample_stereo INT123_resample_stereo
+#define resample_mono INT123_resample_mono
+#define resample_dot INT123_resample_dot
+#define resample_dot_x86_64 INT123_resample_dot_x86_64
+#define resample_dot_avx INT123_resample_dot_avx
+#define resample_dot_neon64 INT123_resample_dot_neon64
+#define peaks_setup INT123_peaks_setup
+#define peaks_reset INT123_peaks_reset
+#define peaks_exit INT123_peaks_exit
+#define peaks_frame INT123_peaks_frame
+#define peaks_flush INT123_peaks_flush
+#define peaks_pending INT123_peaks_pending
+#define peaks_reserve INT123_peaks_reserve
+#define peaks_stereo INT123_peaks_stereo
+#define peaks_mono INT123_peaks_mono
+#define loudness_reset INT123_loudness_reset
+#define loudness_clear INT123_loudness_clear
+#define loudness_exit INT123_loudness_exit
+#define loudness_buffer INT123_loudness_buffer
+#define loudness_integrated INT123_loudness_integrated
+#define silence_reset INT123_silence_reset
+#define silence_limit INT123_silence_limit
+#define silence_block INT123_silence_block
+#define silence_frame INT123_silence_frame
+#define silence_count INT123_silence_count
 #define init_layer3 INT123_init_layer3
-#define init_layer3_gainpow2 INT123_init_layer3_gainpow2
 #define init_layer3_stuff INT123_init_layer3_stuff
 #define init_layer12 INT123_init_layer12
-#define init_layer12_table INT123_init_layer12_table
 #define init_layer12_stuff INT123_init_layer12_stuff
 #define prepare_decode_tables INT123_prepare_decode_tables
 #define make_decode_tables INT123_make_decode_tables
 #define make_decode_tables_mmx INT123_make_decode_tables_mmx
-#define init_layer3_gainpow2_mmx INT123_init_layer3_gainpow2_mmx
-#define init_layer12_table_mmx INT123_init_layer12_table_mmx
 #define make_conv16to8_table INT123_make_conv16to8_table
 #define do_layer3 INT123_do_layer3
 #define do_layer2 INT123_do_layer2
 #define do_layer1 INT123_do_layer1
+#define silence_layer3 INT123_silence_layer3
+#define silence_layer2 INT123_silence_layer2
+#define silence_layer1 INT123_silence_layer1
 #define do_equalizer INT123_do_equalizer
 #define dither_table_init INT123_dither_table_init
 #define frame_dither_init INT123_frame_dither_init
+#define frame_dither_table_init INT123_frame_dither_table_init
 #define invalidate_format INT123_invalidate_format
 #define frame_init INT123_frame_init
 #define frame_init_par INT123_frame_init_par
@@ -184,6 +282,7 @@
 #define frame_gapless_ignore INT123_frame_gapless_ignore
 #define frame_expect_outsamples INT123_frame_expect_outsamples
 #define frame_skip INT123_frame_skip
+#define frame_set_bo INT123_frame_set_bo
 #define frame_ins2outs INT123_frame_ins2outs
 #define frame_outs INT123_frame_outs
 #define frame_expect_outsampels INT123_frame_expect_outsampels
@@ -210,6 +309,8 @@
 #define fi_add INT123_fi_add
 #define fi_set INT123_fi_set
 #define fi_reset INT123_fi_reset
+#define fi_add_full INT123_fi_add_full
+#define fi_full_pos INT123_fi_full_pos
 #define double_to_long_rounded INT123_double_to_long_rounded
 #define scale_rounded INT123_scale_rounded
 #define decode_update INT123_decode_update
@@ -218,6 +319,7 @@
 #define bytes_to_samples INT123_bytes_to_samples
 #define outblock_bytes INT123_outblock_bytes
 #define postprocess_buffer INT123_postprocess_buffer
+#define planar_buffer INT123_planar_buffer
 #define frame_cpu_opt INT123_frame_cpu_opt
 #define set_synth_functions INT123_set_synth_functions
 #define dectype INT123_dectype
@@ -242,9 +344,16 @@
 #define open_stream_handle INT123_open_stream_handle
 #define open_feed INT123_open_feed
 #define feed_more INT123_feed_more
+#define feed_more_ref INT123_feed_more_ref
 #define feed_forget INT123_feed_forget
 #define feed_set_pos INT123_feed_set_pos
 #define open_bad INT123_open_bad
+#define open_scan INT123_open_scan
+#define close_scan INT123_close_scan
+#define open_map INT123_open_map
+#define open_uring INT123_open_uring
+#define open_thread INT123_open_thread
+#define stream_mtime INT123_stream_mtime
 #define open_module INT123_open_module
 #define close_module INT123_close_module
 #define list_modules INT123_list_modules
@@ -333,6 +442,12 @@
 #define synth_1to1_s_avx_accurate_asm INT123_synth_1to1_s_avx_accurate_asm
 #define synth_1to1_real_s_avx_asm INT123_synth_1to1_real_s_avx_asm
 #define synth_1to1_s32_s_avx_asm INT123_synth_1to1_s32_s_avx_asm
+#define synth_1to1_avx512_asm INT123_synth_1to1_avx512_asm
+#define synth_1to1_s_avx512_asm INT123_synth_1to1_s_avx512_asm
+#define synth_1to1_real_avx512_asm INT123_synth_1to1_real_avx512_asm
+#define synth_1to1_real_s_avx512_asm INT123_synth_1to1_real_s_avx512_asm
+#define synth_1to1_s32_avx512_asm INT123_synth_1to1_s32_avx512_asm
+#define synth_1to1_s32_s_avx512_asm INT123_synth_1to1_s32_s_avx512_asm
 #define synth_1to1_s_neon_asm INT123_synth_1to1_s_neon_asm
 #define synth_1to1_s_neon64_asm INT123_synth_1to1_s_neon64_asm
 #define synth_1to1_s_neon64_accurate_asm INT123_synth_1to1_s_neon64_accurate_asm
@@ -352,6 +467,10 @@
 #define synth_1to1_x86_64_accurate_asm INT123_synth_1to1_x86_64_accurate_asm
 #define synth_1to1_real_x86_64_asm INT123_synth_1to1_real_x86_64_asm
 #define synth_1to1_s32_x86_64_asm INT123_synth_1to1_s32_x86_64_asm
+#define synth_window_x86_64_asm INT123_synth_window_x86_64_asm
+#define synth_window_avx_asm INT123_synth_window_avx_asm
+#define synth_window_neon_asm INT123_synth_window_neon_asm
+#define synth_window_neon64_asm INT123_synth_window_neon64_asm
 #define costab_mmxsse INT123_costab_mmxsse
 #define make_decode_tables_mmx_asm INT123_make_decode_tables_mmx_asm
 #ifndef HAVE_STRERROR
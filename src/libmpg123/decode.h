@@ -31,6 +31,12 @@
 #define NTOM_MAX_FREQ 96000 /* maximum frequency to upsample to / downsample from */
 #define NTOM_MUL (32768)
 void ntom_set_ntom(mpg123_handle *fr, off_t num);
+/* The windowed-sinc resampler in resample.c filters the float synth output. */
+#if !defined(NO_REAL) && !defined(REAL_IS_FIXED)
+#define RESAMPLE_SINC
+#define RESAMPLE_MAX_TAPS 64
+#define RESAMPLE_PHASES 256
+#endif
 #endif
 
 /* Let's collect all possible synth functions here, for an overview.
@@ -55,6 +61,8 @@ int synth_1to1_x86_64     (real*, int, mpg123_handle*, int);
 int synth_1to1_stereo_x86_64(real*, real*, mpg123_handle*);
 int synth_1to1_avx        (real*, int, mpg123_handle*, int);
 int synth_1to1_stereo_avx (real*, real*, mpg123_handle*);
+int synth_1to1_avx512        (real*, int, mpg123_handle*, int);
+int synth_1to1_stereo_avx512 (real*, real*, mpg123_handle*);
 int synth_1to1_arm        (real*, int, mpg123_handle*, int);
 int synth_1to1_neon       (real*, int, mpg123_handle*, int);
 int synth_1to1_stereo_neon(real*, real*, mpg123_handle*);
@@ -80,12 +88,25 @@ int synth_4to1_dither     (real *,int, mpg123_handle*, int);
 int synth_4to1_i386       (real*, int, mpg123_handle*, int);
 int synth_4to1_mono       (real*, mpg123_handle*);
 int synth_4to1_m2s(real*, mpg123_handle*);
+/* Optimized float window for the downsampling, see synth_window.h . */
+int synth_2to1_x86_64     (real*, int, mpg123_handle*, int);
+int synth_2to1_avx        (real*, int, mpg123_handle*, int);
+int synth_2to1_neon       (real*, int, mpg123_handle*, int);
+int synth_2to1_neon64     (real*, int, mpg123_handle*, int);
+int synth_4to1_x86_64     (real*, int, mpg123_handle*, int);
+int synth_4to1_avx        (real*, int, mpg123_handle*, int);
+int synth_4to1_neon       (real*, int, mpg123_handle*, int);
+int synth_4to1_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #ifndef NO_NTOM
-/* NtoM is really just one implementation. */
+/* NtoM is the generic implementation, plus the optimized float window ones. */
 int synth_ntom (real *,int, mpg123_handle*, int);
 int synth_ntom_mono (real *, mpg123_handle *);
 int synth_ntom_m2s (real *, mpg123_handle *);
+int synth_ntom_x86_64     (real*, int, mpg123_handle*, int);
+int synth_ntom_avx        (real*, int, mpg123_handle*, int);
+int synth_ntom_neon       (real*, int, mpg123_handle*, int);
+int synth_ntom_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #endif
 
@@ -112,11 +133,24 @@ int synth_4to1_8bit            (real*, int, mpg123_handle*, int);
 int synth_4to1_8bit_i386       (real*, int, mpg123_handle*, int);
 int synth_4to1_8bit_mono       (real*, mpg123_handle*);
 int synth_4to1_8bit_m2s(real*, mpg123_handle*);
+/* Optimized float window for the downsampling, see synth_window.h . */
+int synth_2to1_8bit_x86_64     (real*, int, mpg123_handle*, int);
+int synth_2to1_8bit_avx        (real*, int, mpg123_handle*, int);
+int synth_2to1_8bit_neon       (real*, int, mpg123_handle*, int);
+int synth_2to1_8bit_neon64     (real*, int, mpg123_handle*, int);
+int synth_4to1_8bit_x86_64     (real*, int, mpg123_handle*, int);
+int synth_4to1_8bit_avx        (real*, int, mpg123_handle*, int);
+int synth_4to1_8bit_neon       (real*, int, mpg123_handle*, int);
+int synth_4to1_8bit_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #ifndef NO_NTOM
 int synth_ntom_8bit            (real*, int, mpg123_handle*, int);
 int synth_ntom_8bit_mono       (real*, mpg123_handle*);
 int synth_ntom_8bit_m2s(real*, mpg123_handle*);
+int synth_ntom_8bit_x86_64     (real*, int, mpg123_handle*, int);
+int synth_ntom_8bit_avx        (real*, int, mpg123_handle*, int);
+int synth_ntom_8bit_neon       (real*, int, mpg123_handle*, int);
+int synth_ntom_8bit_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #endif
 
@@ -132,6 +166,8 @@ int synth_1to1_real_x86_64     (real*, int, mpg123_handle*, int);
 int synth_1to1_real_stereo_x86_64(real*, real*, mpg123_handle*);
 int synth_1to1_real_avx        (real*, int, mpg123_handle*, int);
 int synth_1to1_fltst_avx (real*, real*, mpg123_handle*);
+int synth_1to1_real_avx512        (real*, int, mpg123_handle*, int);
+int synth_1to1_fltst_avx512 (real*, real*, mpg123_handle*);
 int synth_1to1_real_altivec    (real*, int, mpg123_handle*, int);
 int synth_1to1_fltst_altivec(real*, real*, mpg123_handle*);
 int synth_1to1_real_neon       (real*, int, mpg123_handle*, int);
@@ -149,11 +185,24 @@ int synth_4to1_real            (real*, int, mpg123_handle*, int);
 int synth_4to1_real_i386       (real*, int, mpg123_handle*, int);
 int synth_4to1_real_mono       (real*, mpg123_handle*);
 int synth_4to1_real_m2s(real*, mpg123_handle*);
+/* Optimized float window for the downsampling, see synth_window.h . */
+int synth_2to1_real_x86_64     (real*, int, mpg123_handle*, int);
+int synth_2to1_real_avx        (real*, int, mpg123_handle*, int);
+int synth_2to1_real_neon       (real*, int, mpg123_handle*, int);
+int synth_2to1_real_neon64     (real*, int, mpg123_handle*, int);
+int synth_4to1_real_x86_64     (real*, int, mpg123_handle*, int);
+int synth_4to1_real_avx        (real*, int, mpg123_handle*, int);
+int synth_4to1_real_neon       (real*, int, mpg123_handle*, int);
+int synth_4to1_real_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #ifndef NO_NTOM
 int synth_ntom_real            (real*, int, mpg123_handle*, int);
 int synth_ntom_real_mono       (real*, mpg123_handle*);
 int synth_ntom_real_m2s(real*, mpg123_handle*);
+int synth_ntom_real_x86_64     (real*, int, mpg123_handle*, int);
+int synth_ntom_real_avx        (real*, int, mpg123_handle*, int);
+int synth_ntom_real_neon       (real*, int, mpg123_handle*, int);
+int synth_ntom_real_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #endif
 
@@ -167,6 +216,8 @@ int synth_1to1_s32_x86_64     (real*, int, mpg123_handle*, int);
 int synth_1to1_s32_stereo_x86_64(real*, real*, mpg123_handle*);
 int synth_1to1_s32_avx        (real*, int, mpg123_handle*, int);
 int synth_1to1_s32_stereo_avx (real*, real*, mpg123_handle*);
+int synth_1to1_s32_avx512        (real*, int, mpg123_handle*, int);
+int synth_1to1_s32_stereo_avx512 (real*, real*, mpg123_handle*);
 int synth_1to1_s32_altivec    (real*, int, mpg123_handle*, int);
 int synth_1to1_s32_stereo_altivec(real*, real*, mpg123_handle*);
 int synth_1to1_s32_neon       (real*, int, mpg123_handle*, int);
@@ -184,11 +235,24 @@ int synth_4to1_s32            (real*, int, mpg123_handle*, int);
 int synth_4to1_s32_i386       (real*, int, mpg123_handle*, int);
 int synth_4to1_s32_mono       (real*, mpg123_handle*);
 int synth_4to1_s32_m2s(real*, mpg123_handle*);
+/* Optimized float window for the downsampling, see synth_window.h . */
+int synth_2to1_s32_x86_64     (real*, int, mpg123_handle*, int);
+int synth_2to1_s32_avx        (real*, int, mpg123_handle*, int);
+int synth_2to1_s32_neon       (real*, int, mpg123_handle*, int);
+int synth_2to1_s32_neon64     (real*, int, mpg123_handle*, int);
+int synth_4to1_s32_x86_64     (real*, int, mpg123_handle*, int);
+int synth_4to1_s32_avx        (real*, int, mpg123_handle*, int);
+int synth_4to1_s32_neon       (real*, int, mpg123_handle*, int);
+int synth_4to1_s32_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #ifndef NO_NTOM
 int synth_ntom_s32            (real*, int, mpg123_handle*, int);
 int synth_ntom_s32_mono       (real*, mpg123_handle*);
 int synth_ntom_s32_m2s(real*, mpg123_handle*);
+int synth_ntom_s32_x86_64     (real*, int, mpg123_handle*, int);
+int synth_ntom_s32_avx        (real*, int, mpg123_handle*, int);
+int synth_ntom_s32_neon       (real*, int, mpg123_handle*, int);
+int synth_ntom_s32_neon64     (real*, int, mpg123_handle*, int);
 #endif
 #endif
 
@@ -213,6 +277,29 @@ void dct36_avx     (real *,real *,real *,real *,real *);
 void dct36_neon    (real *,real *,real *,real *,real *);
 void dct36_neon64  (real *,real *,real *,real *,real *);
 
+/* The steps between the Huffman decoding and the hybrid filter in layer 3, generic and SIMD variants.
+   stereo_ms() and stereo_is() work on n values of both channels, t[0] and t[1] are the intensity factors. */
+void antialias        (real *xr, int sblim);
+void antialias_x86_64 (real *xr, int sblim);
+void antialias_avx    (real *xr, int sblim);
+void antialias_neon64 (real *xr, int sblim);
+void stereo_ms        (real *xr0, real *xr1, int n);
+void stereo_ms_x86_64 (real *xr0, real *xr1, int n);
+void stereo_ms_avx    (real *xr0, real *xr1, int n);
+void stereo_ms_neon64 (real *xr0, real *xr1, int n);
+void stereo_is        (real *xr0, real *xr1, int n, const real *t);
+void stereo_is_x86_64 (real *xr0, real *xr1, int n, const real *t);
+void stereo_is_avx    (real *xr0, real *xr1, int n, const real *t);
+void stereo_is_neon64 (real *xr0, real *xr1, int n, const real *t);
+/* Short block dct12 for 4 neighbouring sub-bands, with the window of each sub-band interleaved in wi. */
+void dct12_x86_64     (real *in, real *rawout1, real *rawout2, real *wi, real *ts);
+void dct12_neon64     (real *in, real *rawout1, real *rawout2, real *wi, real *ts);
+
+/* Layer I and II dequantization: fraction[i] = sample[i] * factor[i] for n values. */
+void dequant_layer12        (real *fraction, const int *sample, const real *factor, int n);
+void dequant_layer12_x86_64 (real *fraction, const int *sample, const real *factor, int n);
+void dequant_layer12_neon64 (real *fraction, const int *sample, const real *factor, int n);
+
 /* Tools for NtoM resampling synth, defined in ntom.c . */
 int synth_ntom_set_step(mpg123_handle *fr); /* prepare ntom decoding */
 unsigned long ntom_val(mpg123_handle *fr, off_t frame); /* compute ntom_val for frame offset */
@@ -229,17 +316,61 @@ off_t ntom_ins2outs(mpg123_handle *fr, off_t ins);
 off_t ntom_frameoff(mpg123_handle *fr, off_t soff);
 #endif
 
+#ifdef RESAMPLE_SINC
+/* Windowed-sinc resampling on top of the ntom sample positions, see resample.c . */
+int resample_init(mpg123_handle *fr); /* prepare for the current rates and quality */
+off_t resample_delay(mpg123_handle *fr); /* filter delay in output samples */
+int resample_stereo(real *bandPtr_l, real *bandPtr_r, mpg123_handle *fr);
+int resample_mono(real *bandPtr, mpg123_handle *fr);
+/* sums[0] = x . coef, sums[1] = x . (coef+taps) */
+void resample_dot       (const real *x, const real *coef, int taps, real *sums);
+void resample_dot_x86_64(const real *x, const real *coef, int taps, real *sums);
+void resample_dot_avx   (const real *x, const real *coef, int taps, real *sums);
+void resample_dot_neon64(const real *x, const real *coef, int taps, real *sums);
+#endif
+
+/* Waveform envelope for mpg123_peaks(), see peaks.c . */
+#define PEAKS_DELAY 8 /* synth latency in slots, for the envelope from subband energy */
+int peaks_setup(mpg123_handle *fr); /* for the current output format and volume */
+void peaks_reset(mpg123_handle *fr); /* forget the current window and pending entries */
+void peaks_exit(mpg123_handle *fr);
+void peaks_frame(mpg123_handle *fr, off_t skip, off_t end); /* decode into the envelope, keeping samples [skip, end) */
+void peaks_flush(mpg123_handle *fr); /* finish the last, partial window */
+size_t peaks_pending(mpg123_handle *fr); /* hand out waiting entries, return how many are left */
+int peaks_reserve(mpg123_handle *fr, size_t n); /* room for the entries the next n samples complete */
+int peaks_stereo(real *bandPtr_l, real *bandPtr_r, mpg123_handle *fr);
+int peaks_mono(real *bandPtr, mpg123_handle *fr);
+
+/* Loudness meter on the output (MPG123_LOUDNESS), see loudness.c . */
+#define LOUDNESS_TAPS   12  /* per phase of the true peak interpolation */
+#define LOUDNESS_PHASES 4   /* upsampling factor for the true peak */
+#define LOUDNESS_CHUNK  256 /* samples per channel processed in one go */
+#define LOUDNESS_OFFSET -0.691 /* LUFS of a K-weighted mean square of 1 */
+void loudness_reset(mpg123_handle *fr); /* filter state, on seeks */
+void loudness_clear(mpg123_handle *fr); /* the whole measurement, for a new track */
+void loudness_exit(mpg123_handle *fr);
+int loudness_buffer(mpg123_handle *fr); /* meter the decoded buffer after gapless trimming */
+long loudness_integrated(mpg123_handle *fr, double *lufs); /* returns the count of gated blocks */
+
+/* Silence from side info and allocation (MPG123_SILENCE_LEVEL), see silence.c . */
+void silence_reset(mpg123_handle *fr);
+double silence_limit(mpg123_handle *fr); /* largest bound that counts as silent */
+/* Called by the decoders with the bound of each block before dequantization.
+   Returns TRUE when it wrote the zeros of the block's slots and the decoder
+   should only step over its bits. */
+int silence_block(mpg123_handle *fr, double bound, int slots);
+/* Bounds of the blocks of the current frame without decoding, returns their count. */
+int silence_frame(mpg123_handle *fr, double *bound);
+/* Count a block mpg123_silence() looked at, TRUE if it would come out as silence. */
+int silence_count(mpg123_handle *fr, double bound);
+
 /* Initialization of any static data that majy be needed at runtime.
    Make sure you call these once before it is too late. */
 #ifndef NO_LAYER3
 void init_layer3(void);
-real init_layer3_gainpow2(mpg123_handle *fr, int i);
-void init_layer3_stuff(mpg123_handle *fr, real (*gainpow2)(mpg123_handle *fr, int i));
 #endif
 #ifndef NO_LAYER12
 void  init_layer12(void);
-real* init_layer12_table(mpg123_handle *fr, real *table, int m);
-void  init_layer12_stuff(mpg123_handle *fr, real* (*init_table)(mpg123_handle *fr, real *table, int m));
 #endif
 
 void prepare_decode_tables(void);
@@ -248,17 +379,19 @@ extern real *pnts[5]; /* tabinit provides, dct64 needs */
 
 /* Runtime (re)init functions; needed more often. */
 void make_decode_tables(mpg123_handle *fr); /* For every volume change. */
-/* Stuff needed after updating synth setup (see set_synth_functions()). */
-
-#ifdef OPT_MMXORSSE
-/* Special treatment for mmx-like decoders, these functions go into the slots below. */
-void make_decode_tables_mmx(mpg123_handle *fr);
+/* Stuff needed after updating synth setup (see set_synth_functions()).
+   Those just point the handle to the shared tables from init_layer*(),
+   the mmx-like decoders want their own scaling (mmx != 0). */
 #ifndef NO_LAYER3
-real init_layer3_gainpow2_mmx(mpg123_handle *fr, int i);
+void init_layer3_stuff(mpg123_handle *fr, int mmx);
 #endif
 #ifndef NO_LAYER12
-real* init_layer12_table_mmx(mpg123_handle *fr, real *table, int m);
+void init_layer12_stuff(mpg123_handle *fr, int mmx);
 #endif
+
+#ifdef OPT_MMXORSSE
+/* Special treatment for mmx-like decoders, these functions go into the slots below. */
+void make_decode_tables_mmx(mpg123_handle *fr);
 #endif
 
 #ifndef NO_8BIT
@@ -272,12 +405,15 @@ int make_conv16to8_table(mpg123_handle *fr);
 
 #ifndef NO_LAYER3
 int do_layer3(mpg123_handle *fr);
+int silence_layer3(mpg123_handle *fr, double *bound);
 #endif
 #ifndef NO_LAYER2
 int do_layer2(mpg123_handle *fr);
+int silence_layer2(mpg123_handle *fr, double *bound);
 #endif
 #ifndef NO_LAYER1
 int do_layer1(mpg123_handle *fr);
+int silence_layer1(mpg123_handle *fr, double *bound);
 #endif
 /* There's an 3DNow counterpart in asm. */
 void do_equalizer(real *bandPtr,int channel, real equalizer[2][32]);
@@ -483,61 +483,83 @@ off_t outblock_bytes(mpg123_handle *fr, off_t s)
 	return s * encsize * fr->af.channels;
 }
 
+/*
+	The conversions below are each one pass over the buffer. Flipping the sign
+	bit is the same as adding the offset for unsigned output. The loops work
+	on whole words or blocks of samples so that the compiler can vectorize
+	them, the widening ones go from the back in blocks that are read
+	completely before the (bigger) output overwrites them.
+*/
+
+#define SIGN_FLIP_16 0x8000
+#define SIGN_FLIP_32 0x80000000UL
+
 #ifndef NO_32BIT
 /* Remove every fourth byte, facilitating conversion from 32 bit to 24 bit integers.
-   This has to be aware of endianness, of course. */
-static void chop_fourth_byte(struct outbuffer *buf)
+   This has to be aware of endianness, of course. With flip = SIGN_FLIP_32,
+   the result is unsigned 24 bit. */
+static void chop_fourth_byte(struct outbuffer *buf, uint32_t flip)
 {
 	unsigned char *wpos = buf->data;
 	unsigned char *rpos = buf->data;
-#ifdef WORDS_BIGENDIAN
-	while((size_t) (rpos - buf->data + 4) <= buf->fill)
+	size_t count = buf->fill/4;
+	size_t i;
+	/* 4 samples of 4 bytes to 3 words. */
+	for(i=0; i+4<=count; i+=4)
 	{
-		/* Really stupid: Copy, increment. Byte per byte. */
-		*wpos = *rpos;
-		wpos++; rpos++;
-		*wpos = *rpos;
-		wpos++; rpos++;
-		*wpos = *rpos;
-		wpos++; rpos++;
-		rpos++; /* Skip the lowest byte (last). */
-	}
+		uint32_t s[4], w[3];
+		memcpy(s, rpos, sizeof(s));
+		s[0] ^= flip; s[1] ^= flip; s[2] ^= flip; s[3] ^= flip;
+#ifdef WORDS_BIGENDIAN
+		/* Skip the lowest byte (last). */
+		w[0] = (s[0] & 0xffffff00UL) | (s[1] >> 24);
+		w[1] = ((s[1] << 8) & 0xffff0000UL) | (s[2] >> 16);
+		w[2] = ((s[2] << 16) & 0xff000000UL) | (s[3] >> 8);
 #else
-	while((size_t) (rpos - buf->data + 4) <= buf->fill)
-	{
-		/* Really stupid: Copy, increment. Byte per byte. */
-		rpos++; /* Skip the lowest byte (first). */
-		*wpos = *rpos;
-		wpos++; rpos++;
-		*wpos = *rpos;
-		wpos++; rpos++;
-		*wpos = *rpos;
-		wpos++; rpos++;
+		/* Skip the lowest byte (first). */
+		w[0] = (s[0] >> 8)  | ((s[1] >> 8) << 24);
+		w[1] = (s[1] >> 16) | ((s[2] >> 8) << 16);
+		w[2] = (s[2] >> 24) | ((s[3] >> 8) << 8);
+#endif
+		memcpy(wpos,   &w[0], 4);
+		memcpy(wpos+4, &w[1], 4);
+		memcpy(wpos+8, &w[2], 4);
+		rpos += 16;
+		wpos += 12;
 	}
+	for(; i<count; ++i)
+	{
+#ifdef WORDS_BIGENDIAN
+		wpos[0] = rpos[0] ^ (flip >> 24);
+		wpos[1] = rpos[1];
+		wpos[2] = rpos[2];
+#else
+		wpos[0] = rpos[1];
+		wpos[1] = rpos[2];
+		wpos[2] = rpos[3] ^ (flip >> 24);
 #endif
+		rpos += 4;
+		wpos += 3;
+	}
 	buf->fill = wpos-buf->data;
 }
 
 static void conv_s32_to_u32(struct outbuffer *buf)
 {
-	size_t i;
-	int32_t  *ssamples = (int32_t*)  buf->data;
-	uint32_t *usamples = (uint32_t*) buf->data;
+	size_t i, j;
+	uint32_t *samples = (uint32_t*) buf->data;
 	size_t count = buf->fill/sizeof(int32_t);
 
-	for(i=0; i<count; ++i)
+	for(i=0; i+8<=count; i+=8)
 	{
-		/* Different strategy since we don't have a larger type at hand.
-			 Also watch out for silly +-1 fun because integer constants are signed in C90! */
-		if(ssamples[i] >= 0)
-		usamples[i] = (uint32_t)ssamples[i] + 2147483647+1;
-		/* The smallest value goes zero. */
-		else if(ssamples[i] == ((int32_t)-2147483647-1))
-		usamples[i] = 0;
-		/* Now -value is in the positive range of signed int ... so it's a possible value at all. */
-		else
-		usamples[i] = (uint32_t)2147483647+1 - (uint32_t)(-ssamples[i]);
+		uint32_t block[8];
+		memcpy(block, samples+i, sizeof(block));
+		for(j=0; j<8; ++j)
+		block[j] ^= SIGN_FLIP_32;
+		memcpy(samples+i, block, sizeof(block));
 	}
+	for(; i<count; ++i)
+	samples[i] ^= SIGN_FLIP_32;
 }
 
 #endif
@@ -553,22 +575,26 @@ static const char *bufsizeerr = "Fatal: Buffer too small for postprocessing!";
 
 static void conv_s16_to_u16(struct outbuffer *buf)
 {
-	size_t i;
-	int16_t  *ssamples = (int16_t*) buf->data;
-	uint16_t *usamples = (uint16_t*)buf->data;
+	size_t i, j;
+	uint16_t *samples = (uint16_t*)buf->data;
 	size_t count = buf->fill/sizeof(int16_t);
 
-	for(i=0; i<count; ++i)
+	for(i=0; i+8<=count; i+=8)
 	{
-		long tmp = (long)ssamples[i]+32768;
-		usamples[i] = (uint16_t)tmp;
+		uint16_t block[8];
+		memcpy(block, samples+i, sizeof(block));
+		for(j=0; j<8; ++j)
+		block[j] ^= SIGN_FLIP_16;
+		memcpy(samples+i, block, sizeof(block));
 	}
+	for(; i<count; ++i)
+	samples[i] ^= SIGN_FLIP_16;
 }
 
 #ifndef NO_REAL
 static void conv_s16_to_f32(struct outbuffer *buf)
 {
-	ssize_t i;
+	size_t i, j;
 	int16_t *in = (int16_t*) buf->data;
 	float  *out = (float*)   buf->data;
 	size_t count = buf->fill/sizeof(int16_t);
@@ -584,7 +610,15 @@ static void conv_s16_to_f32(struct outbuffer *buf)
 	}
 
 	/* Work from the back since output is bigger. */
-	for(i=count-1; i>=0; --i)
+	for(i=count; i>=8; )
+	{
+		int16_t block[8];
+		i -= 8;
+		memcpy(block, in+i, sizeof(block));
+		for(j=0; j<8; ++j)
+		out[i+j] = (float)block[j] * scale;
+	}
+	while(i--)
 	out[i] = (float)in[i] * scale;
 
 	buf->fill = count*sizeof(float);
@@ -592,11 +626,12 @@ static void conv_s16_to_f32(struct outbuffer *buf)
 #endif
 
 #ifndef NO_32BIT
-static void conv_s16_to_s32(struct outbuffer *buf)
+/* With flip = SIGN_FLIP_32, the result is unsigned 32 bit. */
+static void conv_s16_to_s32(struct outbuffer *buf, uint32_t flip)
 {
-	ssize_t i;
+	size_t i, j;
 	int16_t  *in = (int16_t*) buf->data;
-	int32_t *out = (int32_t*) buf->data;
+	uint32_t *out = (uint32_t*) buf->data;
 	size_t count = buf->fill/sizeof(int16_t);
 
 	if(buf->size < count*sizeof(int32_t))
@@ -605,16 +640,74 @@ static void conv_s16_to_s32(struct outbuffer *buf)
 		return;
 	}
 
-	/* Work from the back since output is bigger. */
-	for(i=count-1; i>=0; --i)
+	/* Work from the back since output is bigger.
+	   The value times S32_RESCALE is the same as shifting the bits up. */
+	for(i=count; i>=8; )
 	{
-		out[i] = in[i];
-		/* Could just shift bytes, but would have to mess with sign bit. */
-		out[i] *= S32_RESCALE;
+		int16_t block[8];
+		i -= 8;
+		memcpy(block, in+i, sizeof(block));
+		for(j=0; j<8; ++j)
+		out[i+j] = ((uint32_t)(uint16_t)block[j] << 16) ^ flip;
 	}
+	while(i--)
+	out[i] = ((uint32_t)(uint16_t)in[i] << 16) ^ flip;
 
 	buf->fill = count*sizeof(int32_t);
 }
+
+/* The 24 bit result of conv_s16_to_s32() and chop_fourth_byte() in one pass:
+   the 16 bits and a zero byte below. */
+static void conv_s16_to_s24(struct outbuffer *buf, uint16_t flip)
+{
+	size_t i;
+	int16_t *in = (int16_t*) buf->data;
+	unsigned char *out = buf->data;
+	size_t count = buf->fill/sizeof(int16_t);
+
+	if(buf->size < count*3)
+	{
+		error1("%s", bufsizeerr);
+		return;
+	}
+
+	/* Work from the back since output is bigger, 4 samples to 3 words. */
+	for(i=count; i>=4; )
+	{
+		uint16_t v[4];
+		uint32_t w[3];
+		i -= 4;
+		memcpy(v, in+i, sizeof(v));
+		v[0] ^= flip; v[1] ^= flip; v[2] ^= flip; v[3] ^= flip;
+#ifdef WORDS_BIGENDIAN
+		w[0] = ((uint32_t)v[0] << 16) | (v[1] >> 8);
+		w[1] = ((uint32_t)(v[1] & 0xff) << 24) | v[2];
+		w[2] = (uint32_t)v[3] << 8;
+#else
+		w[0] = (uint32_t)v[0] << 8;
+		w[1] = v[1] | ((uint32_t)(v[2] & 0xff) << 24);
+		w[2] = (v[2] >> 8) | ((uint32_t)v[3] << 16);
+#endif
+		memcpy(out+3*i,   &w[0], 4);
+		memcpy(out+3*i+4, &w[1], 4);
+		memcpy(out+3*i+8, &w[2], 4);
+	}
+	while(i--)
+	{
+		uint16_t v = (uint16_t)in[i] ^ flip;
+#ifdef WORDS_BIGENDIAN
+		out[3*i]   = v >> 8;
+		out[3*i+1] = v & 0xff;
+		out[3*i+2] = 0;
+#else
+		out[3*i]   = 0;
+		out[3*i+1] = v & 0xff;
+		out[3*i+2] = v >> 8;
+#endif
+	}
+
+	buf->fill = count*3;
+}
 #endif
 #endif
 
@@ -625,7 +718,7 @@ void postprocess_buffer(mpg123_handle *fr)
 		This caters for the final output formats that are never produced by
 		decoder synth directly (wide unsigned and 24 bit formats) or that are
 		missing because of limited decoder precision (16 bit synth but 32 or
-		24 bit output).
+		24 bit output). Each case is a single pass over the buffer.
 	*/
 	switch(fr->af.dec_enc)
 	{
@@ -637,11 +730,10 @@ void postprocess_buffer(mpg123_handle *fr)
 			conv_s32_to_u32(&fr->buffer);
 		break;
 		case MPG123_ENC_UNSIGNED_24:
-			conv_s32_to_u32(&fr->buffer);
-			chop_fourth_byte(&fr->buffer);
+			chop_fourth_byte(&fr->buffer, SIGN_FLIP_32);
 		break;
 		case MPG123_ENC_SIGNED_24:
-			chop_fourth_byte(&fr->buffer);
+			chop_fourth_byte(&fr->buffer, 0);
 		break;
 		}
 	break;
@@ -660,20 +752,16 @@ void postprocess_buffer(mpg123_handle *fr)
 #endif
 #ifndef NO_32BIT
 		case MPG123_ENC_SIGNED_32:
-			conv_s16_to_s32(&fr->buffer);
+			conv_s16_to_s32(&fr->buffer, 0);
 		break;
 		case MPG123_ENC_UNSIGNED_32:
-			conv_s16_to_s32(&fr->buffer);
-			conv_s32_to_u32(&fr->buffer);
+			conv_s16_to_s32(&fr->buffer, SIGN_FLIP_32);
 		break;
 		case MPG123_ENC_UNSIGNED_24:
-			conv_s16_to_s32(&fr->buffer);
-			conv_s32_to_u32(&fr->buffer);
-			chop_fourth_byte(&fr->buffer);
+			conv_s16_to_s24(&fr->buffer, SIGN_FLIP_16);
 		break;
 		case MPG123_ENC_SIGNED_24:
-			conv_s16_to_s32(&fr->buffer);
-			chop_fourth_byte(&fr->buffer);
+			conv_s16_to_s24(&fr->buffer, 0);
 		break;
 #endif
 		}
@@ -681,3 +769,61 @@ void postprocess_buffer(mpg123_handle *fr)
 #endif
 	}
 }
+
+/* Separate the left and right samples of the buffer (after the read
+   pointer) into two planes of half the size each, for MPG123_PLANAR.
+   Left ones move to the front in place, the right ones go through the
+   scratch buffer. The right plane stays at buf->plane bytes after the
+   read pointer while that advances through the left one. */
+#define DEINTERLEAVE(type) \
+{ \
+	type *smp = (type*)buf->p; \
+	type *right = (type*)fr->planebuf; \
+	for(i=0; i<count; ++i) \
+	{ \
+		right[i] = smp[2*i+1]; \
+		smp[i]   = smp[2*i]; \
+	} \
+	memcpy(smp+count, right, count*sizeof(type)); \
+}
+
+int planar_buffer(mpg123_handle *fr)
+{
+	struct outbuffer *buf = &fr->buffer;
+	size_t encsize = fr->af.encsize;
+	size_t count, i;
+
+	buf->plane = 0;
+	if(!(fr->p.flags & MPG123_PLANAR) || fr->af.channels != 2 || !buf->fill)
+	return MPG123_OK;
+
+	count = buf->fill/(2*encsize);
+	if(fr->planebuf_size < count*encsize)
+	{
+		if(fr->planebuf != NULL) free(fr->planebuf);
+		fr->planebuf_size = 0;
+		if(!(fr->planebuf = malloc(count*encsize)))
+		{
+			if(NOQUIET) error("cannot allocate plane buffer");
+			fr->err = MPG123_OUT_OF_MEM;
+			return MPG123_ERR;
+		}
+		fr->planebuf_size = count*encsize;
+	}
+
+	switch(encsize)
+	{
+		case 1: DEINTERLEAVE(uint8_t)  break;
+		case 2: DEINTERLEAVE(uint16_t) break;
+		case 4: DEINTERLEAVE(uint32_t) break;
+		default:
+			for(i=0; i<count; ++i)
+			{
+				memcpy(fr->planebuf+i*encsize, buf->p+(2*i+1)*encsize, encsize);
+				memmove(buf->p+i*encsize, buf->p+2*i*encsize, encsize);
+			}
+			memcpy(buf->p+count*encsize, fr->planebuf, count*encsize);
+	}
+	buf->plane = count*encsize;
+	return MPG123_OK;
+}
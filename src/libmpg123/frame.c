@@ -58,6 +58,13 @@ static void frame_default_pars(mpg123_pars *mp)
 	mp->index_size = INDEX_SIZE;
 #endif
 	mp->preframes = 4; /* That's good  for layer 3 ISO compliance bitstream. */
+	mp->readahead = 0;
+	mp->read_thread = 0;
+	mp->band_limit = 0;
+	mp->silence_level = 0.;
+#ifdef RESAMPLE_SINC
+	mp->resample = MPG123_RESAMPLE_NTOM;
+#endif
 	mpg123_fmt_all(mp);
 	/* Default of keeping some 4K buffers at hand, should cover the "usual" use case (using 16K pipe buffers as role model). */
 #ifndef NO_FEEDER
@@ -78,6 +85,9 @@ void frame_init_par(mpg123_handle *fr, mpg123_pars *mp)
 	fr->buffer.rdata = NULL;
 	fr->buffer.fill = 0;
 	fr->buffer.size = 0;
+	fr->buffer.plane = 0;
+	fr->planebuf = NULL;
+	fr->planebuf_size = 0;
 	fr->rawbuffs = NULL;
 	fr->rawbuffss = 0;
 	fr->rawdecwin = NULL;
@@ -89,6 +99,19 @@ void frame_init_par(mpg123_handle *fr, mpg123_pars *mp)
 	fr->dithernoise = NULL;
 #endif
 	fr->layerscratch = NULL;
+	fr->pk.pend = NULL;
+	fr->pk.pend_size = 0;
+	fr->pk.window = 0;
+	fr->pk.flags = 0;
+	peaks_reset(fr);
+	fr->ld.bins = NULL;
+	fr->ld.rate = 0;
+	fr->ld.channels = 0;
+	loudness_clear(fr);
+	fr->sp.handler = NULL;
+	fr->sp.data = NULL;
+	fr->sp.only = FALSE;
+	silence_reset(fr);
 	fr->xing_toc = NULL;
 	fr->cpu_opts.type = defdec();
 	fr->cpu_opts.class = decclass(fr->cpu_opts.type);
@@ -97,6 +120,11 @@ void frame_init_par(mpg123_handle *fr, mpg123_pars *mp)
 	fr->ntom_val[0] = NTOM_MUL>>1;
 	fr->ntom_val[1] = NTOM_MUL>>1;
 	fr->ntom_step = NTOM_MUL;
+#endif
+#ifdef RESAMPLE_SINC
+	fr->rs.taps = 0;
+	fr->rs.quality = MPG123_RESAMPLE_NTOM;
+	fr->rs.table = NULL;
 #endif
 	/* unnecessary: fr->buffer.size = fr->buffer.fill = 0; */
 	mpg123_reset_eq(fr);
@@ -112,6 +140,9 @@ void frame_init_par(mpg123_handle *fr, mpg123_pars *mp)
 	fr->rdat.r_read_handle = NULL;
 	fr->rdat.r_lseek_handle = NULL;
 	fr->rdat.cleanup_handle = NULL;
+	fr->rdat.mapdata = NULL;
+	fr->rdat.uring = NULL;
+	fr->rdat.thread = NULL;
 	fr->wrapperdata = NULL;
 	fr->wrapperclean = NULL;
 	fr->decoder_change = 1;
@@ -135,18 +166,18 @@ void frame_init_par(mpg123_handle *fr, mpg123_pars *mp)
 }
 
 #ifdef OPT_DITHER
-/* Also, only allocate the memory for the table on demand.
+/* The noise is the same for everyone, so there is one table for all handles.
    In future, one could create special noise for different sampling frequencies(?). */
-int frame_dither_init(mpg123_handle *fr)
+static float dithernoise[DITHERSIZE];
+
+void frame_dither_table_init(void)
 {
-	/* run-time dither noise table generation */
-	if(fr->dithernoise == NULL)
-	{
-		fr->dithernoise = malloc(sizeof(float)*DITHERSIZE);
-		if(fr->dithernoise == NULL) return 0;
+	dither_table_init(dithernoise);
+}
 
-		dither_table_init(fr->dithernoise);
-	}
+int frame_dither_init(mpg123_handle *fr)
+{
+	fr->dithernoise = dithernoise;
 	return 1;
 }
 #endif
@@ -440,12 +471,22 @@ int frame_buffers_reset(mpg123_handle *fr)
 	/* Wondering: could it be actually _wanted_ to retain buffer contents over different files? (special gapless / cut stuff) */
 	fr->bsbuf = fr->bsspace[1];
 	fr->bsbufold = fr->bsbuf;
+	fr->bsbody = fr->bsbodyold = NULL;
+	fr->bsstage = fr->bsbuf;
+	fr->bsmain = fr->bsmainold = 0;
+	fr->state_flags &= ~FRAME_INPLACE;
 	fr->bitreservoir = 0;
 	frame_decode_buffers_reset(fr);
-	memset(fr->bsspace, 0, 2*(MAXFRAMESIZE+512));
+	memset(fr->bsspace, 0, sizeof(fr->bsspace));
 	memset(fr->ssave, 0, 34);
 	fr->hybrid_blc[0] = fr->hybrid_blc[1] = 0;
 	memset(fr->hybrid_block, 0, sizeof(real)*2*2*SBLIMIT*SSLIMIT);
+#ifdef RESAMPLE_SINC
+	memset(fr->rs.hist, 0, sizeof(fr->rs.hist));
+#endif
+	peaks_reset(fr);
+	loudness_reset(fr);
+	silence_reset(fr);
 	return 0;
 }
 
@@ -490,6 +531,7 @@ int frame_reset(mpg123_handle* fr)
 {
 	frame_buffers_reset(fr);
 	frame_fixed_reset(fr);
+	loudness_clear(fr);
 	frame_free_toc(fr);
 #ifdef FRAME_INDEX
 	fi_reset(&fr->index);
@@ -521,6 +563,7 @@ static void frame_fixed_reset(mpg123_handle *fr)
 	fr->abr_rate = 0;
 	fr->track_frames = 0;
 	fr->track_samples = -1;
+	memset(fr->scan_bitrates, 0, sizeof(fr->scan_bitrates));
 	fr->framesize=0; 
 	fr->mean_frames = 0;
 	fr->mean_framesize = 0;
@@ -586,17 +629,20 @@ void frame_exit(mpg123_handle *fr)
 		free(fr->buffer.rdata);
 	}
 	fr->buffer.rdata = NULL;
+	if(fr->planebuf != NULL) free(fr->planebuf);
+	fr->planebuf = NULL;
+	fr->planebuf_size = 0;
+#ifdef RESAMPLE_SINC
+	if(fr->rs.table != NULL) free(fr->rs.table);
+	fr->rs.table = NULL;
+	fr->rs.taps = 0;
+#endif
+	peaks_exit(fr);
+	loudness_exit(fr);
 	frame_free_buffers(fr);
 	frame_free_toc(fr);
 #ifdef FRAME_INDEX
 	fi_exit(&fr->index);
-#endif
-#ifdef OPT_DITHER
-	if(fr->dithernoise != NULL)
-	{
-		free(fr->dithernoise);
-		fr->dithernoise = NULL;
-	}
 #endif
 	exit_id3(fr);
 	clear_icy(&fr->icy);
@@ -617,7 +663,7 @@ int attribute_align_arg mpg123_framedata(mpg123_handle *mh, unsigned long *heade
 	if(!mh->to_decode) return MPG123_ERR;
 
 	if(header    != NULL) *header    = mh->oldhead;
-	if(bodydata  != NULL) *bodydata  = mh->bsbuf;
+	if(bodydata  != NULL) *bodydata  = mh->bsbody != NULL ? mh->bsbody : mh->bsbuf;
 	if(bodybytes != NULL) *bodybytes = mh->framesize;
 
 	return MPG123_OK;
@@ -685,17 +731,27 @@ off_t frame_index_find(mpg123_handle *fr, off_t want_frame, off_t* get_frame)
 	off_t gopos = 0;
 	*get_frame = 0;
 #ifdef FRAME_INDEX
+	/* The full index knows the wanted frame itself, if it got that far. */
+	if(want_frame < fr->index.frames)
+	{
+		*get_frame = want_frame;
+		gopos = fi_full_pos(&fr->index, want_frame);
+		fr->state_flags |= FRAME_ACCURATE;
+	}
 	/* Possibly use VBRI index, too? I'd need an example for this... */
-	if(fr->index.fill)
+	else if(fr->index.fill || fr->index.frames)
 	{
 		/* find in index */
 		size_t fi;
+		off_t full_last = fr->index.frames-1; /* -1 without full index */
 		/* at index fi there is frame step*fi... */
 		fi = want_frame/fr->index.step;
 		if(fi >= fr->index.fill) /* If we are beyond the end of frame index...*/
 		{
+			off_t last = fr->index.fill ? (off_t)(fr->index.fill-1)*fr->index.step : 0;
+			if(full_last > last) last = full_last;
 			/* When fuzzy seek is allowed, we have some limited tolerance for the frames we want to read rather then jump over. */
-			if(fr->p.flags & MPG123_FUZZY && want_frame - (fr->index.fill-1)*fr->index.step > 10)
+			if(fr->p.flags & MPG123_FUZZY && want_frame - last > 10)
 			{
 				gopos = frame_fuzzy_find(fr, want_frame, get_frame);
 				if(gopos > fr->audio_start) return gopos; /* Only in that case, we have a useful guess. */
@@ -705,8 +761,16 @@ off_t frame_index_find(mpg123_handle *fr, off_t want_frame, off_t* get_frame)
 			fi = fr->index.fill - 1;
 		}
 		/* We have index position, that yields frame and byte offsets. */
-		*get_frame = fi*fr->index.step;
-		gopos = fr->index.data[fi];
+		if(fr->index.fill && (off_t)fi*fr->index.step >= full_last)
+		{
+			*get_frame = fi*fr->index.step;
+			gopos = fr->index.data[fi];
+		}
+		else
+		{ /* The full index ends before want_frame, but closer to it. */
+			*get_frame = full_last;
+			gopos = fi_full_pos(&fr->index, full_last);
+		}
 		fr->state_flags |= FRAME_ACCURATE; /* When using the frame index, we are accurate. */
 	}
 	else
@@ -832,6 +896,17 @@ void frame_gapless_realinit(mpg123_handle *fr)
 	if(fr->gapless_frames > 0)
 	fr->fullend_os = frame_ins2outs(fr, fr->gapless_frames*fr->spf);
 	else fr->fullend_os = 0;
+#ifdef RESAMPLE_SINC
+	/* The resampling filter delays everything a bit more, it has to be skipped, too.
+	   The end might be cut a little if the stream lacks the padding for that. */
+	if(fr->gapless_frames > 0 && fr->down_sample == 3)
+	{
+		off_t delay = resample_delay(fr);
+		fr->begin_os += delay;
+		fr->end_os   += delay;
+		if(fr->end_os > fr->fullend_os) fr->end_os = fr->fullend_os;
+	}
+#endif
 
 	debug4("frame_gapless_realinit: from %"OFF_P" to %"OFF_P" samples (%"OFF_P", %"OFF_P")", (off_p)fr->begin_os, (off_p)fr->end_os, (off_p)fr->fullend_os, (off_p)fr->gapless_frames);
 }
@@ -916,6 +991,20 @@ void frame_skip(mpg123_handle *fr)
 #endif
 }
 
+/*
+	The synth filters walk a ring of 16 buffer slots, one step for each 32
+	samples. The sums are mathematically the same at each ring position, but
+	their order is not, so a decoder starting at some other position after a
+	seek (or a separate handle working on a piece of the stream) would differ
+	from a plain decode in the last bit. Fixing the ring position to the frame
+	number makes output after seeking identical to sequential decoding.
+*/
+void frame_set_bo(mpg123_handle *fr, off_t num)
+{
+	if(num < 0) num = 0;
+	fr->bo = (int)((1 - (num%16)*(fr->spf/32)) & 0xf);
+}
+
 /* Sample accurate seek prepare for decoder. */
 /* This gets unadjusted output samples and takes resampling into account */
 void frame_set_seek(mpg123_handle *fr, off_t sp)
@@ -1017,6 +1106,28 @@ int attribute_align_arg mpg123_getvolume(mpg123_handle *mh, double *base, double
 	return MPG123_OK;
 }
 
+/* ReplayGain 2.0 reference level for the measured loudness. */
+#define RVA_REFERENCE_LUFS -18.
+
+int attribute_align_arg mpg123_loudness_rva(mpg123_handle *mh)
+{
+	double lufs;
+
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(!loudness_integrated(mh, &lufs))
+	{
+		mh->err = MPG123_BAD_VALUE;
+		return MPG123_ERR;
+	}
+	/* The measurement outranks any gain from tags. */
+	mh->rva.level[0] = (mh->rva.level[0] > mh->rva.level[1] ? mh->rva.level[0] : mh->rva.level[1]) + 1;
+	if(mh->rva.level[0] < 1) mh->rva.level[0] = 1;
+	mh->rva.gain[0] = (float)(RVA_REFERENCE_LUFS - lufs);
+	mh->rva.peak[0] = (float)mh->ld.peak;
+	do_rva(mh);
+	return MPG123_OK;
+}
+
 off_t attribute_align_arg mpg123_framepos(mpg123_handle *mh)
 {
 	if(mh == NULL) return MPG123_ERR;
@@ -23,6 +23,8 @@
 
 #ifdef OPT_DITHER
 #include "dither.h"
+/* Called once from mpg123_init(). */
+void frame_dither_table_init(void);
 int frame_dither_init(mpg123_handle *fr);
 #endif
 
@@ -43,6 +45,7 @@ struct outbuffer
 	size_t fill; /* fill from read pointer */
 	size_t size;
 	unsigned char *rdata; /* unaligned base pointer */
+	size_t plane; /* right channel offset from p with MPG123_PLANAR */
 };
 
 struct audioformat
@@ -64,6 +67,13 @@ struct mpg123_pars_struct
 #ifndef NO_NTOM
 	long force_rate;
 #endif
+#ifdef RESAMPLE_SINC
+	long resample; /* MPG123_RESAMPLE_* quality for NtoM rate conversion */
+#endif
+	long readahead; /* reads in flight for the io_uring reader */
+	long read_thread; /* ring buffer bytes for the reader thread */
+	long band_limit; /* subbands to decode, 0 for all */
+	double silence_level; /* dBFS, 0 for digital silence only */
 	int down_sample;
 	int rva; /* (which) rva to do: 0: nothing, 1: radio/mix/track 2: album/audiophile */
 	long halfspeed;
@@ -86,11 +96,16 @@ struct mpg123_pars_struct
 #endif
 };
 
+/* All MPEG bitrates are multiples of 8 kbps, up to 448 kbps. */
+#define SCAN_BITRATES (448/8+1)
+
 enum frame_state_flags
 {
 	 FRAME_ACCURATE      = 0x1  /**<     0001 Positions are considered accurate. */
 	,FRAME_FRANKENSTEIN  = 0x2  /**<     0010 This stream is concatenated. */
 	,FRAME_FRESH_DECODER = 0x4  /**<     0100 Decoder is fleshly initialized. */
+	,FRAME_SCANNING      = 0x8  /**<     1000 Only parsing headers for mpg123_scan(), frame bodies are skipped. */
+	,FRAME_INPLACE       = 0x10 /**<    10000 Current frame body is in the reader's memory, not in bsspace. */
 };
 
 /* There is a lot to condense here... many ints can be merged as flags; though the main space is still consumed by buffers. */
@@ -111,7 +126,7 @@ struct mpg123_handle_struct
 	int bo; /* Just have it always here. */
 #ifdef OPT_DITHER
 	int ditherindex;
-	float *dithernoise;
+	const float *dithernoise;
 #endif
 	unsigned char* rawdecwin; /* the block with all decwins */
 	int rawdecwins; /* size of rawdecwin memory */
@@ -133,21 +148,105 @@ struct mpg123_handle_struct
 	unsigned char *conv16to8_buf;
 	unsigned char *conv16to8;
 #endif
-	/* There's some possible memory saving for stuff that is not _really_ dynamic. */
+	/* Shared static tables, just different for mmx. */
 
 	/* layer3 */
-	int longLimit[9][23];
-	int shortLimit[9][14];
-	real gainpow2[256+118+4]; /* not really dynamic, just different for mmx */
+	const real *gainpow2;
 
 	/* layer2 */
-	real muls[27][64];	/* also used by layer 1 */
+	real (*muls)[64];	/* also used by layer 1 */
 
 #ifndef NO_NTOM
 	/* decode_ntom */
 	unsigned long ntom_val[2];
 	unsigned long ntom_step;
 #endif
+#ifdef RESAMPLE_SINC
+	/* Filtering NtoM resampler behind synth_stereo/synth_mono (resample.c). */
+	struct
+	{
+		func_synth_stereo synth_stereo; /* the 1to1 real synths feeding the filter */
+		func_synth_mono synth_mono;
+		enum synth_format format; /* the actual output format */
+		int taps; /* 0 when not active */
+		int quality;
+		long rate_in;
+		long rate_out;
+		real *table; /* RESAMPLE_PHASES rows of taps coefficients and taps differences to the next row */
+		real hist[2][RESAMPLE_MAX_TAPS-1+SBLIMIT];
+		real block[2*SBLIMIT];
+		real out[2*SBLIMIT*NTOM_MAX];
+	} rs;
+#endif
+	/* Waveform envelope behind synth_stereo/synth_mono for mpg123_peaks() (peaks.c). */
+	struct
+	{
+		func_synth_stereo synth_stereo; /* the normal synths, for MPG123_PEAKS_SYNTH */
+		func_synth_mono synth_mono;
+		int flags;
+		int format; /* enum synth_format of the normal synth */
+		double scale; /* from subband energy to mean square output */
+		size_t window; /* samples per entry */
+		size_t pos; /* samples in the current entry so far */
+		double min, max, sum; /* of the current entry, sum of mean squares over channels */
+		off_t skip; /* keep samples [skip, end) of the current frame, end < 0 for all */
+		off_t end;
+		off_t got; /* samples of the current frame so far */
+		double delay[PEAKS_DELAY]; /* mean squares of the last slots */
+		int dpos;
+		float *out[3]; /* min, max and rms arrays of the caller */
+		size_t count;
+		size_t fill;
+		float *pend; /* entries waiting for the next call, three floats each */
+		size_t pend_size;
+		size_t pend_fill;
+		size_t pend_pos;
+		real block[2*SBLIMIT*NTOM_MAX];
+	} pk;
+	/* Loudness meter state (loudness.c). */
+	struct
+	{
+		long rate; /* the filters are set up for, 0 for none yet */
+		int channels;
+		double b[3]; /* shelf biquad, the high pass has 1, -2, 1 */
+		double a[2][2]; /* feedback of both, a0 being 1 */
+		double z[2][6]; /* filter state per channel */
+		double tp[LOUDNESS_TAPS][LOUDNESS_PHASES]; /* true peak interpolation */
+		double tp_gain; /* largest sum of coefficient magnitudes of a phase */
+		double hist[2][LOUDNESS_TAPS-1+LOUDNESS_CHUNK]; /* past and current samples */
+		long partlen; /* samples in 100 ms */
+		long part;
+		double partsum;
+		double sub[4]; /* mean squares of the last parts */
+		int subs;
+		int subpos;
+		double momentary; /* mean square of the last 400 ms block, -1 for none */
+		double peak;
+		long blocks; /* above the absolute gate */
+		double *bins; /* histogram: count and energy sum of the blocks per bin */
+	} ld;
+	/* Layer III spectral data for mpg123_spectrum_handler(). */
+	struct
+	{
+		void (*handler)(void *, const mpg123_granule *);
+		void *data;
+		int only; /* stop before synthesis, in mpg123_spectrum() */
+		float xr[SBLIMIT*SSLIMIT];
+	} sp;
+	/* Silence from the bitstream, see silence.c . */
+	struct
+	{
+		int run; /* blocks in a row with a bound at or below the limit */
+		int clear; /* filter state cleared for the current run */
+		double bound[3]; /* of the blocks of the frame mpg123_silence() looked at */
+		int blocks;
+		int next; /* block to look at next */
+		off_t pos; /* output samples of that frame before gapless trimming */
+		off_t len;
+		int span; /* mpg123_silence() is inside a silent span */
+		off_t begin; /* of that, in samples before gapless trimming */
+		off_t end;
+	} sil;
 	/* special i486 fun */
 #ifdef OPT_I486
 	int *int_buffs[2][2];
@@ -165,6 +264,22 @@ struct mpg123_handle_struct
 #if (defined OPT_3DNOW_VINTAGE || defined OPT_3DNOWEXT_VINTAGE || defined OPT_SSE || defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON || defined OPT_NEON64)
 		void (*the_dct36)(real *,real *,real *,real *,real *);
 #endif
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+		void (*the_antialias)(real *, int);
+		void (*the_stereo_ms)(real *, real *, int);
+		void (*the_stereo_is)(real *, real *, int, const real *);
+		void (*the_dct12)(real *,real *,real *,real *,real *); /* NULL: C dct12 only */
+#endif
+#endif
+#ifndef NO_LAYER12
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+		void (*the_dequant_layer12)(real *, const int *, const real *, int);
+#endif
+#endif
+#ifdef RESAMPLE_SINC
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+		void (*the_resample_dot)(const real *, const real *, int, real *);
+#endif
 #endif
 
 #endif
@@ -243,15 +358,24 @@ struct mpg123_handle_struct
 	/* input data */
 	off_t track_frames;
 	off_t track_samples;
+	/* Frame counts per bitrate from mpg123_scan(), index is kbps/8 (0 for free format). */
+	size_t scan_bitrates[SCAN_BITRATES];
 	double mean_framesize;
 	off_t mean_frames;
 	int fsizeold;
 	int ssize;
 	unsigned int bitreservoir;
-	unsigned char bsspace[2][MAXFRAMESIZE+512]; /* MAXFRAMESIZE */
+	unsigned char bsspace[2][MAXFRAMESIZE+512+16]; /* MAXFRAMESIZE, plus bit reader look-ahead */
 	unsigned char *bsbuf;
 	unsigned char *bsbufold;
 	int bsnum;
+	/* A Layer III body left in the reader's memory: bsbuf is its staged start
+	   in bsspace, main data continues in bsbody (see read_frame()). */
+	unsigned char *bsbody;
+	unsigned char *bsstage;
+	int bsmain;                 /* offset of the main data, ssize of that frame */
+	unsigned char *bsbodyold;   /* same for the frame before, with bsbufold */
+	int bsmainold;
 	/* That is the header matching the last read frame body. */
 	unsigned long oldhead;
 	/* That is the header that is supposedly the first of the stream. */
@@ -263,6 +387,8 @@ struct mpg123_handle_struct
 
 	/* output data */
 	struct outbuffer buffer;
+	unsigned char *planebuf; /* scratch for one channel with MPG123_PLANAR */
+	size_t planebuf_size;
 	struct audioformat af;
 	int own_buffer;
 	size_t outblock; /* number of bytes that this frame produces (upper bound) */
@@ -393,6 +519,8 @@ off_t frame_expect_outsamples(mpg123_handle *fr);
 
 /* Skip this frame... do some fake action to get away without actually decoding it. */
 void frame_skip(mpg123_handle *fr);
+/* Put the synth ring buffer position where sequential decoding would have it for frame num. */
+void frame_set_bo(mpg123_handle *fr, off_t num);
 
 /*
 	Seeking core functions:
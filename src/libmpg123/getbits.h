@@ -37,7 +37,7 @@
   fr->bitindex &= 7, \
   fr->ultmp)
 
-static unsigned int getbits(mpg123_handle *fr, int number_of_bits)
+static inline unsigned int getbits(mpg123_handle *fr, int number_of_bits)
 {
   unsigned long rval;
 
@@ -101,4 +101,121 @@ fprintf(stderr,":%lx\n",rval);
   fr->wordpointer += (fr->bitindex>>3), fr->bitindex &= 7, fr->uctmp>>7 )
 
 
+/*
+	A bit reader with a 64 bit cache, for the loops that read many fields in a row.
+	It works on a copy of the stream position: bits_begin() takes it from
+	fr->wordpointer and fr->bitindex, bits_end() hands it back. Do not use the
+	macros above on the same handle in between.
+	The cache is refilled with 8 bytes at once, so a refill may look up to 15 bytes
+	beyond the current position. The bitstream buffers have room for that.
+
+	A Layer III body left in the reader's memory has only its side info and the
+	first BITS_STAGED bytes of main data copied behind the bit reservoir in bsspace
+	(fr->bsbody, see read_frame()). Once the position reaches the seam, BITS_SEAM
+	bytes into the main data, the reader continues at the same offset in the body.
+	Refills before the seam stay within the staged bytes and positions after it
+	cannot point back to the side info in the body.
+*/
+#define BITS_SEAM   8
+#define BITS_STAGED 16
+#define BITS_NOSEAM ((const unsigned char*)~(size_t)0)
+
+struct bitreader
+{
+  uint64_t cache;            /* upcoming bits, first one in the MSB */
+  int num;                   /* number of valid bits in the cache */
+  const unsigned char *ptr;  /* next byte to go into the cache */
+  const unsigned char *end;  /* end of the frame, for the safety catch */
+  const unsigned char *seam; /* where to switch to the body, BITS_NOSEAM for never */
+  const unsigned char *next; /* the seam in the body */
+};
+
+/* Same offsets from now on, other memory. */
+static inline void bits_cross(struct bitreader *br)
+{
+  br->ptr  = br->next + (br->ptr - br->seam);
+  br->end  = br->next + (br->end - br->seam);
+  br->seam = BITS_NOSEAM;
+}
+
+/* Fill up the cache to 56 bits at least. Bits below num are stream data or zero. */
+static inline void bits_refill(struct bitreader *br)
+{
+  const unsigned char *p;
+  uint64_t val;
+  if(br->ptr >= br->seam)
+    bits_cross(br);
+  p = br->ptr;
+  val = (uint64_t)p[0]<<56 | (uint64_t)p[1]<<48
+  | (uint64_t)p[2]<<40 | (uint64_t)p[3]<<32
+  | (uint64_t)p[4]<<24 | (uint64_t)p[5]<<16
+  | (uint64_t)p[6]<<8  | (uint64_t)p[7];
+  br->cache |= val >> br->num;
+  br->ptr   += (63-br->num)>>3;
+  br->num   |= 56;
+}
+
+static inline void bits_begin(mpg123_handle *fr, struct bitreader *br)
+{
+  br->seam = BITS_NOSEAM;
+  br->next = NULL;
+  if(fr->bsbody != NULL && fr->bsbuf != fr->bsbody)
+  {
+    const unsigned char *seam = fr->bsbuf + fr->bsmain + BITS_SEAM;
+    if(fr->wordpointer >= seam)
+    {
+      fr->wordpointer = fr->bsbody + (fr->wordpointer - fr->bsbuf);
+      fr->bsbuf       = fr->bsbody;
+    }
+    else
+    {
+      br->seam = seam;
+      br->next = fr->bsbody + fr->bsmain + BITS_SEAM;
+    }
+  }
+  br->cache = 0;
+  br->num   = 0;
+  br->ptr   = fr->wordpointer;
+  br->end   = fr->bsbuf+fr->framesize;
+  bits_refill(br);
+  br->cache <<= fr->bitindex;
+  br->num    -= fr->bitindex;
+}
+
+static inline void bits_end(mpg123_handle *fr, struct bitreader *br)
+{
+  if(br->seam == BITS_NOSEAM && fr->bsbody != NULL)
+    fr->bsbuf = fr->bsbody;
+  fr->wordpointer = (unsigned char*)br->ptr - ((br->num+7)>>3);
+  fr->bitindex    = (-br->num)&0x7;
+}
+
+/* Look at the next nob bits (1 to 56 after a refill) without consuming them. */
+#define bits_peek(br, nob) ((unsigned int)((br)->cache>>(64-(nob))))
+
+#define bits_skip(br, nob) ((void)( \
+  (br)->cache <<= (nob), \
+  (br)->num    -= (nob) ))
+
+/* Like getbits_fast(): up to 32 bits, also nob == 0, no checks. */
+static inline unsigned int bits_get_fast(struct bitreader *br, int nob)
+{
+  unsigned int rval;
+  if(br->num < nob)
+    bits_refill(br);
+  rval = (unsigned int)((br->cache>>1)>>(63-nob));
+  bits_skip(br, nob);
+  return rval;
+}
+
+#define bits_get1(br) bits_get_fast(br, 1)
+
+/* Like getbits(), with the same safety catch: beyond the frame, return 0 and stay. */
+static inline unsigned int bits_get(struct bitreader *br, int nob)
+{
+  if((long)(br->end-br->ptr)*8 + br->num < nob)
+    return 0;
+  return bits_get_fast(br, nob);
+}
+
 #endif
@@ -13,18 +13,23 @@
 /* standard level flags part 1 (ECX)*/
 #define FLAG_SSE3      0x00000001
 #define FLAG_SSSE3     0x00000200
+#define FLAG_POPCNT    0x00800000
 #define FLAG_AVX       0x1C000000
 /* standard level flags part 2 (EDX) */
 #define FLAG2_MMX       0x00800000
 #define FLAG2_SSE       0x02000000
 #define FLAG2_SSE2      0x04000000
 #define FLAG2_FPU       0x00000001
+/* structured extended flags, level 7 (EBX) */
+#define FLAG3_AVX512F   0x00010000
+#define FLAG3_AVX512BW  0x40000000
 /* cpuid extended level 1 (AMD) */
 #define XFLAG_MMX      0x00800000
 #define XFLAG_3DNOW    0x80000000
 #define XFLAG_3DNOWEXT 0x40000000
 /* eXtended Control Register 0 */
 #define XCR0FLAG_AVX   0x00000006
+#define XCR0FLAG_AVX512 0x000000E6 /* plus opmask and all zmm state */
 
 
 struct cpuflags
@@ -37,6 +42,7 @@ struct cpuflags
 	unsigned int std2;
 	unsigned int ext;
 	unsigned int xcr0_lo;
+	unsigned int std3;
 #endif
 };
 
@@ -53,6 +59,10 @@ unsigned int getcpuflags(struct cpuflags* cf);
 #define cpu_sse2(s) (FLAG2_SSE2 & s.std2)
 #define cpu_sse3(s) (FLAG_SSE3 & s.std)
 #define cpu_avx(s) ((FLAG_AVX & s.std) == FLAG_AVX && (XCR0FLAG_AVX & s.xcr0_lo) == XCR0FLAG_AVX)
+/* The decoder also needs 16 bit masked stores (BW) and popcnt. */
+#define cpu_avx512(s) ( cpu_avx(s) && (FLAG_POPCNT & s.std) \
+                      && ((FLAG3_AVX512F|FLAG3_AVX512BW) & s.std3) == (FLAG3_AVX512F|FLAG3_AVX512BW) \
+                      && (XCR0FLAG_AVX512 & s.xcr0_lo) == XCR0FLAG_AVX512 )
 #define cpu_fast_sse(s) ((((s.id & 0xf00)>>8) == 6 && FLAG_SSSE3 & s.std) /* for Intel/VIA; family 6 CPUs with SSSE3 */ || \
 						   (((s.id & 0xf00)>>8) == 0xf && (((s.id & 0x0ff00000)>>20) > 0 && ((s.id & 0x0ff00000)>>20) != 5))) /* for AMD; family > 0xF CPUs except Bobcat */
 #define cpu_neon(s) (s.has_neon)
@@ -44,12 +44,24 @@ void fi_init(struct frame_index *fi)
 	fi->size = 0;
 	fi->grow_size = 0;
 	fi->next = fi_next(fi);
+	fi->frames = 0;
+	fi->lastpos = 0;
+	fi->lastsize = 0;
+	fi->deltas = NULL;
+	fi->dfill = 0;
+	fi->dsize = 0;
+	fi->checkpos = NULL;
+	fi->checkbyte = NULL;
+	fi->csize = 0;
 }
 
 void fi_exit(struct frame_index *fi)
 {
 	debug2("fi_exit: %p and %lu", (void*)fi->data, (unsigned long)fi->size);
 	if(fi->size && fi->data != NULL) free(fi->data);
+	if(fi->deltas    != NULL) free(fi->deltas);
+	if(fi->checkpos  != NULL) free(fi->checkpos);
+	if(fi->checkbyte != NULL) free(fi->checkbyte);
 
 	fi_init(fi); /* Be prepared for further fun, still. */
 }
@@ -133,4 +145,86 @@ void fi_reset(struct frame_index *fi)
 	fi->fill = 0;
 	fi->step = 1;
 	fi->next = fi_next(fi);
+	fi->frames = 0;
+	fi->dfill = 0;
+}
+
+/* Make room for one more checkpoint and the few bytes of a difference. */
+static int fi_full_grow(struct frame_index *fi)
+{
+	size_t check = (size_t)(fi->frames/FI_FULL_CHECK);
+	if(check >= fi->csize)
+	{
+		size_t newsize = fi->csize ? 2*fi->csize : 64;
+		off_t  *newpos;
+		size_t *newbyte;
+		newpos = safe_realloc(fi->checkpos, newsize*sizeof(off_t));
+		if(newpos == NULL) return -1;
+		fi->checkpos = newpos;
+		newbyte = safe_realloc(fi->checkbyte, newsize*sizeof(size_t));
+		if(newbyte == NULL) return -1;
+		fi->checkbyte = newbyte;
+		fi->csize = newsize;
+	}
+	/* A difference needs at most 10 bytes. */
+	if(fi->dsize - fi->dfill < 10)
+	{
+		size_t newsize = fi->dsize ? 2*fi->dsize : 4096;
+		unsigned char *newdeltas = safe_realloc(fi->deltas, newsize);
+		if(newdeltas == NULL) return -1;
+		fi->deltas = newdeltas;
+		fi->dsize  = newsize;
+	}
+	return 0;
+}
+
+void fi_add_full(struct frame_index *fi, off_t pos)
+{
+	if(fi_full_grow(fi)) return;
+
+	if(fi->frames % FI_FULL_CHECK == 0)
+	{
+		fi->checkpos[fi->frames/FI_FULL_CHECK]  = pos;
+		fi->checkbyte[fi->frames/FI_FULL_CHECK] = fi->dfill;
+		fi->lastsize = 0;
+	}
+	else
+	{
+		long size = (long)(pos - fi->lastpos);
+		long diff = size - fi->lastsize;
+		/* Zigzag: small differences of either sign give small numbers. */
+		unsigned long code = diff < 0 ? 2*(unsigned long)(-diff)-1 : 2*(unsigned long)diff;
+		while(code >= 0x80)
+		{
+			fi->deltas[fi->dfill++] = (unsigned char)(code | 0x80);
+			code >>= 7;
+		}
+		fi->deltas[fi->dfill++] = (unsigned char)code;
+		fi->lastsize = size;
+	}
+	fi->lastpos = pos;
+	++fi->frames;
+}
+
+off_t fi_full_pos(struct frame_index *fi, off_t num)
+{
+	size_t check = (size_t)(num/FI_FULL_CHECK);
+	const unsigned char *d = fi->deltas + fi->checkbyte[check];
+	off_t pos = fi->checkpos[check];
+	long size = 0;
+	off_t i;
+
+	for(i = num - (off_t)check*FI_FULL_CHECK; i > 0; --i)
+	{
+		unsigned long code = 0;
+		int shift = 0;
+		do
+		{
+			code |= (unsigned long)(*d & 0x7f) << shift;
+			shift += 7;
+		} while(*d++ & 0x80);
+		size += code & 1 ? -(long)((code+1)/2) : (long)(code/2);
+		pos  += size;
+	}
+	return pos;
 }
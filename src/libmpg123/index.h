@@ -15,6 +15,12 @@
 	In this manner we maintain a good resolution with the given
 	maximum index size while covering the whole stream.
 
+	Optionally, there is the full index on top, which keeps the position
+	of every frame. It stores the differences of successive frame sizes
+	as variable-length integers (one byte for constant bitrate, two for
+	most VBR) and an absolute position every FI_FULL_CHECK frames, so that
+	a lookup decodes a limited number of bytes.
+
 	copyright 2007-8 by the mpg123 project - free software under the terms of the LGPL 2.1
 	see COPYING and AUTHORS files in distribution or http://mpg123.org
 	initially written by Thomas Orgis
@@ -31,11 +37,26 @@ struct frame_index
 	size_t size; /* total number of possible entries */
 	size_t fill; /* number of used entries */
 	size_t grow_size; /* if > 0: index allowed to grow on need with these steps, instead of lowering resolution */
+	/* The full index. */
+	off_t  frames;      /* number of frames recorded, the next one to add */
+	off_t  lastpos;     /* position of the last recorded frame */
+	long   lastsize;    /* size of the frame before, 0 at a checkpoint */
+	unsigned char *deltas; /* coded size differences */
+	size_t dfill;       /* used bytes of deltas */
+	size_t dsize;       /* allocated bytes of deltas */
+	off_t  *checkpos;   /* position of every FI_FULL_CHECK-th frame */
+	size_t *checkbyte;  /* where its following differences start in deltas */
+	size_t csize;       /* allocated checkpoints */
 };
 
+/* Frames between absolute positions in the full index. */
+#define FI_FULL_CHECK 64
+
 /* The condition for a framenum to be appended to the index. 
   if(FI_NEXT(fr->index, fr->num)) fi_add(offset); */
 #define FI_NEXT(fi, framenum) ((fi).size && framenum == (fi).next)
+/* Same for the full index, which wants every frame in sequence. */
+#define FI_NEXT_FULL(fi, framenum) (framenum == (fi).frames)
 
 /* Initialize stuff, set things to zero and NULL... */
 void fi_init(struct frame_index *fi);
@@ -53,7 +74,15 @@ void fi_add(struct frame_index *fi, off_t pos);
 /* Replace the frame index */
 int fi_set(struct frame_index *fi, off_t *offsets, off_t step, size_t fill);
 
-/* Empty the index (setting fill=0 and step=1), but keep current size. */
+/* Empty the index (setting fill=0 and step=1), but keep current size.
+   The full index is emptied, too. */
 void fi_reset(struct frame_index *fi);
 
+/* Append the position of the next frame to the full index.
+   On allocation failure, the full index just stops growing. */
+void fi_add_full(struct frame_index *fi, off_t pos);
+
+/* Position of frame num < fi->frames from the full index. */
+off_t fi_full_pos(struct frame_index *fi, off_t num);
+
 #endif
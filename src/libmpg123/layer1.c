@@ -38,6 +38,9 @@ static int I_step_one(unsigned int balloc[], unsigned int scale_index[2][SBLIMIT
 {
 	unsigned int *ba=balloc;
 	unsigned int *sca = (unsigned int *) scale_index;
+	struct bitreader br;
+
+	bits_begin(fr, &br);
 
 	if(fr->stereo == 2)
 	{
@@ -45,122 +48,178 @@ static int I_step_one(unsigned int balloc[], unsigned int scale_index[2][SBLIMIT
 		int jsbound = fr->jsbound;
 		for(i=0;i<jsbound;i++)
 		{
-			*ba++ = getbits(fr, 4);
-			*ba++ = getbits(fr, 4);
+			*ba++ = bits_get(&br, 4);
+			*ba++ = bits_get(&br, 4);
 		}
-		for(i=jsbound;i<SBLIMIT;i++) *ba++ = getbits(fr, 4);
+		for(i=jsbound;i<SBLIMIT;i++) *ba++ = bits_get(&br, 4);
 
-		if(check_balloc(fr, balloc, ba)) return -1;
+		if(check_balloc(fr, balloc, ba))
+		{
+			bits_end(fr, &br);
+			return -1;
+		}
 
 		ba = balloc;
 
 		for(i=0;i<jsbound;i++)
 		{
 			if ((*ba++))
-				*sca++ = getbits(fr, 6);
+				*sca++ = bits_get(&br, 6);
 			if ((*ba++))
-				*sca++ = getbits(fr, 6);
+				*sca++ = bits_get(&br, 6);
 		}
 		for (i=jsbound;i<SBLIMIT;i++)
 		if((*ba++))
 		{
-			*sca++ =  getbits(fr, 6);
-			*sca++ =  getbits(fr, 6);
+			*sca++ =  bits_get(&br, 6);
+			*sca++ =  bits_get(&br, 6);
 		}
 	}
 	else
 	{
 		int i;
-		for(i=0;i<SBLIMIT;i++) *ba++ = getbits(fr, 4);
+		for(i=0;i<SBLIMIT;i++) *ba++ = bits_get(&br, 4);
 
-		if(check_balloc(fr, balloc, ba)) return -1;
+		if(check_balloc(fr, balloc, ba))
+		{
+			bits_end(fr, &br);
+			return -1;
+		}
 
 		ba = balloc;
 		for (i=0;i<SBLIMIT;i++)
 		if ((*ba++))
-		*sca++ = getbits(fr, 6);
+		*sca++ = bits_get(&br, 6);
 	}
 
+	bits_end(fr, &br);
 	return 0;
 }
 
-/* Something sane in place of undefined (-1)<<n. Well, not really. */
-#define MINUS_SHIFT(n) ( (int)(((unsigned int)-1)<<(n)) )
-
-static void I_step_two(real fraction[2][SBLIMIT],unsigned int balloc[2*SBLIMIT], unsigned int scale_index[2][SBLIMIT],mpg123_handle *fr)
+/* The scale factor multipliers stay the same for the whole frame, 0 for unallocated sub-bands. */
+static void I_step_factors(real factor[2][SBLIMIT], unsigned int balloc[2*SBLIMIT], unsigned int scale_index[2][SBLIMIT], mpg123_handle *fr)
 {
 	int i,n;
-	int smpb[2*SBLIMIT]; /* values: 0-65535 */
-	int *sample;
-	register unsigned int *ba;
+	register unsigned int *ba = balloc;
 	register unsigned int *sca = (unsigned int *) scale_index;
 
 	if(fr->stereo == 2)
 	{
 		int jsbound = fr->jsbound;
-		register real *f0 = fraction[0];
-		register real *f1 = fraction[1];
-		ba = balloc;
-		for(sample=smpb,i=0;i<jsbound;i++)
-		{
-			if((n = *ba++)) *sample++ = getbits(fr, n+1);
-
-			if((n = *ba++)) *sample++ = getbits(fr, n+1);
-		}
-		for(i=jsbound;i<SBLIMIT;i++) 
-		if((n = *ba++))
-		*sample++ = getbits(fr, n+1);
-
-		ba = balloc;
-		for(sample=smpb,i=0;i<jsbound;i++)
+		for(i=0;i<jsbound;i++)
 		{
-			if((n=*ba++))
-			*f0++ = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15(MINUS_SHIFT(n) + (*sample++) + 1), fr->muls[n+1][*sca++]);
-			else *f0++ = DOUBLE_TO_REAL(0.0);
-
-			if((n=*ba++))
-			*f1++ = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15(MINUS_SHIFT(n) + (*sample++) + 1), fr->muls[n+1][*sca++]);
-			else *f1++ = DOUBLE_TO_REAL(0.0);
+			factor[0][i] = (n=*ba++) ? fr->muls[n+1][*sca++] : DOUBLE_TO_REAL(0.0);
+			factor[1][i] = (n=*ba++) ? fr->muls[n+1][*sca++] : DOUBLE_TO_REAL(0.0);
 		}
 		for(i=jsbound;i<SBLIMIT;i++)
 		{
 			if((n=*ba++))
 			{
-				real samp = DOUBLE_TO_REAL_15(MINUS_SHIFT(n) + (*sample++) + 1);
-				*f0++ = REAL_MUL_SCALE_LAYER12(samp, fr->muls[n+1][*sca++]);
-				*f1++ = REAL_MUL_SCALE_LAYER12(samp, fr->muls[n+1][*sca++]);
+				factor[0][i] = fr->muls[n+1][*sca++];
+				factor[1][i] = fr->muls[n+1][*sca++];
 			}
-			else *f0++ = *f1++ = DOUBLE_TO_REAL(0.0);
+			else factor[0][i] = factor[1][i] = DOUBLE_TO_REAL(0.0);
 		}
-		for(i=fr->down_sample_sblimit;i<32;i++)
-		fraction[0][i] = fraction[1][i] = 0.0;
 	}
 	else
 	{
-		register real *f0 = fraction[0];
-		ba = balloc;
-		for(sample=smpb,i=0;i<SBLIMIT;i++)
-		if ((n = *ba++))
-		*sample++ = getbits(fr, n+1);
+		for(i=0;i<SBLIMIT;i++)
+		factor[0][i] = (n=*ba++) ? fr->muls[n+1][*sca++] : DOUBLE_TO_REAL(0.0);
+	}
+}
 
-		ba = balloc;
-		for(sample=smpb,i=0;i<SBLIMIT;i++)
+/* Something sane in place of undefined (-1)<<n. Well, not really. */
+#define MINUS_SHIFT(n) ( (int)(((unsigned int)-1)<<(n)) )
+
+/* Reads one sample per sub-band, the multiplication with the factor is opt_dequant_layer12(). */
+static void I_step_two(real fraction[2][SBLIMIT],unsigned int balloc[2*SBLIMIT], real factor[2][SBLIMIT],mpg123_handle *fr)
+{
+	int i,n;
+	int smpb[2][SBLIMIT];
+	int sblimit = fr->down_sample_sblimit;
+	register unsigned int *ba = balloc;
+	struct bitreader br;
+
+	bits_begin(fr, &br);
+
+	if(fr->stereo == 2)
+	{
+		int jsbound = fr->jsbound;
+		for(i=0;i<jsbound;i++)
 		{
-			if((n=*ba++))
-			*f0++ = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15(MINUS_SHIFT(n) + (*sample++) + 1), fr->muls[n+1][*sca++]);
-			else *f0++ = DOUBLE_TO_REAL(0.0);
+			smpb[0][i] = (n = *ba++) ? MINUS_SHIFT(n) + (int)bits_get(&br, n+1) + 1 : 0;
+			smpb[1][i] = (n = *ba++) ? MINUS_SHIFT(n) + (int)bits_get(&br, n+1) + 1 : 0;
 		}
-		for(i=fr->down_sample_sblimit;i<32;i++)
+		for(i=jsbound;i<SBLIMIT;i++) 
+		smpb[0][i] = smpb[1][i] = (n = *ba++) ? MINUS_SHIFT(n) + (int)bits_get(&br, n+1) + 1 : 0;
+		bits_end(fr, &br);
+
+		opt_dequant_layer12(fr)(fraction[0], smpb[0], factor[0], sblimit);
+		opt_dequant_layer12(fr)(fraction[1], smpb[1], factor[1], sblimit);
+		for(i=sblimit;i<32;i++)
+		fraction[0][i] = fraction[1][i] = 0.0;
+	}
+	else
+	{
+		for(i=0;i<SBLIMIT;i++)
+		smpb[0][i] = (n = *ba++) ? MINUS_SHIFT(n) + (int)bits_get(&br, n+1) + 1 : 0;
+		bits_end(fr, &br);
+
+		opt_dequant_layer12(fr)(fraction[0], smpb[0], factor[0], sblimit);
+		for(i=sblimit;i<32;i++)
 		fraction[0][i] = DOUBLE_TO_REAL(0.0);
 	}
 }
 
+/* Largest sample of the frame, from allocation and scalefactors. */
+static double I_bound(unsigned int balloc[2*SBLIMIT], unsigned int scale_index[2][SBLIMIT], mpg123_handle *fr)
+{
+	int i,n = 0;
+	unsigned int *ba = balloc;
+	unsigned int *sca = (unsigned int *) scale_index;
+	unsigned int min = 63; /* the multiplier for 63 is 0 */
+
+	if(fr->stereo == 2)
+	{
+		for(i=0;i<fr->jsbound;i++)
+		{
+			if(*ba++) ++n;
+			if(*ba++) ++n;
+		}
+		for(i=fr->jsbound;i<SBLIMIT;i++)
+		if(*ba++) n += 2;
+	}
+	else for(i=0;i<SBLIMIT;i++)
+	if(*ba++) ++n;
+
+	while(n--)
+	{
+		if(*sca < min) min = *sca;
+		++sca;
+	}
+	return min < 63 ? pow(2., 1.-min/3.) : 0.;
+}
+
+int silence_layer1(mpg123_handle *fr, double *bound)
+{
+	unsigned int balloc[2*SBLIMIT];
+	unsigned int scale_index[2][SBLIMIT];
+
+	fr->jsbound = (fr->mode == MPG_MD_JOINT_STEREO) ? (fr->mode_ext<<2)+4 : 32;
+	if(I_step_one(balloc,scale_index,fr))
+	return 0;
+
+	bound[0] = I_bound(balloc,scale_index,fr);
+	return 1;
+}
+
 int do_layer1(mpg123_handle *fr)
 {
 	int clip=0;
 	int i,stereo = fr->stereo;
 	unsigned int balloc[2*SBLIMIT];
 	unsigned int scale_index[2][SBLIMIT];
+	real factor[2][SBLIMIT];
 	real (*fraction)[SBLIMIT] = fr->layer1.fraction; /* fraction[2][SBLIMIT] */
 	int single = fr->single;
 
@@ -174,10 +233,15 @@ int do_layer1(mpg123_handle *fr)
 		if(NOQUIET) error("Aborting layer I decoding after step one.\n");
 		return clip;
 	}
+	/* Nothing in the frame comes after the samples, no need to read them. */
+	if(silence_block(fr, I_bound(balloc,scale_index,fr), SCALE_BLOCK))
+	return clip;
+
+	I_step_factors(factor,balloc,scale_index,fr);
 
 	for(i=0;i<SCALE_BLOCK;i++)
 	{
-		I_step_two(fraction,balloc,scale_index,fr);
+		I_step_two(fraction,balloc,factor,fr);
 
 		if(single != SINGLE_STEREO)
 		clip += (fr->synth_mono)(fraction[single], fr);
@@ -36,6 +36,12 @@ static const double mulmul[27] =
 };
 #endif
 
+/* Scale factor multipliers, shared by all handles. The last entry of each row is zero. */
+static real muls[27][64];
+#ifdef OPT_MMXORSSE
+static real muls_mmx[27][64];
+#endif
+
 void init_layer12(void)
 {
 	const int base[3][9] =
@@ -62,51 +68,48 @@ void init_layer12(void)
 			*itable++ = base[i][j];
 		}
 	}
-}
 
-void init_layer12_stuff(mpg123_handle *fr, real* (*init_table)(mpg123_handle *fr, real *table, int m))
-{
-	int k;
-	real *table;
 	for(k=0;k<27;k++)
 	{
-		table = init_table(fr, fr->muls[k], k);
-		*table++ = 0.0;
-	}
-}
-
-real* init_layer12_table(mpg123_handle *fr, real *table, int m)
-{
 #if defined(REAL_IS_FIXED) && defined(PRECALC_TABLES)
-	int i;
-	for(i=0;i<63;i++)
-	*table++ = layer12_table[m][i];
+		for(i=0;i<63;i++)
+		muls[k][i] = layer12_table[k][i];
 #else
-	int i,j;
-	for(j=3,i=0;i<63;i++,j--)
-	*table++ = DOUBLE_TO_REAL_SCALE_LAYER12(mulmul[m] * pow(2.0,(double) j / 3.0));
+		for(j=3,i=0;i<63;i++,j--)
+		muls[k][i] = DOUBLE_TO_REAL_SCALE_LAYER12(mulmul[k] * pow(2.0,(double) j / 3.0));
 #endif
-
-	return table;
-}
-
+		muls[k][63] = 0.0;
+	}
 #ifdef OPT_MMXORSSE
-real* init_layer12_table_mmx(mpg123_handle *fr, real *table, int m)
-{
-	int i,j;
-	if(!fr->p.down_sample) 
+	for(k=0;k<27;k++)
 	{
 		for(j=3,i=0;i<63;i++,j--)
-			*table++ = DOUBLE_TO_REAL(16384 * mulmul[m] * pow(2.0,(double) j / 3.0));
+		muls_mmx[k][i] = DOUBLE_TO_REAL(16384 * mulmul[k] * pow(2.0,(double) j / 3.0));
+		muls_mmx[k][63] = 0.0;
 	}
-	else
+#endif
+}
+
+void init_layer12_stuff(mpg123_handle *fr, int mmx)
+{
+#ifdef OPT_MMXORSSE
+	/* Without the 16384 scale, the mmx values are the plain ones. */
+	if(mmx && !fr->p.down_sample)
 	{
-		for(j=3,i=0;i<63;i++,j--)
-		*table++ = DOUBLE_TO_REAL(mulmul[m] * pow(2.0,(double) j / 3.0));
+		fr->muls = muls_mmx;
+		return;
 	}
-	return table;
-}
 #endif
+	fr->muls = muls;
+}
+
+/* The last step of layer I/II dequantization, also in SIMD versions via opt_dequant_layer12(). */
+void dequant_layer12(real *fraction, const int *sample, const real *factor, int n)
+{
+	int i;
+	for(i=0;i<n;i++)
+	fraction[i] = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15(sample[i]), factor[i]);
+}
 
 #endif /* NO_LAYER12 */
 
@@ -125,20 +128,24 @@ static void II_step_one(unsigned int *bit_alloc,int *scale,mpg123_handle *fr)
 	unsigned int scfsi_buf[64];
 	unsigned int *scfsi,*bita;
 	int sc,step;
+	struct bitreader br;
 
+	/* All with the check for the end of the frame: what lies behind a damaged
+	   frame differs between a copied body and one decoded in place. */
+	bits_begin(fr, &br);
 	bita = bit_alloc;
 	if(stereo)
 	{
 		for(i=jsbound;i;i--,alloc1+=(1<<step))
 		{
 			step=alloc1->bits;
-			*bita++ = (char) getbits(fr, step);
-			*bita++ = (char) getbits(fr, step);
+			*bita++ = (char) bits_get(&br, step);
+			*bita++ = (char) bits_get(&br, step);
 		}
 		for(i=sblimit-jsbound;i;i--,alloc1+=(1<<step))
 		{
 			step=alloc1->bits;
-			bita[0] = (char) getbits(fr, step);
+			bita[0] = (char) bits_get(&br, step);
 			bita[1] = bita[0];
 			bita+=2;
 		}
@@ -146,19 +153,19 @@ static void II_step_one(unsigned int *bit_alloc,int *scale,mpg123_handle *fr)
 		scfsi=scfsi_buf;
 
 		for(i=sblimit2;i;i--)
-		if(*bita++) *scfsi++ = (char) getbits_fast(fr, 2);
+		if(*bita++) *scfsi++ = (char) bits_get(&br, 2);
 	}
 	else /* mono */
 	{
 		for(i=sblimit;i;i--,alloc1+=(1<<step))
 		{
 			step=alloc1->bits;
-			*bita++ = (char) getbits(fr, step);
+			*bita++ = (char) bits_get(&br, step);
 		}
 		bita = bit_alloc;
 		scfsi=scfsi_buf;
 		for(i=sblimit;i;i--)
-		if(*bita++) *scfsi++ = (char) getbits_fast(fr, 2);
+		if(*bita++) *scfsi++ = (char) bits_get(&br, 2);
 	}
 
 	bita = bit_alloc;
@@ -168,29 +175,36 @@ static void II_step_one(unsigned int *bit_alloc,int *scale,mpg123_handle *fr)
 	switch(*scfsi++)
 	{
 		case 0: 
-			*scale++ = getbits_fast(fr, 6);
-			*scale++ = getbits_fast(fr, 6);
-			*scale++ = getbits_fast(fr, 6);
+			*scale++ = bits_get(&br, 6);
+			*scale++ = bits_get(&br, 6);
+			*scale++ = bits_get(&br, 6);
 		break;
 		case 1 : 
-			*scale++ = sc = getbits_fast(fr, 6);
+			*scale++ = sc = bits_get(&br, 6);
 			*scale++ = sc;
-			*scale++ = getbits_fast(fr, 6);
+			*scale++ = bits_get(&br, 6);
 		break;
 		case 2: 
-			*scale++ = sc = getbits_fast(fr, 6);
+			*scale++ = sc = bits_get(&br, 6);
 			*scale++ = sc;
 			*scale++ = sc;
 		break;
 		default:              /* case 3 */
-			*scale++ = getbits_fast(fr, 6);
-			*scale++ = sc = getbits_fast(fr, 6);
+			*scale++ = bits_get(&br, 6);
+			*scale++ = sc = bits_get(&br, 6);
 			*scale++ = sc;
 		break;
 	}
+	bits_end(fr, &br);
 }
 
 
+/*
+	The bitstream is read into sample values and a factor for each of them,
+	then one opt_dequant_layer12() call per row does the multiplications.
+	Grouped quantization looks up the value in muls; it is stored as factor
+	with a sample of 1, which gives the same as REAL_SCALE_LAYER12() of it.
+*/
 static void II_step_two(unsigned int *bit_alloc,real fraction[2][4][SBLIMIT],int *scale,mpg123_handle *fr,int x1)
 {
 	int i,j,k,ba;
@@ -200,7 +214,11 @@ static void II_step_two(unsigned int *bit_alloc,real fraction[2][4][SBLIMIT],int
 	const struct al_table *alloc2,*alloc1 = fr->alloc;
 	unsigned int *bita=bit_alloc;
 	int d1,step;
+	int smp[2][3][SBLIMIT];
+	real fac[2][3][SBLIMIT];
+	struct bitreader br;
 
+	bits_begin(fr, &br);
 	for(i=0;i<jsbound;i++,alloc1+=(1<<step))
 	{
 		step = alloc1->bits;
@@ -212,24 +230,29 @@ static void II_step_two(unsigned int *bit_alloc,real fraction[2][4][SBLIMIT],int
 				if( (d1=alloc2->d) < 0) 
 				{
 					real cm=fr->muls[k][scale[x1]];
-					fraction[j][0][i] = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1), cm);
-					fraction[j][1][i] = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1), cm);
-					fraction[j][2][i] = REAL_MUL_SCALE_LAYER12(DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1), cm);
+					smp[j][0][i] = (int)bits_get(&br, k) + d1;
+					smp[j][1][i] = (int)bits_get(&br, k) + d1;
+					smp[j][2][i] = (int)bits_get(&br, k) + d1;
+					fac[j][0][i] = fac[j][1][i] = fac[j][2][i] = cm;
 				}        
 				else 
 				{
 					const int *table[] = { 0,0,0,grp_3tab,0,grp_5tab,0,0,0,grp_9tab };
 					unsigned int idx,*tab,m=scale[x1];
-					idx = (unsigned int) getbits(fr, k);
+					idx = (unsigned int) bits_get(&br, k);
 					tab = (unsigned int *) (table[d1] + idx + idx + idx);
-					fraction[j][0][i] = REAL_SCALE_LAYER12(fr->muls[*tab++][m]);
-					fraction[j][1][i] = REAL_SCALE_LAYER12(fr->muls[*tab++][m]);
-					fraction[j][2][i] = REAL_SCALE_LAYER12(fr->muls[*tab][m]);  
+					smp[j][0][i] = smp[j][1][i] = smp[j][2][i] = 1;
+					fac[j][0][i] = fr->muls[*tab++][m];
+					fac[j][1][i] = fr->muls[*tab++][m];
+					fac[j][2][i] = fr->muls[*tab][m];
 				}
 				scale+=3;
 			}
 			else
-			fraction[j][0][i] = fraction[j][1][i] = fraction[j][2][i] = DOUBLE_TO_REAL(0.0);
+			{
+				smp[j][0][i] = smp[j][1][i] = smp[j][2][i] = 0;
+				fac[j][0][i] = fac[j][1][i] = fac[j][2][i] = DOUBLE_TO_REAL(0.0);
+			}
 		}
 	}
 
@@ -242,36 +265,35 @@ static void II_step_two(unsigned int *bit_alloc,real fraction[2][4][SBLIMIT],int
 			k=(alloc2 = alloc1+ba)->bits;
 			if( (d1=alloc2->d) < 0)
 			{
-				real cm;
-				cm=fr->muls[k][scale[x1+3]];
-				fraction[0][0][i] = DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1);
-				fraction[0][1][i] = DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1);
-				fraction[0][2][i] = DOUBLE_TO_REAL_15((int)getbits(fr, k) + d1);
-				fraction[1][0][i] = REAL_MUL_SCALE_LAYER12(fraction[0][0][i], cm);
-				fraction[1][1][i] = REAL_MUL_SCALE_LAYER12(fraction[0][1][i], cm);
-				fraction[1][2][i] = REAL_MUL_SCALE_LAYER12(fraction[0][2][i], cm);
-				cm=fr->muls[k][scale[x1]];
-				fraction[0][0][i] = REAL_MUL_SCALE_LAYER12(fraction[0][0][i], cm);
-				fraction[0][1][i] = REAL_MUL_SCALE_LAYER12(fraction[0][1][i], cm);
-				fraction[0][2][i] = REAL_MUL_SCALE_LAYER12(fraction[0][2][i], cm);
+				real cm1 = fr->muls[k][scale[x1]];
+				real cm2 = fr->muls[k][scale[x1+3]];
+				smp[0][0][i] = smp[1][0][i] = (int)bits_get(&br, k) + d1;
+				smp[0][1][i] = smp[1][1][i] = (int)bits_get(&br, k) + d1;
+				smp[0][2][i] = smp[1][2][i] = (int)bits_get(&br, k) + d1;
+				fac[0][0][i] = fac[0][1][i] = fac[0][2][i] = cm1;
+				fac[1][0][i] = fac[1][1][i] = fac[1][2][i] = cm2;
 			}
 			else
 			{
 				const int *table[] = { 0,0,0,grp_3tab,0,grp_5tab,0,0,0,grp_9tab };
 				unsigned int idx,*tab,m1,m2;
 				m1 = scale[x1]; m2 = scale[x1+3];
-				idx = (unsigned int) getbits(fr, k);
+				idx = (unsigned int) bits_get(&br, k);
 				tab = (unsigned int *) (table[d1] + idx + idx + idx);
-				fraction[0][0][i] = REAL_SCALE_LAYER12(fr->muls[*tab][m1]); fraction[1][0][i] = REAL_SCALE_LAYER12(fr->muls[*tab++][m2]);
-				fraction[0][1][i] = REAL_SCALE_LAYER12(fr->muls[*tab][m1]); fraction[1][1][i] = REAL_SCALE_LAYER12(fr->muls[*tab++][m2]);
-				fraction[0][2][i] = REAL_SCALE_LAYER12(fr->muls[*tab][m1]); fraction[1][2][i] = REAL_SCALE_LAYER12(fr->muls[*tab][m2]);
+				smp[0][0][i] = smp[0][1][i] = smp[0][2][i] =
+				smp[1][0][i] = smp[1][1][i] = smp[1][2][i] = 1;
+				fac[0][0][i] = fr->muls[*tab][m1]; fac[1][0][i] = fr->muls[*tab++][m2];
+				fac[0][1][i] = fr->muls[*tab][m1]; fac[1][1][i] = fr->muls[*tab++][m2];
+				fac[0][2][i] = fr->muls[*tab][m1]; fac[1][2][i] = fr->muls[*tab][m2];
 			}
 			scale+=6;
 		}
 		else
 		{
-			fraction[0][0][i] = fraction[0][1][i] = fraction[0][2][i] =
-			fraction[1][0][i] = fraction[1][1][i] = fraction[1][2][i] = DOUBLE_TO_REAL(0.0);
+			smp[0][0][i] = smp[0][1][i] = smp[0][2][i] =
+			smp[1][0][i] = smp[1][1][i] = smp[1][2][i] = 0;
+			fac[0][0][i] = fac[0][1][i] = fac[0][2][i] =
+			fac[1][0][i] = fac[1][1][i] = fac[1][2][i] = DOUBLE_TO_REAL(0.0);
 		}
 /*
 	Historic comment...
@@ -283,10 +305,15 @@ static void II_step_two(unsigned int *bit_alloc,real fraction[2][4][SBLIMIT],int
 	-> changed .. now we use the scalefac values of channel one !! 
 */
 	}
+	bits_end(fr, &br);
 
 	if(sblimit > (fr->down_sample_sblimit) )
 	sblimit = fr->down_sample_sblimit;
 
+	for(j=0;j<stereo;j++)
+	for(k=0;k<3;k++)
+	opt_dequant_layer12(fr)(fraction[j][k], smp[j][k], fac[j][k], sblimit);
+
 	for(i=sblimit;i<SBLIMIT;i++)
 	for (j=0;j<stereo;j++)
 	fraction[j][0][i] = fraction[j][1][i] = fraction[j][2][i] = DOUBLE_TO_REAL(0.0);
@@ -326,6 +353,46 @@ static void II_select_table(mpg123_handle *fr)
 }
 
 
+/* Largest sample of each third of the frame, from allocation and scalefactors. */
+static void II_bounds(unsigned int *bit_alloc, int *scale, mpg123_handle *fr, double bound[3])
+{
+	int i,x1;
+	int min[3] = { 63, 63, 63 }; /* the multiplier for 63 is 0 */
+
+	for(i=fr->II_sblimit<<(fr->stereo-1);i;i--)
+	if(*bit_alloc++)
+	{
+		for(x1=0;x1<3;x1++)
+		if(scale[x1] < min[x1]) min[x1] = scale[x1];
+		scale += 3;
+	}
+	for(x1=0;x1<3;x1++)
+	bound[x1] = min[x1] < 63 ? pow(2., 1.-min[x1]/3.) : 0.;
+}
+
+static void II_setup(mpg123_handle *fr)
+{
+	II_select_table(fr);
+	fr->jsbound = (fr->mode == MPG_MD_JOINT_STEREO) ? (fr->mode_ext<<2)+4 : fr->II_sblimit;
+
+	if(fr->jsbound > fr->II_sblimit)
+	{
+		fprintf(stderr, "Truncating stereo boundary to sideband limit.\n");
+		fr->jsbound=fr->II_sblimit;
+	}
+}
+
+int silence_layer2(mpg123_handle *fr, double *bound)
+{
+	unsigned int bit_alloc[64];
+	int scale[192];
+
+	II_setup(fr);
+	II_step_one(bit_alloc, scale, fr);
+	II_bounds(bit_alloc, scale, fr, bound);
+	return 3;
+}
+
 int do_layer2(mpg123_handle *fr)
 {
 	int clip=0;
@@ -337,25 +404,24 @@ int do_layer2(mpg123_handle *fr)
 	unsigned int bit_alloc[64];
 	int scale[192];
 	int single = fr->single;
+	double bound[3];
+	int silent = FALSE;
 
-	II_select_table(fr);
-	fr->jsbound = (fr->mode == MPG_MD_JOINT_STEREO) ? (fr->mode_ext<<2)+4 : fr->II_sblimit;
-
-	if(fr->jsbound > fr->II_sblimit)
-	{
-		fprintf(stderr, "Truncating stereo boundary to sideband limit.\n");
-		fr->jsbound=fr->II_sblimit;
-	}
+	II_setup(fr);
 
 	/* TODO: What happens with mono mixing, actually? */
 	if(stereo == 1 || single == SINGLE_MIX) /* also, mix not really handled */
 	single = SINGLE_LEFT;
 
 	II_step_one(bit_alloc, scale, fr);
+	II_bounds(bit_alloc, scale, fr, bound);
 
 	for(i=0;i<SCALE_BLOCK;i++)
 	{
 		II_step_two(bit_alloc,fraction,scale,fr,i>>2);
+		/* Each scalefactor part of 4 rows, 12 slots, is one block. */
+		if(!(i&3)) silent = silence_block(fr, bound[i>>2], 12);
+		if(silent) continue;
 		for(j=0;j<3;j++) 
 		{
 			if(single != SINGLE_STEREO)
@@ -50,6 +50,10 @@ static real tan1_1[16],tan2_1[16],tan1_2[16],tan2_2[16];
 static real pow1_1[2][32],pow2_1[2][32],pow1_2[2][32],pow2_2[2][32];
 #endif
 #endif
+#ifdef opt_dct12
+/* Short block window for opt_dct12(), 4 sub-bands interleaved: win[2] and win1[2] alternating. */
+static ALIGNED(16) real win_sb4[12][4];
+#endif
 
 /* Decoder state data, living on the stack of do_layer3. */
 
@@ -71,8 +75,8 @@ struct gr_info_s
 	unsigned preflag;
 	unsigned scalefac_scale;
 	unsigned count1table_select;
-	real *full_gain[3];
-	real *pow2gain;
+	const real *full_gain[3];
+	const real *pow2gain;
 };
 
 struct III_sideinfo
@@ -159,31 +163,287 @@ static int *mapend[9][3];
 static unsigned int n_slen2[512]; /* MPEG 2.0 slen for 'normal' mode */
 static unsigned int i_slen2[256]; /* MPEG 2.0 slen for intensity stereo */
 
-/* Some helpers used in init_layer3 */
+/* Band limits in subbands, clamped to fr->down_sample_sblimit at the point of use. */
+static int longLimit[9][23];
+static int shortLimit[9][14];
+#define BAND_LIMIT(fr, lim) ((lim) > (fr)->down_sample_sblimit ? (unsigned int)(fr)->down_sample_sblimit : (unsigned int)(lim))
+/* Value pairs in decoding order below a subband limit, for mixed and short blocks. */
+static short limitPairs[9][2][SBLIMIT+1];
 
+/* Global gain factors, shared by all handles. The mmx-like decoders want
+   them scaled up for full-rate synthesis, otherwise the plain table is used. */
+#define GAINPOW2_LAST (256+118+4-1)
+#if !defined(REAL_IS_FIXED) || !defined(PRECALC_TABLES)
+static real gainpow2_tab[256+118+4];
+#else
+#define gainpow2_tab gainpow2
+#endif
 #ifdef OPT_MMXORSSE
-real init_layer3_gainpow2_mmx(mpg123_handle *fr, int i)
+static real gainpow2_mmx_tab[256+118+4];
+#endif
+
+/*
+	Multi-symbol Huffman decoding (see III_dequantize_sample()).
+	The code trees are flattened into lookup tables indexed by the next bits of
+	the stream. A big_values entry gives a complete value pair including the
+	sign bits, or two pairs if both fit into the lookup bits. Codes longer than
+	the first level go through a second level table. Pairs with linbits or with
+	signs beyond the lookup bits are marked to read the rest bit by bit.
+	A count1 entry gives all four values of a quadruple, with signs.
+*/
+#define HUFF_BITS    9 /* big_values lookup bits, at most */
+#define HUFF_C1_BITS 10 /* count1: 6 bits code plus 4 signs */
+#define HUFF_SPACE   10240 /* entries of all big_values tables, 9808 needed with 9 bits */
+
+/* big_values entry:
+   bits  0- 4: bits used by first pair (second level: from start of first level)
+   bits  5- 9: bits used by both pairs, 0 if there is only one
+   bit     10: escape or signs not included, read those after the code
+   bit     11: second level table, offset in bits 12-31, index bits in 0-4
+   bits 12-31: four values plus 15, x and y of first pair, then second pair */
+#define HUFF_LEN(e)    ((e) & 0x1f)
+#define HUFF_LEN2(e)   (((e)>>5) & 0x1f)
+#define HUFF_SLOW      0x400
+#define HUFF_SUB       0x800
+#define HUFF_VAL(e, n) ((int)(((e)>>(12+5*(n))) & 0x1f) - 15)
+#define HUFF_POW(e, n) ispow_signed[((e)>>(12+5*(n))) & 0x1f]
+#define HUFF_PAIR(e)   (((e)>>12) & 0x3ff)
+#define HUFF_ZERO      (15|(15<<5)) /* HUFF_PAIR() of a zero pair */
+
+/* count1 entry:
+   bits  0- 3: bits used including signs
+   bits  4-11: 2 bits per value (0: zero, 1: positive, 2: negative), first value on top
+   bits 12-14: bits of the code alone */
+#define HUFF_C1_LEN(e)  ((e) & 0xf)
+#define HUFF_C1_VAL(e, n) (((e)>>(10-2*(n))) & 0x3)
+#define HUFF_C1_CODE(e) (((e)>>12) & 0x7)
+
+struct huffmulti
+{
+	int bits; /* first level index bits */
+	const uint32_t *table;
+};
+
+static uint32_t huffmulti_space[HUFF_SPACE];
+static unsigned short huffmulti_c1[2][1<<HUFF_C1_BITS];
+static struct huffmulti huffmulti[32];
+/* Signed value to pow(|value|, 4/3) with sign, for the values in table entries. */
+static real ispow_signed[31];
+/* Set if the tables could not be built, then the tree decoder is used. */
+static int huffmulti_broken = 1;
+
+struct huffcode
+{
+	unsigned int code;
+	int len;
+	int val; /* x<<4|y, or the count1 quadruple */
+};
+
+#ifdef USE_NEW_HUFFTABLE
+/* Collect the codes from a radix-4 table ... */
+static int huff_codes_radix4(const short *table, unsigned int code, int len, struct huffcode *c, int n)
 {
-	if(!fr->p.down_sample) return DOUBLE_TO_REAL(16384.0 * pow((double)2.0,-0.25 * (double) (i+210) ));
-	else return DOUBLE_TO_REAL(pow((double)2.0,-0.25 * (double) (i+210)));
+	int i;
+	for(i=0;i<16;i++)
+	{
+		short y = table[i];
+		if(y < 0) n = huff_codes_radix4(table-y, (code<<4)|i, len+4, c, n);
+		else
+		{
+			int l = y>>8;
+			/* The entry is repeated for the bits after a short code. */
+			if(i & ((1<<(4-l))-1)) continue;
+			c[n].code = (code<<l)|(i>>(4-l));
+			c[n].len  = len+l;
+			c[n].val  = y & 0xff;
+			++n;
+		}
+	}
+	return n;
 }
 #endif
 
-real init_layer3_gainpow2(mpg123_handle *fr, int i)
+/* ... or a binary tree as in huffman.h, also used for count1. */
+static int huff_codes_tree(const short *table, unsigned int code, int len, struct huffcode *c, int n)
+{
+	short y = *table;
+	if(y >= 0)
+	{
+		c[n].code = code;
+		c[n].len  = len;
+		c[n].val  = y;
+		return n+1;
+	}
+	n = huff_codes_tree(table+1, code<<1, len+1, c, n);
+	return huff_codes_tree(table+1-y, (code<<1)|1, len+1, c, n);
+}
+
+/* Entry for a single pair with code c, idx holding the next bits after the code
+   (left-aligned in room bits). */
+static uint32_t huff_pair_entry(const struct huffcode *c, int esc, unsigned int idx, int room)
+{
+	int x = c->val>>4;
+	int y = c->val & 0xf;
+	int signs = (x != 0) + (y != 0);
+	if((esc && (x == 15 || y == 15)) || signs > room)
+		return (uint32_t)c->len | HUFF_SLOW | (uint32_t)(x+15)<<12 | (uint32_t)(y+15)<<17;
+	if(x && (idx>>--room & 1)) x = -x;
+	if(y && (idx>>--room & 1)) y = -y;
+	return (uint32_t)(c->len+signs) | (uint32_t)(x+15)<<12 | (uint32_t)(y+15)<<17;
+}
+
+static int init_huffmulti_table(const short *table, int esc, uint32_t *space, int spacefill, struct huffmulti *hm)
 {
-#if defined(REAL_IS_FIXED) && defined(PRECALC_TABLES)
-	return gainpow2[i+256];
+	struct huffcode codes[256];
+	uint32_t *t = space+spacefill;
+	int ncodes, maxlen, bits, i, j;
+
+#ifdef USE_NEW_HUFFTABLE
+	ncodes = huff_codes_radix4(table, 0, 0, codes, 0);
 #else
-	return DOUBLE_TO_REAL_SCALE_LAYER3(pow((double)2.0,-0.25 * (double) (i+210)),i+256);
+	ncodes = huff_codes_tree(table, 0, 0, codes, 0);
 #endif
+	for(maxlen=0, i=0; i<ncodes; ++i)
+		if(codes[i].len > maxlen) maxlen = codes[i].len;
+	/* Enough bits for two pairs with signs, but not more. */
+	bits = 2*(maxlen+2) < HUFF_BITS ? 2*(maxlen+2) : HUFF_BITS;
+	if(spacefill + (1<<bits) > HUFF_SPACE) return -1;
+	spacefill += 1<<bits;
+	for(i=0; i<(1<<bits); ++i) t[i] = 0;
+
+	/* First level. */
+	for(i=0; i<ncodes; ++i)
+	{
+		const struct huffcode *c = codes+i;
+		int room = bits - c->len;
+		if(room < 0) continue;
+		for(j=0; j<(1<<room); ++j)
+			t[(c->code<<room)|j] = huff_pair_entry(c, esc, j, room);
+	}
+	/* Second level for the long codes, sized for the longest code behind each prefix. */
+	for(i=0; i<ncodes; ++i)
+	{
+		const struct huffcode *c = codes+i;
+		unsigned int prefix;
+		int k, sub;
+		uint32_t *st;
+		if(c->len <= bits) continue;
+		prefix = c->code >> (c->len-bits);
+		if(t[prefix] & HUFF_SUB) continue;
+		for(sub=0, k=0; k<ncodes; ++k)
+			if(codes[k].len > bits && codes[k].code >> (codes[k].len-bits) == prefix
+			  && codes[k].len-bits > sub )
+				sub = codes[k].len-bits;
+		if(spacefill + (1<<sub) > HUFF_SPACE || spacefill-(int)(t-space) >= 1<<20)
+			return -1;
+		st = space+spacefill;
+		t[prefix] = (uint32_t)sub | HUFF_SUB | (uint32_t)(spacefill-(int)(t-space))<<12;
+		spacefill += 1<<sub;
+		for(k=0; k<ncodes; ++k)
+		{
+			const struct huffcode *d = codes+k;
+			int room = bits+sub - d->len;
+			if(d->len <= bits || d->code >> (d->len-bits) != prefix) continue;
+			for(j=0; j<(1<<room); ++j)
+				st[((d->code<<room)|j) & ((1<<sub)-1)] = huff_pair_entry(d, esc, j, room);
+		}
+	}
+	/* A second pair behind the first one, if the lookup bits cover it. */
+	for(i=0; i<(1<<bits); ++i)
+	{
+		uint32_t e = t[i];
+		uint32_t f;
+		int len;
+		if(e & (HUFF_SLOW|HUFF_SUB)) continue;
+		len = HUFF_LEN(e);
+		f = t[(i<<len) & ((1<<bits)-1)];
+		if(f & (HUFF_SLOW|HUFF_SUB) || HUFF_LEN(f) > bits-len) continue;
+		t[i] = (e & 0x1f) | (uint32_t)(len+HUFF_LEN(f))<<5 | (e & 0x3ff000)
+		|	(f & 0x3ff000)<<10;
+	}
+	hm->bits  = bits;
+	hm->table = t;
+	return spacefill;
 }
 
+static void init_huffmulti_c1(const short *table, unsigned short *t)
+{
+	struct huffcode codes[16];
+	int ncodes, i, j;
+
+	ncodes = huff_codes_tree(table, 0, 0, codes, 0);
+	for(i=0; i<ncodes; ++i)
+	{
+		const struct huffcode *c = codes+i;
+		int room = HUFF_C1_BITS - c->len;
+		for(j=0; j<(1<<room); ++j)
+		{
+			int k, r = room;
+			unsigned short e = c->len<<12;
+			for(k=0; k<4; ++k)
+			{
+				int v = 0;
+				if(c->val & (0x8>>k)) v = (j>>--r & 1) ? 2 : 1;
+				e |= v<<(10-2*k);
+			}
+			t[(c->code<<room)|j] = e | (HUFF_C1_BITS-r);
+		}
+	}
+}
+
+static void init_huffmulti(void)
+{
+	int i, j, fill = 0;
+
+	for(i=0; i<31; ++i)
+		ispow_signed[i] = i < 15 ? -ispow[15-i] : ispow[i-15];
+	for(i=0; i<32; ++i)
+	{
+		/* Tables are shared between different linbits, these share the flat tables, too. */
+		for(j=0; j<i; ++j)
+		{
+			if(ht[j].table == ht[i].table)
+			{
+				huffmulti[i] = huffmulti[j];
+				break;
+			}
+		}
+		if(j < i) continue;
+		fill = init_huffmulti_table(ht[i].table, ht[i].linbits > 0, huffmulti_space, fill, huffmulti+i);
+		if(fill < 0)
+		{
+			error("Huffman lookup tables do not fit, falling back to tree decoding.");
+			return;
+		}
+	}
+	for(i=0; i<2; ++i)
+		init_huffmulti_c1(htc[i].table, huffmulti_c1[i]);
+	debug1("Huffman lookup tables: %i entries", fill);
+	huffmulti_broken = 0;
+}
 
 /* init tables for layer-3 ... specific with the downsampling... */
 void init_layer3(void)
 {
 	int i,j,k,l;
 
+#if !defined(REAL_IS_FIXED) || !defined(PRECALC_TABLES)
+	for(i=-256;i<118+4;i++)
+	gainpow2_tab[i+256] = DOUBLE_TO_REAL_SCALE_LAYER3(pow((double)2.0,-0.25 * (double) (i+210)),i+256);
+#endif
+#ifdef OPT_MMXORSSE
+	for(i=-256;i<118+4;i++)
+	gainpow2_mmx_tab[i+256] = DOUBLE_TO_REAL(16384.0 * pow((double)2.0,-0.25 * (double) (i+210)));
+#endif
+
+	for(j=0;j<9;j++)
+	{
+		for(i=0;i<23;i++)
+		longLimit[j][i] = (bandInfo[j].longIdx[i] - 1 + 8) / 18 + 1;
+		for(i=0;i<14;i++)
+		shortLimit[j][i] = (bandInfo[j].shortIdx[i] - 1) / 18 + 1;
+	}
+
 #if !defined(REAL_IS_FIXED) || !defined(PRECALC_TABLES)
 	for(i=0;i<8207;i++)
 	ispow[i] = DOUBLE_TO_REAL_POW43(pow((double)i,(double)4.0/3.0));
@@ -273,6 +533,11 @@ void init_layer3(void)
 
 		for(i=1;i<len[j];i+=2) win1[j][i] = - win[j][i];
 	}
+#ifdef opt_dct12
+	for(i=0;i<12;i++)
+	for(j=0;j<4;j++)
+	win_sb4[i][j] = j & 1 ? win1[2][i] : win[2][i];
+#endif
 
 	for(j=0;j<9;j++)
 	{
@@ -331,6 +596,15 @@ void init_layer3(void)
 			*mp++ = cb;
 		}
 		mapend[j][2] = mp;
+
+		for(k=0;k<2;k++)
+		for(l=0;l<=SBLIMIT;l++)
+		{
+			short pairs = 0;
+			for(mp = map[j][k]; mp < mapend[j][k] && mp[1] < l*SSLIMIT; mp += 4)
+				pairs += mp[0];
+			limitPairs[j][k][l] = pairs;
+		}
 	}
 
 	/* Now for some serious loopings! */
@@ -370,30 +644,22 @@ void init_layer3(void)
 		int n = k + j * 4 + i * 20;
 		n_slen2[n+400] = i|(j<<3)|(k<<6)|(1<<12);
 	}
+
+	init_huffmulti();
 }
 
 
-void init_layer3_stuff(mpg123_handle *fr, real (*gainpow2)(mpg123_handle *fr, int i))
+void init_layer3_stuff(mpg123_handle *fr, int mmx)
 {
-	int i,j;
-
-	for(i=-256;i<118+4;i++)	fr->gainpow2[i+256] = gainpow2(fr,i);
-
-	for(j=0;j<9;j++)
+#ifdef OPT_MMXORSSE
+	/* Without the 16384 scale, the mmx values are the plain ones. */
+	if(mmx && !fr->p.down_sample)
 	{
-		for(i=0;i<23;i++)
-		{
-			fr->longLimit[j][i] = (bandInfo[j].longIdx[i] - 1 + 8) / 18 + 1;
-			if(fr->longLimit[j][i] > (fr->down_sample_sblimit) )
-			fr->longLimit[j][i] = fr->down_sample_sblimit;
-		}
-		for(i=0;i<14;i++)
-		{
-			fr->shortLimit[j][i] = (bandInfo[j].shortIdx[i] - 1) / 18 + 1;
-			if(fr->shortLimit[j][i] > (fr->down_sample_sblimit) )
-			fr->shortLimit[j][i] = fr->down_sample_sblimit;
-		}
+		fr->gainpow2 = gainpow2_mmx_tab;
+		return;
 	}
+#endif
+	fr->gainpow2 = gainpow2_tab;
 }
 
 /*
@@ -405,6 +671,7 @@ void init_layer3_stuff(mpg123_handle *fr, real (*gainpow2)(mpg123_handle *fr, in
 static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int stereo, int ms_stereo,long sfreq,int single)
 {
 	int ch, gr;
+	struct bitreader br;
 	int powdiff = (single == SINGLE_MIX) ? 4 : 0;
 
 	const int tabs[2][5] = { { 2,9,5,3,4 } , { 1,8,1,2,9 } };
@@ -441,16 +708,17 @@ static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int ster
 	fr->bitreservoir = (fr->lsf == 0 ? 511 : 255);
 
 	/* Now back into less commented territory. It's code. It works. */
+	bits_begin(fr, &br);
 
 	if (stereo == 1)
-	si->private_bits = getbits_fast(fr, tab[2]);
+	si->private_bits = bits_get_fast(&br, tab[2]);
 	else 
-	si->private_bits = getbits_fast(fr, tab[3]);
+	si->private_bits = bits_get_fast(&br, tab[3]);
 
 	if(!fr->lsf) for(ch=0; ch<stereo; ch++)
 	{
 		si->ch[ch].gr[0].scfsi = -1;
-		si->ch[ch].gr[1].scfsi = getbits_fast(fr, 4);
+		si->ch[ch].gr[1].scfsi = bits_get_fast(&br, 4);
 	}
 
 	for (gr=0; gr<tab[0]; gr++)
@@ -458,16 +726,16 @@ static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int ster
 	{
 		register struct gr_info_s *gr_info = &(si->ch[ch].gr[gr]);
 
-		gr_info->part2_3_length = getbits(fr, 12);
-		gr_info->big_values = getbits(fr, 9);
+		gr_info->part2_3_length = bits_get(&br, 12);
+		gr_info->big_values = bits_get(&br, 9);
 		if(gr_info->big_values > 288)
 		{
 			if(NOQUIET) error("big_values too large!");
 			gr_info->big_values = 288;
 		}
-		gr_info->pow2gain = fr->gainpow2+256 - getbits_fast(fr, 8) + powdiff;
+		gr_info->pow2gain = fr->gainpow2+256 - bits_get_fast(&br, 8) + powdiff;
 		if(ms_stereo) gr_info->pow2gain += 2;
-		gr_info->scalefac_compress = getbits(fr, tab[4]);
+		gr_info->scalefac_compress = bits_get(&br, tab[4]);
 		if(gr_info->part2_3_length == 0)
 		{
 			if(gr_info->scalefac_compress > 0)
@@ -476,24 +744,25 @@ static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int ster
 			gr_info->scalefac_compress = 0;
 		}
 
-		if(get1bit(fr))
+		if(bits_get1(&br))
 		{ /* window switch flag  */
 			int i;
-			gr_info->block_type       = getbits_fast(fr, 2);
-			gr_info->mixed_block_flag = get1bit(fr);
-			gr_info->table_select[0]  = getbits_fast(fr, 5);
-			gr_info->table_select[1]  = getbits_fast(fr, 5);
+			gr_info->block_type       = bits_get_fast(&br, 2);
+			gr_info->mixed_block_flag = bits_get1(&br);
+			gr_info->table_select[0]  = bits_get_fast(&br, 5);
+			gr_info->table_select[1]  = bits_get_fast(&br, 5);
 			/*
 				table_select[2] not needed, because there is no region2,
 				but to satisfy some verification tools we set it either.
 			*/
 			gr_info->table_select[2] = 0;
 			for(i=0;i<3;i++)
-			gr_info->full_gain[i] = gr_info->pow2gain + (getbits_fast(fr, 3)<<3);
+			gr_info->full_gain[i] = gr_info->pow2gain + (bits_get_fast(&br, 3)<<3);
 
 			if(gr_info->block_type == 0)
 			{
 				if(NOQUIET) error("Blocktype == 0 and window-switching == 1 not allowed.");
+				bits_end(fr, &br);
 				return 1;
 			}
 
@@ -527,10 +796,10 @@ static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int ster
 		{
 			int i,r0c,r1c;
 			for (i=0; i<3; i++)
-			gr_info->table_select[i] = getbits_fast(fr, 5);
+			gr_info->table_select[i] = bits_get_fast(&br, 5);
 
-			r0c = getbits_fast(fr, 4); /* 0 .. 15 */
-			r1c = getbits_fast(fr, 3); /* 0 .. 7 */
+			r0c = bits_get_fast(&br, 4); /* 0 .. 15 */
+			r1c = bits_get_fast(&br, 3); /* 0 .. 7 */
 			gr_info->region1start = bandInfo[sfreq].longIdx[r0c+1] >> 1 ;
 
 			/* max(r0c+r1c+2) = 15+7+2 = 24 */
@@ -540,11 +809,12 @@ static int III_get_side_info(mpg123_handle *fr, struct III_sideinfo *si,int ster
 			gr_info->block_type = 0;
 			gr_info->mixed_block_flag = 0;
 		}
-		if(!fr->lsf) gr_info->preflag = get1bit(fr);
+		if(!fr->lsf) gr_info->preflag = bits_get1(&br);
 
-		gr_info->scalefac_scale = get1bit(fr);
-		gr_info->count1table_select = get1bit(fr);
+		gr_info->scalefac_scale = bits_get1(&br);
+		gr_info->count1table_select = bits_get1(&br);
 	}
+	bits_end(fr, &br);
 	return 0;
 }
 
@@ -560,6 +830,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 	int numbits;
 	int num0 = slen[0][gr_info->scalefac_compress];
 	int num1 = slen[1][gr_info->scalefac_compress];
+	struct bitreader br;
 
 	if(gr_info->part2_3_length == 0)
 	{
@@ -569,6 +840,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 		return 0;
 	}
 
+	bits_begin(fr, &br);
 	if(gr_info->block_type == 2)
 	{
 		int i=18;
@@ -577,15 +849,15 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 		if(gr_info->mixed_block_flag)
 		{
 			for (i=8;i;i--)
-			*scf++ = getbits_fast(fr, num0);
+			*scf++ = bits_get_fast(&br, num0);
 
 			i = 9;
 			numbits -= num0; /* num0 * 17 + num1 * 18 */
 		}
 
-		for(;i;i--) *scf++ = getbits_fast(fr, num0);
+		for(;i;i--) *scf++ = bits_get_fast(&br, num0);
 
-		for(i = 18; i; i--) *scf++ = getbits_fast(fr, num1);
+		for(i = 18; i; i--) *scf++ = bits_get_fast(&br, num1);
 
 		*scf++ = 0; *scf++ = 0; *scf++ = 0; /* short[13][0..2] = 0 */
 	}
@@ -596,9 +868,9 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 
 		if(scfsi < 0)
 		{ /* scfsi < 0 => granule == 0 */
-			for(i=11;i;i--) *scf++ = getbits_fast(fr, num0);
+			for(i=11;i;i--) *scf++ = bits_get_fast(&br, num0);
 
-			for(i=10;i;i--) *scf++ = getbits_fast(fr, num1);
+			for(i=10;i;i--) *scf++ = bits_get_fast(&br, num1);
 
 			numbits = (num0 + num1) * 10 + num0;
 			*scf++ = 0;
@@ -608,7 +880,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 			numbits = 0;
 			if(!(scfsi & 0x8))
 			{
-				for (i=0;i<6;i++) *scf++ = getbits_fast(fr, num0);
+				for (i=0;i<6;i++) *scf++ = bits_get_fast(&br, num0);
 
 				numbits += num0 * 6;
 			}
@@ -616,7 +888,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 
 			if(!(scfsi & 0x4))
 			{
-				for (i=0;i<5;i++) *scf++ = getbits_fast(fr, num0);
+				for (i=0;i<5;i++) *scf++ = bits_get_fast(&br, num0);
 
 				numbits += num0 * 5;
 			}
@@ -624,7 +896,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 
 			if(!(scfsi & 0x2))
 			{
-				for(i=0;i<5;i++) *scf++ = getbits_fast(fr, num1);
+				for(i=0;i<5;i++) *scf++ = bits_get_fast(&br, num1);
 
 				numbits += num1 * 5;
 			}
@@ -632,7 +904,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 
 			if(!(scfsi & 0x1))
 			{
-				for (i=0;i<5;i++) *scf++ = getbits_fast(fr, num1);
+				for (i=0;i<5;i++) *scf++ = bits_get_fast(&br, num1);
 
 				numbits += num1 * 5;
 			}
@@ -641,6 +913,7 @@ static int III_get_scale_factors_1(mpg123_handle *fr, int *scf,struct gr_info_s
 			*scf++ = 0;  /* no l[21] in original sources */
 		}
 	}
+	bits_end(fr, &br);
 	return numbits;
 }
 
@@ -650,6 +923,7 @@ static int III_get_scale_factors_2(mpg123_handle *fr, int *scf,struct gr_info_s
 	const unsigned char *pnt;
 	int i,j,n=0,numbits=0;
 	unsigned int slen;
+	struct bitreader br;
 
 	const unsigned char stab[3][6][4] =
 	{
@@ -691,13 +965,14 @@ static int III_get_scale_factors_2(mpg123_handle *fr, int *scf,struct gr_info_s
 		return 0;
 	}
 
+	bits_begin(fr, &br);
 	for(i=0;i<4;i++)
 	{
 		int num = slen & 0x7;
 		slen >>= 3;
 		if(num)
 		{
-			for(j=0;j<(int)(pnt[i]);j++) *scf++ = getbits_fast(fr, num);
+			for(j=0;j<(int)(pnt[i]);j++) *scf++ = bits_get_fast(&br, num);
 
 			numbits += pnt[i] * num;
 		}
@@ -708,6 +983,7 @@ static int III_get_scale_factors_2(mpg123_handle *fr, int *scf,struct gr_info_s
 	n = (n << 1) + 1;
 	for(i=0;i<n;i++) *scf++ = 0;
 
+	bits_end(fr, &br);
 	return numbits;
 }
 
@@ -717,44 +993,177 @@ static unsigned char pretab_choice[2][22] =
 	{0,0,0,0,0,0,0,0,0,0,0,1,1,1,1,2,2,3,3,3,2,0}
 };
 
+/*
+	Cut the Huffman regions down to what lies below sblimit. The skipped values
+	are left to the dismissal of remaining part 2/3 bits at the end.
+	III_hybrid() works on pairs of subbands, so an odd limit is rounded up.
+*/
+static void III_limit_regions(struct gr_info_s *gr_info, int sfreq, int sblimit, int *l, int *l3)
+{
+	int i;
+	int pairs;
+	sblimit = (sblimit+1) & ~1;
+	pairs = gr_info->block_type == 2
+	?	limitPairs[sfreq][gr_info->mixed_block_flag ? 0 : 1][sblimit]
+	:	sblimit*(SSLIMIT/2);
+	for(i=0;i<3;i++)
+	{
+		if(l[i] > pairs)
+			l[i] = pairs;
+		pairs -= l[i];
+	}
+	/* Each count1 quadruple covers two pairs. */
+	if(*l3 > (pairs+1)>>1)
+		*l3 = (pairs+1)>>1;
+}
+
+/*
+	The tree walk for one big_values pair or count1 quadruple, the reference
+	for the lookup tables (MPG123_TREE_HUFFMAN). 24 bits are enough, tab13
+	has a 19 bit code at most.
+*/
+static inline void huff_tree_pair(struct bitreader *br, const short *val, int *x, int *y)
+{
+	register short e;
+#ifdef USE_NEW_HUFFTABLE
+	while((e=val[bits_peek(br, 4)])<0)
+	{
+		val -= e;
+		bits_skip(br, 4);
+	}
+	bits_skip(br, e >> 8);
+	*x = (e >> 4) & 0xf;
+#else
+	while((e=*val++)<0)
+	{
+		if(br->cache>>63) val -= e;
+
+		bits_skip(br, 1);
+	}
+	*x = e >> 4;
+#endif
+	*y = e & 0xf;
+}
+
+static inline int huff_tree_c1(struct bitreader *br, const short *val)
+{
+	register short a;
+	while((a=*val++)<0)
+	{
+		if(br->cache>>63) val -= a;
+
+		bits_skip(br, 1);
+	}
+	return a;
+}
+
 /*
 	Dequantize samples
 	...includes Huffman decoding
+
+	The bits come from the cached bit reader (getbits.h). part2remain counts
+	the bits not yet in its cache. The symbols come from the lookup tables,
+	or from the tree walk. Values with linbits or with signs beyond the lookup
+	bits and a count1 quadruple that might be cut off at the end of the data
+	take the same bit by bit path as the tree walk.
 */
+#define HUFF_REFILL \
+	if(br.num < 32) \
+	{ \
+		part2remain += br.num; \
+		bits_refill(&br); \
+		part2remain -= br.num; \
+	}
+#define HUFF_SKIP(n) bits_skip(&br, n)
+#define HUFF_SIGN (br.cache>>63)
+
+/* Look up the entry for the next pair, resolving the second level. */
+#define HUFF_LOOKUP(e, hm) \
+	e = (hm)->table[br.cache>>(64-(hm)->bits)]; \
+	if(e & HUFF_SUB) \
+		e = (hm)->table[(e>>12) + (uint32_t)((br.cache<<(hm)->bits)>>(64-HUFF_LEN(e)))];
+
+/* Value of a slow pair: linbits and sign from the stream. */
+#define HUFF_SLOW_VALUE(x, dest, maxset) \
+	if(x == 15 && linbits) \
+	{ \
+		maxset; \
+		HUFF_REFILL; \
+		x += (int)bits_peek(&br, linbits); \
+		HUFF_SKIP(linbits); \
+		dest = REAL_MUL_SCALE_LAYER3(HUFF_SIGN ? -ispow[x] : ispow[x], v, gainpow2_scale_idx); \
+		HUFF_SKIP(1); \
+	} \
+	else if(x) \
+	{ \
+		maxset; \
+		dest = REAL_MUL_SCALE_LAYER3(HUFF_SIGN ? -ispow[x] : ispow[x], v, gainpow2_scale_idx); \
+		HUFF_SKIP(1); \
+	} \
+	else dest = DOUBLE_TO_REAL(0.0);
 
-/* 24 is enough because tab13 has max. a 19 bit huffvector */
-/* The old code played games with shifting signed integers around in not quite */
-/* legal ways. Also, it used long where just 32 bits are required. This could */
-/* be good or bad on 64 bit architectures ... anyway, making clear that */
-/* 32 bits suffice is a benefit. */
-#if 0
-/* To reconstruct old code, use this: */
-#define MASK_STYPE long
-#define MASK_UTYPE unsigned long
-#define MASK_TYPE MASK_STYPE
-#define MSB_MASK (mask < 0)
+#ifdef REAL_IS_FIXED
+#define III_SCALE_IDX(idx) \
+	gainpow2_scale_idx = (idx);
 #else
-/* This should be more proper: */
-#define MASK_STYPE int32_t
-#define MASK_UTYPE uint32_t
-#define MASK_TYPE  MASK_UTYPE
-#define MSB_MASK ((MASK_UTYPE)mask & (MASK_UTYPE)1<<(sizeof(MASK_TYPE)*8-1))
+#define III_SCALE_IDX(idx)
 #endif
-#define BITSHIFT ((sizeof(MASK_TYPE)-1)*8)
-#define REFRESH_MASK \
-	while(num < BITSHIFT) { \
-		mask |= ((MASK_UTYPE)getbyte(fr))<<(BITSHIFT-num); \
-		num += 8; \
-		part2remain -= 8; }
-/* Complicated way of checking for msb value. This used to be (mask < 0). */
-
-static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],int *scf, struct gr_info_s *gr_info,int sfreq,int part2bits)
+
+/* Gain factor of the next band. MPEG 2 intensity positions (up to 31) taken as
+   scalefactors point beyond the table, where the factor is far below anything
+   audible: such bands get the last entry. */
+#define III_BAND_GAIN(gain, sf) \
+	{ \
+		int gidx = (int)((gain) - fr->gainpow2) + ((sf) << shift); \
+		if(gidx > GAINPOW2_LAST) \
+			gidx = GAINPOW2_LAST; \
+		III_SCALE_IDX(gidx) \
+		v = fr->gainpow2[gidx]; \
+	}
+
+/* Enter the next band of a short or mixed block. */
+#define III_SHORT_BAND \
+	mc    = *m++; \
+	xrpnt = ((real *) xr) + (*m++); \
+	lwin  = *m++; \
+	cb    = *m++; \
+	if(lwin == 3) \
+	{ \
+		III_BAND_GAIN(gr_info->pow2gain, *scf++) \
+		step = 1; \
+	} \
+	else \
+	{ \
+		III_BAND_GAIN(gr_info->full_gain[lwin], *scf++) \
+		step = 3; \
+	}
+
+/* Enter the next band of a long block. */
+#ifdef CUT_SFB21
+#define III_LONG_BAND \
+	mc = *m++; \
+	cb = *m++; \
+	if(cb == 21) \
+		v = 0.0; \
+	else \
+		III_BAND_GAIN(gr_info->pow2gain, (*scf++) + (*pretab++))
+#else
+#define III_LONG_BAND \
+	mc = *m++; \
+	cb = *m++; \
+	III_BAND_GAIN(gr_info->pow2gain, (*scf++) + (*pretab++))
+#endif
+
+static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],int *scf, struct gr_info_s *gr_info,int sfreq,int part2bits,int sblimit)
 {
 	int shift = 1 + gr_info->scalefac_scale;
 	real *xrpnt = (real *) xr;
+	real *xrend = (real *) xr + SBLIMIT*SSLIMIT;
 	int l[3],l3;
 	int part2remain = gr_info->part2_3_length - part2bits;
 	int *me;
+	/* Both give the same result, the tree walk is the reference. */
+	int tree = huffmulti_broken || fr->p.flags & MPG123_TREE_HUFFMAN;
 #ifdef REAL_IS_FIXED
 	int gainpow2_scale_idx = 378;
 #endif
@@ -765,19 +1174,27 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 	if(gr_info->part2_3_length > 0)
 	{
 
-	/* mhipp tree has this split up a bit... */
-	int num=getbitoffset(fr);
-	MASK_TYPE mask;
-	/* We must split this, because for num==0 the shift is undefined if you do it in one step. */
-	mask  = ((MASK_UTYPE) getbits(fr, num))<<BITSHIFT;
-	mask <<= 8-num;
-	part2remain -= num;
+	struct bitreader br;
+	int stale = 0;
+	bits_begin(fr, &br);
+	if(fr->bitindex && fr->wordpointer >= br.end)
+	{
+		/* Beyond the end of the frame, getbits() returns zeros for the rest
+		   of the byte and the whole byte follows. Do the same.
+		   The bit index stays in place and is added again at the end. */
+		stale = fr->bitindex;
+		br.cache = 0;
+		br.num   = 8-fr->bitindex;
+		br.ptr   = fr->wordpointer;
+		bits_refill(&br);
+	}
+	part2remain -= br.num;
 
 	{
 		int bv       = gr_info->big_values;
 		int region1  = gr_info->region1start;
 		int region2  = gr_info->region2start;
-		l3 = ((576>>1)-bv)>>1;   
+		l3 = ((576>>1)-bv)>>1;
 
 		/* we may lose the 'odd' bit here !! check this later again */
 		if(bv <= region1)
@@ -800,12 +1217,14 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 				l[2] = bv - region2;
 			}
 		}
+		if(sblimit < SBLIMIT)
+			III_limit_regions(gr_info, sfreq, sblimit, l, &l3);
 	}
 
-#define CHECK_XRPNT if(xrpnt >= &xr[SBLIMIT][0]) \
+#define CHECK_XRPNT if(xrpnt >= xrend) \
 { \
 	if(NOQUIET) \
-		error2("attempted xrpnt overflow (%p !< %p)", (void*) xrpnt, (void*) &xr[SBLIMIT][0]); \
+		error2("attempted xrpnt overflow (%p !< %p)", (void*) xrpnt, (void*) xrend); \
 	return 1; \
 }
 
@@ -816,6 +1235,7 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 		int step=0,lwin=3,cb=0;
 		register real v = 0.0;
 		register int *m,mc;
+		real c1val[3];
 
 		if(gr_info->mixed_block_flag)
 		{
@@ -837,131 +1257,101 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 		{
 			int lp = l[i];
 			const struct newhuff *h = ht+gr_info->table_select[i];
-			for(;lp;lp--,mc--)
+			const struct huffmulti *hm = huffmulti+gr_info->table_select[i];
+			int linbits = h->linbits;
+			while(lp)
 			{
-				register MASK_STYPE x,y;
-				if( (!mc) )
+				uint32_t e;
+				int x,y;
+				if(!mc)
 				{
-					mc    = *m++;
-					xrpnt = ((real *) xr) + (*m++);
-					lwin  = *m++;
-					cb    = *m++;
-					if(lwin == 3)
-					{
-#ifdef REAL_IS_FIXED
-						gainpow2_scale_idx = (int)(gr_info->pow2gain + (*scf << shift) - fr->gainpow2);
-#endif
-						v = gr_info->pow2gain[(*scf++) << shift];
-						step = 1;
-					}
-					else
-					{
-#ifdef REAL_IS_FIXED
-						gainpow2_scale_idx = (int)(gr_info->full_gain[lwin] + (*scf << shift) - fr->gainpow2);
-#endif
-						v = gr_info->full_gain[lwin][(*scf++) << shift];
-						step = 3;
-					}
+					III_SHORT_BAND
 				}
+				HUFF_REFILL;
+				if(tree)
+					huff_tree_pair(&br, h->table, &x, &y);
+				else
 				{
-					const short *val = h->table;
-					REFRESH_MASK;
-#ifdef USE_NEW_HUFFTABLE
-					while((y=val[(MASK_UTYPE)mask>>(BITSHIFT+4)])<0)
+					HUFF_LOOKUP(e, hm);
+					if(!(e & HUFF_SLOW))
 					{
-						val -= y;
-						num -= 4;
-						mask <<= 4;
-					}
-					num -= (y >> 8);
-					mask <<= (y >> 8);
-					x = (y >> 4) & 0xf;
-					y &= 0xf;
-#else
-					while((y=*val++)<0)
-					{
-						if (MSB_MASK) val -= y;
-
-						num--;
-						mask <<= 1;
+						int pairs = (HUFF_LEN2(e) && lp > 1 && mc > 1) ? 2 : 1;
+						HUFF_SKIP(pairs > 1 ? HUFF_LEN2(e) : HUFF_LEN(e));
+						lp -= pairs;
+						mc -= pairs;
+						for(; pairs; --pairs)
+						{
+							CHECK_XRPNT;
+							*xrpnt = REAL_MUL_SCALE_LAYER3(HUFF_POW(e, 0), v, gainpow2_scale_idx);
+							xrpnt += step;
+							CHECK_XRPNT;
+							*xrpnt = REAL_MUL_SCALE_LAYER3(HUFF_POW(e, 1), v, gainpow2_scale_idx);
+							xrpnt += step;
+							if(HUFF_PAIR(e) != HUFF_ZERO) max[lwin] = cb;
+							e >>= 10;
+						}
+						continue;
 					}
-					x = y >> 4;
-					y &= 0xf;
-#endif
+					x = HUFF_VAL(e, 0);
+					y = HUFF_VAL(e, 1);
+					HUFF_SKIP(HUFF_LEN(e));
 				}
 				CHECK_XRPNT;
-				if(x == 15 && h->linbits)
-				{
-					max[lwin] = cb;
-					REFRESH_MASK;
-					x += ((MASK_UTYPE) mask) >> (BITSHIFT+8-h->linbits);
-					num -= h->linbits+1;
-					mask <<= h->linbits;
-					if(MSB_MASK) *xrpnt = REAL_MUL_SCALE_LAYER3(-ispow[x], v, gainpow2_scale_idx);
-					else         *xrpnt = REAL_MUL_SCALE_LAYER3( ispow[x], v, gainpow2_scale_idx);
-
-					mask <<= 1;
-				}
-				else if(x)
-				{
-					max[lwin] = cb;
-					if(MSB_MASK) *xrpnt = REAL_MUL_SCALE_LAYER3(-ispow[x], v, gainpow2_scale_idx);
-					else         *xrpnt = REAL_MUL_SCALE_LAYER3( ispow[x], v, gainpow2_scale_idx);
-
-					num--;
-					mask <<= 1;
-				}
-				else *xrpnt = DOUBLE_TO_REAL(0.0);
-
+				HUFF_SLOW_VALUE(x, *xrpnt, max[lwin] = cb)
 				xrpnt += step;
 				CHECK_XRPNT;
-				if(y == 15 && h->linbits)
-				{
-					max[lwin] = cb;
-					REFRESH_MASK;
-					y += ((MASK_UTYPE) mask) >> (BITSHIFT+8-h->linbits);
-					num -= h->linbits+1;
-					mask <<= h->linbits;
-					if(MSB_MASK) *xrpnt = REAL_MUL_SCALE_LAYER3(-ispow[y], v, gainpow2_scale_idx);
-					else         *xrpnt = REAL_MUL_SCALE_LAYER3( ispow[y], v, gainpow2_scale_idx);
-
-					mask <<= 1;
-				}
-				else if(y)
-				{
-					max[lwin] = cb;
-					if(MSB_MASK) *xrpnt = REAL_MUL_SCALE_LAYER3(-ispow[y], v, gainpow2_scale_idx);
-					else         *xrpnt = REAL_MUL_SCALE_LAYER3( ispow[y], v, gainpow2_scale_idx);
-
-					num--;
-					mask <<= 1;
-				}
-				else *xrpnt = DOUBLE_TO_REAL(0.0);
-
+				HUFF_SLOW_VALUE(y, *xrpnt, max[lwin] = cb)
 				xrpnt += step;
+				lp--;
+				mc--;
 			}
 		}
 
-		for(;l3 && (part2remain+num > 0);l3--)
+		/* The three possible values of count1 data in the current band. */
+		c1val[0] = DOUBLE_TO_REAL(0.0);
+		c1val[1] =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+		c1val[2] = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+		for(;l3 && (part2remain+br.num > 0);l3--)
 		{
-			const struct newhuff* h;
-			const short* val;
-			register short a;
+			int a;
 
-			h = htc+gr_info->count1table_select;
-			val = h->table;
-
-			REFRESH_MASK;
-			while((a=*val++)<0)
+			HUFF_REFILL;
+			if(tree)
+				a = huff_tree_c1(&br, htc[gr_info->count1table_select].table);
+			else
 			{
-				if(MSB_MASK) val -= a;
-
-				num--;
-				mask <<= 1;
+				unsigned short e = huffmulti_c1[gr_info->count1table_select][bits_peek(&br, HUFF_C1_BITS)];
+				if(part2remain+br.num > HUFF_C1_LEN(e))
+				{
+					/* All of it is there, no checks in between. */
+					HUFF_SKIP(HUFF_C1_LEN(e));
+					for(i=0;i<4;i+=2)
+					{
+						if(!mc)
+						{
+							III_SHORT_BAND
+							c1val[1] =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+							c1val[2] = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+						}
+						mc--;
+						CHECK_XRPNT;
+						*xrpnt = c1val[HUFF_C1_VAL(e, i)];
+						xrpnt += step;
+						CHECK_XRPNT;
+						*xrpnt = c1val[HUFF_C1_VAL(e, i+1)];
+						xrpnt += step;
+						if(HUFF_C1_VAL(e, i) | HUFF_C1_VAL(e, i+1)) max[lwin] = cb;
+					}
+					continue;
+				}
+				/* The end of the data: check each bit as the tree walk does. */
+				HUFF_SKIP(HUFF_C1_CODE(e));
+				a = 0;
+				for(i=0;i<4;i++) if(HUFF_C1_VAL(e, i)) a |= 0x8>>i;
 			}
-			if(part2remain+num <= 0)
+			if(part2remain+br.num <= 0)
 			{
-				num -= part2remain+num;
+				br.num -= part2remain+br.num;
 				break;
 			}
 
@@ -971,26 +1361,7 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 				{
 					if(!mc)
 					{
-						mc = *m++;
-						xrpnt = ((real *) xr) + (*m++);
-						lwin = *m++;
-						cb = *m++;
-						if(lwin == 3)
-						{
-#ifdef REAL_IS_FIXED
-							gainpow2_scale_idx = (int)(gr_info->pow2gain + (*scf << shift) - fr->gainpow2);
-#endif
-							v = gr_info->pow2gain[(*scf++) << shift];
-							step = 1;
-						}
-						else
-						{
-#ifdef REAL_IS_FIXED
-							gainpow2_scale_idx = (int)(gr_info->full_gain[lwin] + (*scf << shift) - fr->gainpow2);
-#endif
-							v = gr_info->full_gain[lwin][(*scf++) << shift];
-							step = 3;
-						}
+						III_SHORT_BAND
 					}
 					mc--;
 				}
@@ -998,14 +1369,13 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 				if( (a & (0x8>>i)) )
 				{
 					max[lwin] = cb;
-					if(part2remain+num <= 0)
+					if(part2remain+br.num <= 0)
 					break;
 
-					if(MSB_MASK) *xrpnt = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
-					else         *xrpnt =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+					if(HUFF_SIGN) *xrpnt = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+					else          *xrpnt =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
 
-					num--;
-					mask <<= 1;
+					HUFF_SKIP(1);
 				}
 				else *xrpnt = DOUBLE_TO_REAL(0.0);
 
@@ -1043,7 +1413,7 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 		{
 			int rmax = max[0] > max[1] ? max[0] : max[1];
 			rmax = (rmax > max[2] ? rmax : max[2]) + 1;
-			gr_info->maxb = rmax ? fr->shortLimit[sfreq][rmax] : fr->longLimit[sfreq][max[3]+1];
+			gr_info->maxb = rmax ? BAND_LIMIT(fr, shortLimit[sfreq][rmax]) : BAND_LIMIT(fr, longLimit[sfreq][max[3]+1]);
 		}
 
 	}
@@ -1056,127 +1426,103 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 		int *m = map[sfreq][2];
 		register real v = 0.0;
 		int mc = 0;
+		real c1val[3];
 
 		/* long hash table values */
 		for(i=0;i<3;i++)
 		{
 			int lp = l[i];
 			const struct newhuff *h = ht+gr_info->table_select[i];
+			const struct huffmulti *hm = huffmulti+gr_info->table_select[i];
+			int linbits = h->linbits;
 
-			for(;lp;lp--,mc--)
+			while(lp)
 			{
-				MASK_STYPE x,y;
+				uint32_t e;
+				int x,y;
 				if(!mc)
 				{
-					mc = *m++;
-					cb = *m++;
-#ifdef CUT_SFB21
-					if(cb == 21)
-						v = 0.0;
-					else
-#endif
-					{
-#ifdef REAL_IS_FIXED
-						gainpow2_scale_idx = (int)(gr_info->pow2gain + (*scf << shift) - fr->gainpow2);
-#endif
-						v = gr_info->pow2gain[(*(scf++) + (*pretab++)) << shift];
-					}
+					III_LONG_BAND
 				}
+				HUFF_REFILL;
+				if(tree)
+					huff_tree_pair(&br, h->table, &x, &y);
+				else
 				{
-					const short *val = h->table;
-					REFRESH_MASK;
-#ifdef USE_NEW_HUFFTABLE
-					while((y=val[(MASK_UTYPE)mask>>(BITSHIFT+4)])<0)
+					HUFF_LOOKUP(e, hm);
+					if(!(e & HUFF_SLOW))
 					{
-						val -= y;
-						num -= 4;
-						mask <<= 4;
-					}
-					num -= (y >> 8);
-					mask <<= (y >> 8);
-					x = (y >> 4) & 0xf;
-					y &= 0xf;
-#else
-					while((y=*val++)<0)
-					{
-						if (MSB_MASK) val -= y;
-
-						num--;
-						mask <<= 1;
+						int pairs = (HUFF_LEN2(e) && lp > 1 && mc > 1) ? 2 : 1;
+						HUFF_SKIP(pairs > 1 ? HUFF_LEN2(e) : HUFF_LEN(e));
+						lp -= pairs;
+						mc -= pairs;
+						for(; pairs; --pairs)
+						{
+							CHECK_XRPNT;
+							*xrpnt++ = REAL_MUL_SCALE_LAYER3(HUFF_POW(e, 0), v, gainpow2_scale_idx);
+							CHECK_XRPNT;
+							*xrpnt++ = REAL_MUL_SCALE_LAYER3(HUFF_POW(e, 1), v, gainpow2_scale_idx);
+							if(HUFF_PAIR(e) != HUFF_ZERO) max = cb;
+							e >>= 10;
+						}
+						continue;
 					}
-					x = y >> 4;
-					y &= 0xf;
-#endif
+					x = HUFF_VAL(e, 0);
+					y = HUFF_VAL(e, 1);
+					HUFF_SKIP(HUFF_LEN(e));
 				}
-
 				CHECK_XRPNT;
-				if(x == 15 && h->linbits)
-				{
-					max = cb;
-					REFRESH_MASK;
-					x += ((MASK_UTYPE) mask) >> (BITSHIFT+8-h->linbits);
-					num -= h->linbits+1;
-					mask <<= h->linbits;
-					if(MSB_MASK) *xrpnt++ = REAL_MUL_SCALE_LAYER3(-ispow[x], v, gainpow2_scale_idx);
-					else         *xrpnt++ = REAL_MUL_SCALE_LAYER3( ispow[x], v, gainpow2_scale_idx);
-
-					mask <<= 1;
-				}
-				else if(x)
-				{
-					max = cb;
-					if(MSB_MASK) *xrpnt++ = REAL_MUL_SCALE_LAYER3(-ispow[x], v, gainpow2_scale_idx);
-					else         *xrpnt++ = REAL_MUL_SCALE_LAYER3( ispow[x], v, gainpow2_scale_idx);
-					num--;
-
-					mask <<= 1;
-				}
-				else *xrpnt++ = DOUBLE_TO_REAL(0.0);
-
+				HUFF_SLOW_VALUE(x, *xrpnt, max = cb)
+				xrpnt++;
 				CHECK_XRPNT;
-				if(y == 15 && h->linbits)
-				{
-					max = cb;
-					REFRESH_MASK;
-					y += ((MASK_UTYPE) mask) >> (BITSHIFT+8-h->linbits);
-					num -= h->linbits+1;
-					mask <<= h->linbits;
-					if(MSB_MASK) *xrpnt++ = REAL_MUL_SCALE_LAYER3(-ispow[y], v, gainpow2_scale_idx);
-					else         *xrpnt++ = REAL_MUL_SCALE_LAYER3( ispow[y], v, gainpow2_scale_idx);
-
-					mask <<= 1;
-				}
-				else if(y)
-				{
-					max = cb;
-					if(MSB_MASK) *xrpnt++ = REAL_MUL_SCALE_LAYER3(-ispow[y], v, gainpow2_scale_idx);
-					else         *xrpnt++ = REAL_MUL_SCALE_LAYER3( ispow[y], v, gainpow2_scale_idx);
-
-					num--;
-					mask <<= 1;
-				}
-				else *xrpnt++ = DOUBLE_TO_REAL(0.0);
+				HUFF_SLOW_VALUE(y, *xrpnt, max = cb)
+				xrpnt++;
+				lp--;
+				mc--;
 			}
 		}
 
 		/* short (count1table) values */
-		for(;l3 && (part2remain+num > 0);l3--)
+		c1val[0] = DOUBLE_TO_REAL(0.0);
+		c1val[1] =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+		c1val[2] = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+		for(;l3 && (part2remain+br.num > 0);l3--)
 		{
-			const struct newhuff *h = htc+gr_info->count1table_select;
-			const short *val = h->table;
-			register short a;
+			int a;
 
-			REFRESH_MASK;
-			while((a=*val++)<0)
+			HUFF_REFILL;
+			if(tree)
+				a = huff_tree_c1(&br, htc[gr_info->count1table_select].table);
+			else
 			{
-				if (MSB_MASK) val -= a;
-
-				num--;
-				mask <<= 1;
+				unsigned short e = huffmulti_c1[gr_info->count1table_select][bits_peek(&br, HUFF_C1_BITS)];
+				if(part2remain+br.num > HUFF_C1_LEN(e))
+				{
+					HUFF_SKIP(HUFF_C1_LEN(e));
+					for(i=0;i<4;i+=2)
+					{
+						if(!mc)
+						{
+							III_LONG_BAND
+							c1val[1] =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+							c1val[2] = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+						}
+						mc--;
+						CHECK_XRPNT;
+						*xrpnt++ = c1val[HUFF_C1_VAL(e, i)];
+						CHECK_XRPNT;
+						*xrpnt++ = c1val[HUFF_C1_VAL(e, i+1)];
+						if(HUFF_C1_VAL(e, i) | HUFF_C1_VAL(e, i+1)) max = cb;
+					}
+					continue;
+				}
+				HUFF_SKIP(HUFF_C1_CODE(e));
+				a = 0;
+				for(i=0;i<4;i++) if(HUFF_C1_VAL(e, i)) a |= 0x8>>i;
 			}
-			if(part2remain+num <= 0)
+			if(part2remain+br.num <= 0)
 			{
-				num -= part2remain+num;
+				br.num -= part2remain+br.num;
 				break;
 			}
 
@@ -1186,19 +1532,7 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 				{
 					if(!mc)
 					{
-						mc = *m++;
-						cb = *m++;
-#ifdef CUT_SFB21
-						if(cb == 21)
-							v = 0.0;
-						else
-#endif
-						{
-#ifdef REAL_IS_FIXED
-							gainpow2_scale_idx = (int)(gr_info->pow2gain + (*scf << shift) - fr->gainpow2);
-#endif
-							v = gr_info->pow2gain[((*scf++) + (*pretab++)) << shift];
-						}
+						III_LONG_BAND
 					}
 					mc--;
 				}
@@ -1206,26 +1540,25 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 				if( (a & (0x8>>i)) )
 				{
 					max = cb;
-					if(part2remain+num <= 0)
+					if(part2remain+br.num <= 0)
 					break;
 
-					if(MSB_MASK) *xrpnt++ = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
-					else         *xrpnt++ =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+					if(HUFF_SIGN) *xrpnt++ = -REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
+					else          *xrpnt++ =  REAL_SCALE_LAYER3(v, gainpow2_scale_idx);
 
-					num--;
-					mask <<= 1;
+					HUFF_SKIP(1);
 				}
 				else *xrpnt++ = DOUBLE_TO_REAL(0.0);
 			}
 		}
 
 		gr_info->maxbandl = max+1;
-		gr_info->maxb = fr->longLimit[sfreq][gr_info->maxbandl];
+		gr_info->maxb = BAND_LIMIT(fr, longLimit[sfreq][gr_info->maxbandl]);
 	}
 
-	part2remain += num;
-	backbits(fr, num);
-	num = 0;
+	part2remain += br.num;
+	bits_end(fr, &br);
+	backbits(fr, -stale);
 
 	}
 	else
@@ -1239,15 +1572,15 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 		gr_info->maxb       = 1;
 	}
 
-	while(xrpnt < &xr[SBLIMIT][0]) 
+	while(xrpnt < xrend)
 	*xrpnt++ = DOUBLE_TO_REAL(0.0);
 
-	while( part2remain > 16 )
-	{
-		skipbits(fr, 16); /* Dismiss stuffing Bits */
-		part2remain -= 16;
+	if(part2remain > 0)
+	{ /* Dismiss stuffing bits, or the values beyond sblimit. */
+		part2remain += fr->bitindex;
+		fr->wordpointer += part2remain>>3;
+		fr->bitindex = part2remain & 7;
 	}
-	if(part2remain > 0) skipbits(fr, part2remain);
 	else if(part2remain < 0)
 	{
 		debug1("Can't rewind stream by %d bits!",-part2remain);
@@ -1258,7 +1591,7 @@ static int III_dequantize_sample(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],in
 
 
 /* calculate real channel values for Joint-I-Stereo-mode */
-static void III_i_stereo(real xr_buf[2][SBLIMIT][SSLIMIT],int *scalefac, struct gr_info_s *gr_info,int sfreq,int ms_stereo,int lsf)
+static void III_i_stereo(mpg123_handle *fr, real xr_buf[2][SBLIMIT][SSLIMIT],int *scalefac, struct gr_info_s *gr_info,int sfreq,int ms_stereo,int lsf)
 {
 	real (*xr)[SBLIMIT*SSLIMIT] = (real (*)[SBLIMIT*SSLIMIT] ) xr_buf;
 	const struct bandInfoStruct *bi = &bandInfo[sfreq];
@@ -1375,16 +1708,11 @@ maybe still wrong??? (copy 12 to 13?) */
 				int is_p = scalefac[sfb]; /* scale: 0-15 */
 				if(is_p != 7)
 				{
-					real t1,t2;
-					t1 = tab1[is_p]; t2 = tab2[is_p];
-					for( ; sb > 0; sb--,idx++)
-					{
-						real v = xr[0][idx];
-						xr[0][idx] = REAL_MUL_15(v, t1);
-						xr[1][idx] = REAL_MUL_15(v, t2);
-					}
+					real t[2];
+					t[0] = tab1[is_p]; t[1] = tab2[is_p];
+					opt_stereo_is(fr)(xr[0]+idx, xr[1]+idx, sb, t);
 				}
-				else idx += sb;
+				idx += sb;
 			}
 		}     
 	} 
@@ -1401,36 +1729,47 @@ maybe still wrong??? (copy 12 to 13?) */
 			is_p = scalefac[sfb]; /* scale: 0-15 */
 			if(is_p != 7)
 			{
-				real t1,t2;
-				t1 = tab1[is_p]; t2 = tab2[is_p];
-				for( ; sb > 0; sb--,idx++)
-				{
-					 real v = xr[0][idx];
-					 xr[0][idx] = REAL_MUL_15(v, t1);
-					 xr[1][idx] = REAL_MUL_15(v, t2);
-				}
+				real t[2];
+				t[0] = tab1[is_p]; t[1] = tab2[is_p];
+				opt_stereo_is(fr)(xr[0]+idx, xr[1]+idx, sb, t);
 			}
-			else idx += sb;
+			idx += sb;
 		}
 
 		is_p = scalefac[20];
 		if(is_p != 7)
 		{  /* copy l-band 20 to l-band 21 */
-			int sb;
-			real t1 = tab1[is_p],t2 = tab2[is_p]; 
-
-			for( sb = bi->longDiff[21]; sb > 0; sb--,idx++ )
-			{
-				real v = xr[0][idx];
-				xr[0][idx] = REAL_MUL_15(v, t1);
-				xr[1][idx] = REAL_MUL_15(v, t2);
-			}
+			real t[2];
+			t[0] = tab1[is_p]; t[1] = tab2[is_p];
+			opt_stereo_is(fr)(xr[0]+idx, xr[1]+idx, bi->longDiff[21], t);
 		}
 	}
 }
 
 
-static void III_antialias(real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info)
+/* 31 alias-reduction operations between each pair of sub-bands */
+/* with 8 butterflies between each pair                         */
+void antialias(real *xr, int sblim)
+{
+	int sb;
+	real *xr1 = xr+SSLIMIT;
+
+	for(sb=sblim; sb; sb--,xr1+=10)
+	{
+		int ss;
+		real *cs=aa_cs,*ca=aa_ca;
+		real *xr2 = xr1;
+
+		for(ss=7;ss>=0;ss--)
+		{ /* upper and lower butterfly inputs */
+			register real bu = *--xr2,bd = *xr1;
+			*xr2   = REAL_MUL(bu, *cs) - REAL_MUL(bd, *ca);
+			*xr1++ = REAL_MUL(bd, *cs++) + REAL_MUL(bu, *ca++);
+		}
+	}
+}
+
+static void III_antialias(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info)
 {
 	int sblim;
 
@@ -1442,26 +1781,30 @@ static void III_antialias(real xr[SBLIMIT][SSLIMIT],struct gr_info_s *gr_info)
 	}
 	else sblim = gr_info->maxb-1;
 
-	/* 31 alias-reduction operations between each pair of sub-bands */
-	/* with 8 butterflies between each pair                         */
+	opt_antialias(fr)((real *) xr, sblim);
+}
 
+/* The C versions of the stereo helpers, the SIMD ones must give the same results. */
+void stereo_ms(real *xr0, real *xr1, int n)
+{
+	int i;
+	for(i=0;i<n;i++)
 	{
-		int sb;
-		real *xr1=(real *) xr[1];
+		real tmp0 = xr0[i];
+		real tmp1 = xr1[i];
+		xr0[i] = tmp0 + tmp1;
+		xr1[i] = tmp0 - tmp1;
+	}
+}
 
-		for(sb=sblim; sb; sb--,xr1+=10)
-		{
-			int ss;
-			real *cs=aa_cs,*ca=aa_ca;
-			real *xr2 = xr1;
-
-			for(ss=7;ss>=0;ss--)
-			{ /* upper and lower butterfly inputs */
-				register real bu = *--xr2,bd = *xr1;
-				*xr2   = REAL_MUL(bu, *cs) - REAL_MUL(bd, *ca);
-				*xr1++ = REAL_MUL(bd, *cs++) + REAL_MUL(bu, *ca++);
-			}
-		}
+void stereo_is(real *xr0, real *xr1, int n, const real *t)
+{
+	int i;
+	for(i=0;i<n;i++)
+	{
+		real v = xr0[i];
+		xr0[i] = REAL_MUL_15(v, t[0]);
+		xr1[i] = REAL_MUL_15(v, t[1]);
 	}
 }
 
@@ -1952,6 +2295,12 @@ static void III_hybrid(real fsIn[SBLIMIT][SSLIMIT], real tsOut[SSLIMIT][SBLIMIT]
 	bt = gr_info->block_type;
 	if(bt == 2)
 	{
+#ifdef opt_dct12
+		/* 4 sub-bands at once, as long as the pairs below would cover them. */
+		if(have_dct12(fr))
+		for(; sb+2<gr_info->maxb; sb+=4,tspnt+=4,rawout1+=72,rawout2+=72)
+			opt_dct12(fr)(fsIn[sb],rawout1,rawout2,win_sb4[0],tspnt);
+#endif
 		for(; sb<gr_info->maxb; sb+=2,tspnt+=2,rawout1+=36,rawout2+=36)
 		{
 			dct12(fsIn[sb]  ,rawout1   ,rawout2   ,win[2] ,tspnt);
@@ -1980,6 +2329,111 @@ static void III_hybrid(real fsIn[SBLIMIT][SSLIMIT], real tsOut[SSLIMIT][SBLIMIT]
 
 
 /* And at the end... the main layer3 handler */
+/* Hand the dequantized spectrum of one channel to the handler of mpg123_spectrum_handler(). */
+static void III_spectrum(mpg123_handle *fr, real xr[SBLIMIT][SSLIMIT], struct gr_info_s *gr_info, int gr, int ch)
+{
+	mpg123_granule granule;
+	const real *in = (const real *) xr;
+	float *out = fr->sp.xr;
+	int i, n = SSLIMIT*(int)gr_info->maxb;
+	double scale = 1.;
+
+#ifdef OPT_MMXORSSE
+	if(fr->gainpow2 == gainpow2_mmx_tab)
+		scale = 1./16384.;
+#endif
+	for(i=0; i<n; ++i)
+		out[i] = (float)(scale*REAL_TO_DOUBLE(in[i]));
+	for(; i<SBLIMIT*SSLIMIT; ++i)
+		out[i] = 0.f;
+	granule.granule = gr;
+	granule.channel = ch;
+	granule.block_type = (int)gr_info->block_type;
+	granule.mixed_block = gr_info->block_type == 2 && gr_info->mixed_block_flag;
+	granule.subbands = (int)gr_info->maxb;
+	granule.xr = out;
+	fr->sp.handler(fr->sp.data, &granule);
+}
+
+/* Largest value of the Huffman tables 0 to 15, the others add linbits to 15. */
+static const unsigned char III_tabmax[16] = { 0,1,2,2,0,3,3,5,5,5,7,7,7,15,0,15 };
+
+/* Largest coefficient of a channel's granule, from the side info alone.
+   The scalefactors and subblock gains only make it smaller. */
+static double III_bound(mpg123_handle *fr, struct gr_info_s *gr_info)
+{
+	unsigned int r, q;
+	unsigned int start[3];
+
+	if(gr_info->part2_3_length == 0) return 0.;
+	start[0] = 0;
+	start[1] = gr_info->region1start;
+	start[2] = gr_info->region2start;
+	q = 1; /* the count1 part */
+	for(r=0; r<3 && gr_info->big_values > start[r]; ++r)
+	{
+		unsigned int t = gr_info->table_select[r];
+		t = t < 16 ? III_tabmax[t] : 15 + (1u<<ht[t].linbits) - 1;
+		if(t > q) q = t;
+	}
+	/* Index 46 of the gain table is a global_gain of 210, a factor of 1. */
+	return pow((double)q, 4./3.) * pow(2., -0.25*(double)(gr_info->pow2gain-fr->gainpow2-46));
+}
+
+static double III_granule_bound(mpg123_handle *fr, struct III_sideinfo *si, int gr)
+{
+	double bound = III_bound(fr, &(si->ch[0].gr[gr]));
+	if(fr->stereo == 2)
+	{
+		double bound1 = III_bound(fr, &(si->ch[1].gr[gr]));
+		if(bound1 > bound) bound = bound1;
+		/* Mid/side, intensity stereo and the mono mix add up both. */
+		if(fr->mode == MPG_MD_JOINT_STEREO || fr->single == SINGLE_MIX) bound *= 2;
+	}
+	return bound;
+}
+
+/* Step over the main data of a granule that silence_block() took care of.
+   The scalefactors are still read, the next granule (scfsi) or the right
+   channel (MPEG 2 intensity stereo) may need them. */
+static int III_skip_granule(mpg123_handle *fr, struct III_sideinfo *si, int scalefacs[2][39], int gr, int i_stereo)
+{
+	int ch;
+	for(ch=0; ch<fr->stereo; ++ch)
+	{
+		struct gr_info_s *gr_info = &(si->ch[ch].gr[gr]);
+		long part2bits, remain;
+		if(fr->lsf)
+		part2bits = III_get_scale_factors_2(fr, scalefacs[ch], gr_info, ch ? i_stereo : 0);
+		else
+		part2bits = III_get_scale_factors_1(fr, scalefacs[ch], gr_info, ch, gr);
+
+		/* Same as the end of the dequantization. */
+		remain = gr_info->part2_3_length > 0 ? (long)gr_info->part2_3_length - part2bits : 0;
+		if(remain < 0) return 1;
+		remain += fr->bitindex;
+		fr->wordpointer += remain>>3;
+		fr->bitindex = remain & 7;
+	}
+	return 0;
+}
+
+int silence_layer3(mpg123_handle *fr, double *bound)
+{
+	struct III_sideinfo sideinfo;
+	int gr, ms_stereo;
+	int granules = fr->lsf ? 1 : 2;
+	int single = fr->stereo == 1 ? SINGLE_LEFT : fr->single;
+
+	ms_stereo = fr->mode == MPG_MD_JOINT_STEREO ? (fr->mode_ext & 0x2)>>1 : 0;
+	if(III_get_side_info(fr, &sideinfo, fr->stereo, ms_stereo, fr->sampling_frequency, single))
+	return 0;
+	for(gr=0; gr<granules; ++gr)
+	bound[gr] = III_granule_bound(fr, &sideinfo, gr);
+
+	return granules;
+}
+
 int do_layer3(mpg123_handle *fr)
 {
 	int gr, ch, ss,clip=0;
@@ -2027,6 +2481,16 @@ int do_layer3(mpg123_handle *fr)
 		/*  hybridOut[2][SSLIMIT][SBLIMIT] */
 		real (*hybridOut)[SSLIMIT][SBLIMIT] = fr->layer3.hybrid_out;
 
+		if(silence_block(fr, III_granule_bound(fr, &sideinfo, gr), SSLIMIT))
+		{
+			if(III_skip_granule(fr, &sideinfo, scalefacs, gr, i_stereo))
+			{
+				if(VERBOSE2) error("dequantization failed!");
+				return clip;
+			}
+			continue;
+		}
+
 		{
 			struct gr_info_s *gr_info = &(sideinfo.ch[0].gr[gr]);
 			long part2bits;
@@ -2035,7 +2499,7 @@ int do_layer3(mpg123_handle *fr)
 			else
 			part2bits = III_get_scale_factors_1(fr, scalefacs[0],gr_info,0,gr);
 
-			if(III_dequantize_sample(fr, hybridIn[0], scalefacs[0],gr_info,sfreq,part2bits))
+			if(III_dequantize_sample(fr, hybridIn[0], scalefacs[0],gr_info,sfreq,part2bits,fr->down_sample_sblimit))
 			{
 				if(VERBOSE2) error("dequantization failed!");
 				return clip;
@@ -2051,7 +2515,8 @@ int do_layer3(mpg123_handle *fr)
 			else
 			part2bits = III_get_scale_factors_1(fr, scalefacs[1],gr_info,1,gr);
 
-			if(III_dequantize_sample(fr, hybridIn[1],scalefacs[1],gr_info,sfreq,part2bits))
+			/* Intensity stereo starts above the last non-zero band on the right. */
+			if(III_dequantize_sample(fr, hybridIn[1],scalefacs[1],gr_info,sfreq,part2bits,i_stereo ? SBLIMIT : fr->down_sample_sblimit))
 			{
 				if(VERBOSE2) error("dequantization failed!");
 				return clip;
@@ -2059,20 +2524,13 @@ int do_layer3(mpg123_handle *fr)
 
 			if(ms_stereo)
 			{
-				int i;
 				unsigned int maxb = sideinfo.ch[0].gr[gr].maxb;
 				if(sideinfo.ch[1].gr[gr].maxb > maxb) maxb = sideinfo.ch[1].gr[gr].maxb;
 
-				for(i=0;i<SSLIMIT*(int)maxb;i++)
-				{
-					real tmp0 = ((real *)hybridIn[0])[i];
-					real tmp1 = ((real *)hybridIn[1])[i];
-					((real *)hybridIn[0])[i] = tmp0 + tmp1;
-					((real *)hybridIn[1])[i] = tmp0 - tmp1;
-				}
+				opt_stereo_ms(fr)((real *)hybridIn[0], (real *)hybridIn[1], SSLIMIT*(int)maxb);
 			}
 
-			if(i_stereo) III_i_stereo(hybridIn,scalefacs[1],gr_info,sfreq,ms_stereo,fr->lsf);
+			if(i_stereo) III_i_stereo(fr, hybridIn,scalefacs[1],gr_info,sfreq,ms_stereo,fr->lsf);
 
 			if(ms_stereo || i_stereo || (single == SINGLE_MIX) )
 			{
@@ -2103,15 +2561,24 @@ int do_layer3(mpg123_handle *fr)
 			}
 		}
 
+		/* Frames decoded just to fill the bit reservoir after a seek do not count. */
+		if(fr->sp.handler != NULL && fr->num >= fr->firstframe)
+		{
+			for(ch=0;ch<stereo1;ch++)
+			III_spectrum(fr, hybridIn[ch], &(sideinfo.ch[ch].gr[gr]), gr, ch);
+		}
+		if(fr->sp.only) continue;
+
 		for(ch=0;ch<stereo1;ch++)
 		{
 			struct gr_info_s *gr_info = &(sideinfo.ch[ch].gr[gr]);
-			III_antialias(hybridIn[ch],gr_info);
+			III_antialias(fr, hybridIn[ch],gr_info);
 			III_hybrid(hybridIn[ch], hybridOut[ch], ch,gr_info, fr);
 		}
 
 #ifdef OPT_I486
-		if(single != SINGLE_STEREO || fr->af.encoding != MPG123_ENC_SIGNED_16 || fr->down_sample != 0)
+		if(  single != SINGLE_STEREO || fr->af.encoding != MPG123_ENC_SIGNED_16 || fr->down_sample != 0
+		  || fr->synth_stereo == peaks_stereo )
 		{
 #endif
 		for(ss=0;ss<SSLIMIT;ss++)
@@ -45,6 +45,7 @@ if(/^\s*MPG123_EXPORT\s+(\S+)\s+(mpg123_\S+)\((.*)\);\s*$/)
 }' < mpg123.h.in
 
 mpg123_decode_frame
+mpg123_silence
 mpg123_framebyframe_decode
 mpg123_framepos
 mpg123_tell
@@ -181,6 +182,28 @@ int attribute_align_arg mpg123_decode_frame(mpg123_handle *mh, long *num, unsign
 	return err;
 }
 
+#undef mpg123_silence
+/* int mpg123_silence(mpg123_handle *mh, off_t min_length, off_t *begin, off_t *end); */
+int attribute_align_arg mpg123_silence(mpg123_handle *mh, long min_length, long *begin, long *end)
+{
+	off_t largebegin, largeend;
+	int err;
+
+	if(begin == NULL || end == NULL) return MPG123_ERR_NULL;
+	err = MPG123_LARGENAME(mpg123_silence)(mh, min_length, &largebegin, &largeend);
+	if(err == MPG123_OK)
+	{
+		*begin = largebegin;
+		*end = largeend;
+		if(*begin != largebegin || *end != largeend)
+		{
+			mh->err = MPG123_LFS_OVERFLOW;
+			err = MPG123_ERR;
+		}
+	}
+	return err;
+}
+
 #undef mpg123_framebyframe_decode
 /* int mpg123_framebyframe_decode(mpg123_handle *mh, off_t *num, unsigned char **audio, size_t *bytes); */
 int attribute_align_arg mpg123_framebyframe_decode(mpg123_handle *mh, long *num, unsigned char **audio, size_t *bytes)
@@ -32,6 +32,9 @@ int attribute_align_arg mpg123_init(void)
 	init_layer3();
 #endif
 	prepare_decode_tables();
+#ifdef OPT_DITHER
+	frame_dither_table_init();
+#endif
 	check_decoders();
 	initialized = 1;
 #if (defined REAL_IS_FLOAT) && (defined IEEE_FLOAT)
@@ -253,6 +256,39 @@ int attribute_align_arg mpg123_par(mpg123_pars *mp, enum mpg123_parms key, long
 			ret = MPG123_MISSING_FEATURE;
 #endif
 		break;
+		case MPG123_RESAMPLE:
+			if(val < MPG123_RESAMPLE_NTOM || val > MPG123_RESAMPLE_HIGH)
+			ret = MPG123_BAD_VALUE;
+#ifdef RESAMPLE_SINC
+			else mp->resample = val;
+#else
+			/* Only the plain NtoM synth here. */
+			else if(val != MPG123_RESAMPLE_NTOM) ret = MPG123_MISSING_FEATURE;
+#endif
+		break;
+		case MPG123_READAHEAD:
+			/* Without io_uring, the plain reader just does its job. */
+			if(val >= 0) mp->readahead = val;
+			else ret = MPG123_BAD_VALUE;
+		break;
+		case MPG123_READ_THREAD:
+			if(val < 0) ret = MPG123_BAD_VALUE;
+#ifdef READ_THREAD
+			else mp->read_thread = val;
+#else
+			else if(val > 0) ret = MPG123_MISSING_FEATURE;
+#endif
+		break;
+		case MPG123_BAND_LIMIT:
+			if(val >= 0 && val <= SBLIMIT) mp->band_limit = val;
+			else ret = MPG123_BAD_VALUE;
+		break;
+		case MPG123_SILENCE_LEVEL:
+			/* Like MPG123_OUTSCALE, the value that is non-zero counts. */
+			if(val != 0) fval = (double)val;
+			if(fval <= 0.) mp->silence_level = fval;
+			else ret = MPG123_BAD_VALUE;
+		break;
 		default:
 			ret = MPG123_BAD_PARAM;
 	}
@@ -342,6 +378,26 @@ int attribute_align_arg mpg123_getpar(mpg123_pars *mp, enum mpg123_parms key, lo
 			ret = MPG123_MISSING_FEATURE;
 #endif
 		break;
+		case MPG123_RESAMPLE:
+#ifdef RESAMPLE_SINC
+			*val = mp->resample;
+#else
+			*val = MPG123_RESAMPLE_NTOM;
+#endif
+		break;
+		case MPG123_READAHEAD:
+			*val = mp->readahead;
+		break;
+		case MPG123_READ_THREAD:
+			*val = mp->read_thread;
+		break;
+		case MPG123_BAND_LIMIT:
+			*val = mp->band_limit;
+		break;
+		case MPG123_SILENCE_LEVEL:
+			if(fval) *fval = mp->silence_level;
+			if(val) *val = (long)mp->silence_level;
+		break;
 		default:
 			ret = MPG123_BAD_PARAM;
 	}
@@ -384,6 +440,20 @@ int attribute_align_arg mpg123_getstate(mpg123_handle *mh, enum mpg123_state key
 			theval = mh->state_flags & FRAME_FRESH_DECODER;
 			mh->state_flags &= ~FRAME_FRESH_DECODER;
 		break;
+		case MPG123_LOUDNESS_INTEGRATED:
+			theval = loudness_integrated(mh, &thefval);
+		break;
+		case MPG123_LOUDNESS_MOMENTARY:
+			if(mh->ld.momentary >= 0.)
+			{
+				theval = 1;
+				thefval = mh->ld.momentary > 0. ? LOUDNESS_OFFSET + 10.*log10(mh->ld.momentary) : -HUGE_VAL;
+			}
+		break;
+		case MPG123_LOUDNESS_PEAK:
+			theval = mh->ld.peak > 0.;
+			thefval = mh->ld.peak;
+		break;
 		default:
 			mh->err = MPG123_BAD_KEY;
 			ret = MPG123_ERR;
@@ -556,6 +626,9 @@ int decode_update(mpg123_handle *mh)
 		break;
 #endif
 	}
+	/* Cut the spectrum further on request. */
+	if(mh->p.band_limit > 0 && mh->p.band_limit < mh->down_sample_sblimit)
+		mh->down_sample_sblimit = mh->p.band_limit;
 
 	if(!(mh->p.flags & MPG123_FORCE_MONO))
 	{
@@ -613,8 +686,9 @@ static int get_next_frame(mpg123_handle *mh)
 			debug1("ignoring frame %li", (long)mh->num);
 			/* Decoder structure must be current! decode_update has been called before... */
 			(mh->do_layer)(mh); mh->buffer.fill = 0;
+			/* The ignored decoding may have failed. Make sure synth and ntom stay consistent. */
+			frame_set_bo(mh, mh->num+1);
 #ifndef NO_NTOM
-			/* The ignored decoding may have failed. Make sure ntom stays consistent. */
 			if(mh->down_sample == 3) ntom_set_ntom(mh, mh->num+1);
 #endif
 			mh->to_ignore = mh->to_decode = FALSE;
@@ -774,6 +848,8 @@ int attribute_align_arg mpg123_framebyframe_decode(mpg123_handle *mh, off_t *num
 	mh->to_decode = mh->to_ignore = FALSE;
 	mh->buffer.p = mh->buffer.data;
 	FRAME_BUFFERCHECK(mh);
+	if(loudness_buffer(mh) != MPG123_OK) return MPG123_ERR;
+	if(planar_buffer(mh) != MPG123_OK) return MPG123_ERR;
 	*audio = mh->buffer.p;
 	*bytes = mh->buffer.fill;
 	return MPG123_OK;
@@ -851,6 +927,8 @@ int attribute_align_arg mpg123_decode_frame(mpg123_handle *mh, off_t *num, unsig
 			mh->to_decode = mh->to_ignore = FALSE;
 			mh->buffer.p = mh->buffer.data;
 			FRAME_BUFFERCHECK(mh);
+			if(loudness_buffer(mh) != MPG123_OK) return MPG123_ERR;
+			if(planar_buffer(mh) != MPG123_OK) return MPG123_ERR;
 			if(audio != NULL) *audio = mh->buffer.p;
 			if(bytes != NULL) *bytes = mh->buffer.fill;
 
@@ -865,6 +943,218 @@ int attribute_align_arg mpg123_decode_frame(mpg123_handle *mh, off_t *num, unsig
 	}
 }
 
+/* The samples to keep from the current frame, as frame_buffercheck() would do. */
+static void peaks_gapless(mpg123_handle *mh, off_t *skip, off_t *end)
+{
+	*skip = 0;
+	*end = -1;
+#ifdef GAPLESS
+	if(!(mh->state_flags & FRAME_ACCURATE)) return;
+	if(mh->gapless_frames > 0 && mh->num >= mh->gapless_frames) return;
+
+	if(mh->lastframe > -1 && mh->num >= mh->lastframe)
+		*end = (mh->num == mh->lastframe) ? mh->lastoff : 0;
+	if(mh->firstoff && mh->num == mh->firstframe)
+	{
+		*skip = mh->firstoff;
+		mh->firstoff = 0;
+	}
+#endif
+}
+
+int attribute_align_arg mpg123_peaks( mpg123_handle *mh, size_t window, int flags
+,	float *min, float *max, float *rms, size_t count, size_t *done )
+{
+	int ret = MPG123_OK;
+
+	if(done != NULL) *done = 0;
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(window < 1)
+	{
+		mh->err = MPG123_BAD_VALUE;
+		return MPG123_ERR;
+	}
+	if(mh->buffer.size < mh->outblock) return MPG123_NO_SPACE;
+
+	mh->pk.out[0] = min;
+	mh->pk.out[1] = max;
+	mh->pk.out[2] = rms;
+	mh->pk.count = count;
+	mh->pk.fill = 0;
+	if(window != mh->pk.window || flags != mh->pk.flags)
+	{
+		peaks_reset(mh);
+		mh->pk.window = window;
+		mh->pk.flags = flags;
+	}
+	while(mh->pk.fill < count && !peaks_pending(mh))
+	{
+		if(mh->to_decode)
+		{
+			off_t skip, end;
+			/* The envelope does not care about the format, just about its rate. */
+			mh->new_format = 0;
+			if(  peaks_setup(mh) != MPG123_OK
+			  || peaks_reserve(mh, (size_t)frame_expect_outsamples(mh)) != MPG123_OK )
+			{
+				ret = MPG123_ERR;
+				break;
+			}
+			peaks_gapless(mh, &skip, &end);
+			peaks_frame(mh, skip, end);
+			mh->to_decode = mh->to_ignore = FALSE;
+		}
+		else
+		{
+			mh->buffer.fill = 0;
+			ret = get_next_frame(mh);
+			if(ret == MPG123_DONE)
+			{
+				if(peaks_reserve(mh, 0) != MPG123_OK)
+				{
+					ret = MPG123_ERR;
+					break;
+				}
+				peaks_flush(mh);
+			}
+			if(ret < 0) break;
+			ret = MPG123_OK;
+		}
+	}
+	if(ret == MPG123_DONE)
+	{
+		/* Hand out what the end produced, report the end on the next call. */
+		peaks_pending(mh);
+		if(mh->pk.fill) ret = MPG123_OK;
+	}
+	if(done != NULL) *done = mh->pk.fill;
+	return ret;
+}
+
+int attribute_align_arg mpg123_spectrum_handler( mpg123_handle *mh
+,	void (*handler)(void *data, const mpg123_granule *gr), void *data )
+{
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	mh->sp.handler = handler;
+	mh->sp.data = data;
+	return MPG123_OK;
+}
+
+int attribute_align_arg mpg123_spectrum(mpg123_handle *mh, size_t frames, size_t *done)
+{
+	int ret = MPG123_OK;
+	size_t count = 0;
+
+	if(done != NULL) *done = 0;
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(mh->sp.handler == NULL)
+	{
+		mh->err = MPG123_BAD_VALUE;
+		return MPG123_ERR;
+	}
+	while(count < frames)
+	{
+		if(mh->to_decode)
+		{
+			/* Without synthesis, the output format does not matter. */
+			mh->new_format = 0;
+			if(mh->lay == 3)
+			{
+				mh->sp.only = TRUE;
+				(mh->do_layer)(mh);
+				mh->sp.only = FALSE;
+			}
+			/* Keep synth and ntom where decoding would have left them. */
+			mh->buffer.fill = 0;
+			frame_set_bo(mh, mh->num+1);
+#ifndef NO_NTOM
+			if(mh->down_sample == 3) ntom_set_ntom(mh, mh->num+1);
+#endif
+			mh->to_decode = mh->to_ignore = FALSE;
+			++count;
+		}
+		else
+		{
+			mh->buffer.fill = 0;
+			ret = get_next_frame(mh);
+			if(ret < 0) break;
+			ret = MPG123_OK;
+		}
+	}
+	/* Report the end on the next call. */
+	if(ret == MPG123_DONE && count) ret = MPG123_OK;
+	if(done != NULL) *done = count;
+	return ret;
+}
+
+/* End the current span of mpg123_silence(), TRUE if it is worth reporting. */
+static int silence_span(mpg123_handle *mh, off_t min_length, off_t *begin, off_t *end)
+{
+	off_t b = SAMPLE_ADJUST(mh, mh->sil.begin);
+	off_t e = SAMPLE_ADJUST(mh, mh->sil.end);
+
+	mh->sil.span = FALSE;
+	if(b < 0) b = 0;
+	/* Could be all in the gapless padding. */
+	if(e <= b || e-b < min_length) return FALSE;
+	*begin = b;
+	*end = e;
+	return TRUE;
+}
+
+int attribute_align_arg mpg123_silence(mpg123_handle *mh, off_t min_length, off_t *begin, off_t *end)
+{
+	int ret;
+
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(begin == NULL || end == NULL) return MPG123_ERR_NULL;
+	while(1)
+	{
+		/* Blocks of the last frame that were not looked at when a span ended. */
+		while(mh->sil.next < mh->sil.blocks)
+		{
+			int i = mh->sil.next++;
+			if(silence_count(mh, mh->sil.bound[i]))
+			{
+				if(!mh->sil.span)
+				{
+					mh->sil.span = TRUE;
+					mh->sil.begin = mh->sil.pos + mh->sil.len*i/mh->sil.blocks;
+				}
+				mh->sil.end = mh->sil.pos + mh->sil.len*(i+1)/mh->sil.blocks;
+			}
+			else if(mh->sil.span && silence_span(mh, min_length, begin, end))
+				return MPG123_OK;
+		}
+		if(mh->to_decode)
+		{
+			/* Without synthesis, the output format does not matter. */
+			mh->new_format = 0;
+			mh->sil.pos = frame_outs(mh, mh->num);
+			mh->sil.len = frame_outs(mh, mh->num+1) - mh->sil.pos;
+			mh->sil.blocks = silence_frame(mh, mh->sil.bound);
+			mh->sil.next = 0;
+			/* Keep the bit reservoir, synth and ntom where decoding would have left them. */
+			frame_skip(mh);
+			mh->buffer.fill = 0;
+			frame_set_bo(mh, mh->num+1);
+#ifndef NO_NTOM
+			if(mh->down_sample == 3) ntom_set_ntom(mh, mh->num+1);
+#endif
+			mh->to_decode = mh->to_ignore = FALSE;
+		}
+		else
+		{
+			mh->buffer.fill = 0;
+			ret = get_next_frame(mh);
+			if(ret == MPG123_DONE && mh->sil.span
+			&& silence_span(mh, min_length, begin, end))
+				return MPG123_OK;
+			if(ret < 0) return ret;
+		}
+	}
+}
+
 int attribute_align_arg mpg123_read(mpg123_handle *mh, unsigned char *out, size_t size, size_t *done)
 {
 	return mpg123_decode(mh, NULL, 0, out, size, done);
@@ -901,6 +1191,32 @@ int attribute_align_arg mpg123_feed(mpg123_handle *mh, const unsigned char *in,
 #endif
 }
 
+int attribute_align_arg mpg123_feed_ref( mpg123_handle *mh
+,	const unsigned char *in, size_t size, void (*release)(void *), void *handle )
+{
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+#ifndef NO_FEEDER
+	if(in == NULL || release == NULL)
+	{
+		mh->err = MPG123_NULL_BUFFER;
+		return MPG123_ERR;
+	}
+	if(size == 0)
+	{
+		/* Nothing to keep, give it back right away. */
+		release(handle);
+		return MPG123_OK;
+	}
+	if(feed_more_ref(mh, in, size, release, handle) != 0) return MPG123_ERR;
+
+	if(mh->err == MPG123_ERR_READER) mh->err = MPG123_OK;
+	return MPG123_OK;
+#else
+	mh->err = MPG123_MISSING_FEATURE;
+	return MPG123_ERR;
+#endif
+}
+
 /*
 	The old picture:
 	while(1) {
@@ -919,6 +1235,7 @@ int attribute_align_arg mpg123_decode(mpg123_handle *mh, const unsigned char *in
 {
 	int ret = MPG123_OK;
 	size_t mdone = 0;
+	size_t plane = 0; /* offset of the right channel in outmemory, if planar */
 
 	if(done != NULL) *done = 0;
 	if(mh == NULL) return MPG123_BAD_HANDLE;
@@ -929,6 +1246,20 @@ int attribute_align_arg mpg123_decode(mpg123_handle *mh, const unsigned char *in
 		goto decodeend;
 	}
 	if(outmemory == NULL) outmemsize = 0; /* Not just give error, give chance to get a status message. */
+	/* Planar output: left samples from the start, right ones from the middle,
+	   moved down to the end of the left ones when done. Whole sample frames only. */
+	if(mh->p.flags & MPG123_PLANAR && mh->af.channels == 2)
+	{
+		plane = outmemsize/(2*mh->af.encsize)*mh->af.encsize;
+		/* Not even one sample frame fits, there would never be progress. */
+		if(plane == 0 && outmemsize > 0)
+		{
+			mh->err = MPG123_BAD_BUFFER;
+			ret = MPG123_ERR;
+			goto decodeend;
+		}
+		outmemsize = 2*plane;
+	}
 
 	while(ret == MPG123_OK)
 	{
@@ -954,18 +1285,32 @@ int attribute_align_arg mpg123_decode(mpg123_handle *mh, const unsigned char *in
 			mh->buffer.p = mh->buffer.data;
 			debug2("decoded frame %li, got %li samples in buffer", (long)mh->num, (long)(mh->buffer.fill / (samples_to_bytes(mh, 1))));
 			FRAME_BUFFERCHECK(mh);
+			if(  loudness_buffer(mh) != MPG123_OK
+			  || planar_buffer(mh) != MPG123_OK )
+			{
+				ret = MPG123_ERR;
+				goto decodeend;
+			}
 		}
 		if(mh->buffer.fill) /* Copy (part of) the decoded data to the caller's buffer. */
 		{
 			/* get what is needed - or just what is there */
 			int a = mh->buffer.fill > (outmemsize - mdone) ? outmemsize - mdone : mh->buffer.fill;
 			debug4("buffer fill: %i; copying %i (%i - %li)", (int)mh->buffer.fill, a, (int)outmemsize, (long)mdone);
-			memcpy(outmemory, mh->buffer.p, a);
-			/* less data in frame buffer, less needed, output pointer increase, more data given... */
+			if(plane)
+			{
+				memcpy(outmemory+mdone/2, mh->buffer.p, a/2);
+				memcpy(outmemory+plane+mdone/2, mh->buffer.p+mh->buffer.plane, a/2);
+				mh->buffer.p += a/2;
+			}
+			else
+			{
+				memcpy(outmemory+mdone, mh->buffer.p, a);
+				mh->buffer.p += a;
+			}
+			/* less data in frame buffer, less needed, more data given... */
 			mh->buffer.fill -= a;
-			outmemory  += a;
 			mdone += a;
-			mh->buffer.p += a;
 			if(!(outmemsize > mdone)) goto decodeend;
 		}
 		else /* If we didn't have data, get a new frame. */
@@ -975,6 +1320,8 @@ int attribute_align_arg mpg123_decode(mpg123_handle *mh, const unsigned char *in
 		}
 	}
 decodeend:
+	if(plane && mdone < outmemsize)
+	memmove(outmemory+mdone/2, outmemory+plane, mdone/2);
 	if(done != NULL) *done = mdone;
 	return ret;
 #else
@@ -1157,6 +1504,7 @@ static int do_the_seek(mpg123_handle *mh)
 
 	/* OK, real seeking follows... clear buffers and go for it. */
 	frame_buffers_reset(mh);
+	frame_set_bo(mh, fnum);
 #ifndef NO_NTOM
 	if(mh->down_sample == 3)
 	{
@@ -1407,14 +1755,24 @@ int attribute_align_arg mpg123_scan(mpg123_handle *mh)
 	/* One frame must be there now. */
 	track_frames = 1;
 	track_samples = mh->spf; /* Internal samples. */
+	memset(mh->scan_bitrates, 0, sizeof(mh->scan_bitrates));
+	++mh->scan_bitrates[frame_bitrate(mh)/8];
 	debug("TODO: We should disable gapless code when encountering inconsistent mh->spf!");
 	debug("      ... at least unset MPG123_ACCURATE.");
-	/* Do not increment mh->track_frames in the loop as tha would confuse Frankenstein detection. */
+	/* Only headers are needed from here on, the frame bodies are skipped.
+	   Do not increment mh->track_frames in the loop as tha would confuse Frankenstein detection. */
+	mh->state_flags |= FRAME_SCANNING;
+	open_scan(mh);
 	while(read_frame(mh) == 1)
 	{
 		++track_frames;
 		track_samples += mh->spf;
+		++mh->scan_bitrates[frame_bitrate(mh)/8];
 	}
+	mh->state_flags &= ~FRAME_SCANNING;
+	if(close_scan(mh) < 0) return MPG123_ERR;
+	/* There is no frame data to decode at the current position, make sure the seek below really happens. */
+	mh->to_decode = mh->to_ignore = FALSE;
 	mh->track_frames = track_frames;
 	mh->track_samples = track_samples;
 	debug2("Scanning yielded %"OFF_P" track samples, %"OFF_P" frames.", (off_p)mh->track_samples, (off_p)mh->track_frames);
@@ -1425,6 +1783,21 @@ int attribute_align_arg mpg123_scan(mpg123_handle *mh)
 	return mpg123_seek(mh, oldpos, SEEK_SET) >= 0 ? MPG123_OK : MPG123_ERR;
 }
 
+int attribute_align_arg mpg123_scan_bitrates(mpg123_handle *mh, const size_t **frames, size_t *fill)
+{
+	size_t i;
+
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(frames == NULL || fill == NULL){ mh->err = MPG123_NULL_POINTER; return MPG123_ERR; }
+
+	*frames = mh->scan_bitrates;
+	*fill = 0;
+	for(i=0; i<SCAN_BITRATES; ++i)
+	if(mh->scan_bitrates[i]) *fill = i+1;
+
+	return MPG123_OK;
+}
+
 int attribute_align_arg mpg123_meta_check(mpg123_handle *mh)
 {
 	if(mh != NULL) return mh->metaflags;
@@ -1599,6 +1972,212 @@ int attribute_align_arg mpg123_set_index(mpg123_handle *mh, off_t *offsets, off_
 #endif
 }
 
+/*
+	Stored seek state, all numbers little endian:
+	  0   8  "mpg123ix"
+	  8   4  format version (1)
+	 12   4  flags: 1 = Xing TOC present, 2 = frame positions are accurate
+	 16   8  file size (as seen by the reader, without ID3v1 tag)
+	 24   8  file modification time, 0 if unknown
+	 32   4  first frame header
+	 36   4  reserved (0)
+	 40   8  audio_start
+	 48   8  track_frames
+	 56   8  track_samples
+	 64   8  gapless_frames
+	 72   8  begin_s
+	 80   8  end_s
+	 88   8  index step
+	 96   8  index fill
+	104 100  Xing TOC
+	204      index fill offsets of 8 bytes each
+	end   4  CRC-32 of all bytes before
+*/
+#define INDEX_MAGIC "mpg123ix"
+#define INDEX_VERSION 1
+#define INDEX_HEAD 204
+#define INDEX_TOC 1
+#define INDEX_ACCURATE 2
+
+static uint32_t index_crc(const unsigned char *data, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+	size_t i;
+	int j;
+	for(i=0; i<size; ++i)
+	{
+		crc ^= data[i];
+		for(j=0; j<8; ++j)
+		crc = (crc >> 1) ^ (0xedb88320 & (0-(crc & 1)));
+	}
+	return ~crc;
+}
+
+static void index_put(unsigned char *p, int64_t val, int bytes)
+{
+	uint64_t v = (uint64_t)val;
+	int i;
+	for(i=0; i<bytes; ++i, v >>= 8)
+	p[i] = v & 0xff;
+}
+
+static int64_t index_get(const unsigned char *p, int bytes)
+{
+	uint64_t v = 0;
+	int i;
+	for(i=bytes-1; i>=0; --i)
+	v = (v << 8) | p[i];
+	/* The 8 byte values are signed, in two's complement. */
+	return (int64_t)v;
+}
+
+/* Value from the stored data that has to fit into off_t. */
+static int index_off(const unsigned char *p, off_t *val)
+{
+	int64_t v = index_get(p, 8);
+	*val = (off_t)v;
+	return (int64_t)*val == v;
+}
+
+int attribute_align_arg mpg123_index_save(mpg123_handle *mh, unsigned char *data, size_t *size)
+{
+	int b;
+	size_t need;
+	off_t step = 1;
+	size_t fill = 0;
+
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(size == NULL){ mh->err = MPG123_NULL_POINTER; return MPG123_ERR; }
+	/* The first header and audio_start identify the stream. */
+	b = init_track(mh);
+	if(b < 0) return b == MPG123_DONE ? MPG123_ERR : b;
+#ifdef FRAME_INDEX
+	step = mh->index.step;
+	fill = mh->index.fill;
+#endif
+	need = INDEX_HEAD + 8*fill + 4;
+	if(data == NULL){ *size = need; return MPG123_OK; }
+	if(*size < need)
+	{
+		*size = need;
+		mh->err = MPG123_BAD_BUFFER;
+		return MPG123_ERR;
+	}
+
+	memset(data, 0, INDEX_HEAD);
+	memcpy(data, INDEX_MAGIC, 8);
+	index_put(data+8, INDEX_VERSION, 4);
+	index_put(data+12, (mh->xing_toc != NULL ? INDEX_TOC : 0)
+	|	(mh->state_flags & FRAME_ACCURATE ? INDEX_ACCURATE : 0), 4);
+	index_put(data+16, mh->rdat.filelen, 8);
+	index_put(data+24, stream_mtime(mh), 8);
+	index_put(data+32, mh->firsthead, 4);
+	index_put(data+40, mh->audio_start, 8);
+	index_put(data+48, mh->track_frames, 8);
+	index_put(data+56, mh->track_samples, 8);
+#ifdef GAPLESS
+	index_put(data+64, mh->gapless_frames, 8);
+	index_put(data+72, mh->begin_s, 8);
+	index_put(data+80, mh->end_s, 8);
+#else
+	index_put(data+64, -1, 8);
+#endif
+	index_put(data+88, step, 8);
+	index_put(data+96, (int64_t)fill, 8);
+	if(mh->xing_toc != NULL) memcpy(data+104, mh->xing_toc, 100);
+#ifdef FRAME_INDEX
+	{
+		size_t i;
+		for(i=0; i<fill; ++i)
+		index_put(data+INDEX_HEAD+8*i, mh->index.data[i], 8);
+	}
+#endif
+	index_put(data+need-4, index_crc(data, need-4), 4);
+	*size = need;
+	return MPG123_OK;
+}
+
+int attribute_align_arg mpg123_index_load(mpg123_handle *mh, const unsigned char *data, size_t size)
+{
+	int b;
+	int flags;
+	int64_t fill;
+	off_t oldpos, filelen, audio_start, track_frames, track_samples, step;
+#ifdef GAPLESS
+	off_t gapless_frames, begin_s, end_s;
+#endif
+#ifdef FRAME_INDEX
+	off_t *offsets = NULL;
+	size_t i;
+#endif
+
+	if(mh == NULL) return MPG123_BAD_HANDLE;
+	if(data == NULL){ mh->err = MPG123_NULL_POINTER; return MPG123_ERR; }
+	/* Format and integrity first, then whether it fits the stream. */
+	if(  size < INDEX_HEAD+4 || memcmp(data, INDEX_MAGIC, 8)
+	  || index_get(data+8, 4) != INDEX_VERSION
+	  || index_get(data+size-4, 4) != index_crc(data, size-4) )
+	goto bad_data;
+	fill = index_get(data+96, 8);
+	if(fill < 0 || (uint64_t)fill != (size-INDEX_HEAD-4)/8 || (size-INDEX_HEAD-4)%8)
+	goto bad_data;
+	flags = (int)index_get(data+12, 4);
+	if(  !index_off(data+16, &filelen) || !index_off(data+40, &audio_start)
+	  || !index_off(data+48, &track_frames) || !index_off(data+56, &track_samples)
+	  || !index_off(data+88, &step) || step < 1 || audio_start < 0 )
+	goto bad_data;
+#ifdef GAPLESS
+	if(  !index_off(data+64, &gapless_frames) || !index_off(data+72, &begin_s)
+	  || !index_off(data+80, &end_s) )
+	goto bad_data;
+#endif
+	if(  filelen != mh->rdat.filelen || filelen < 0
+	  || index_get(data+24, 8) != stream_mtime(mh) )
+	goto bad_data;
+
+	b = init_track(mh);
+	if(b < 0) return b == MPG123_DONE ? MPG123_ERR : b;
+	if(  (unsigned long)index_get(data+32, 4) != mh->firsthead
+	  || audio_start != mh->audio_start )
+	goto bad_data;
+
+#ifdef FRAME_INDEX
+	if(fill > 0)
+	{
+		offsets = malloc((size_t)fill*sizeof(off_t));
+		if(offsets == NULL){ mh->err = MPG123_OUT_OF_MEM; return MPG123_ERR; }
+		for(i=0; i<(size_t)fill; ++i)
+		if(  !index_off(data+INDEX_HEAD+8*i, offsets+i)
+		  || offsets[i] < audio_start || offsets[i] >= filelen )
+		{
+			free(offsets);
+			goto bad_data;
+		}
+	}
+	b = fi_set(&mh->index, offsets, step, (size_t)fill);
+	free(offsets);
+	if(b == -1){ mh->err = MPG123_OUT_OF_MEM; return MPG123_ERR; }
+#endif
+
+	oldpos = mpg123_tell(mh);
+	mh->track_frames  = track_frames;
+	mh->track_samples = track_samples;
+	if(flags & INDEX_TOC) frame_fill_toc(mh, (unsigned char*)data+104);
+	if(flags & INDEX_ACCURATE) mh->state_flags |= FRAME_ACCURATE;
+#ifdef GAPLESS
+	mh->gapless_frames = gapless_frames;
+	mh->begin_s = begin_s;
+	mh->end_s   = end_s;
+	frame_gapless_realinit(mh);
+#endif
+	/* Seeking back to where we are brings the new offsets into effect. */
+	return mpg123_seek(mh, oldpos, SEEK_SET) >= 0 ? MPG123_OK : MPG123_ERR;
+
+bad_data:
+	mh->err = MPG123_BAD_INDEX_DATA;
+	return MPG123_ERR;
+}
+
 int attribute_align_arg mpg123_close(mpg123_handle *mh)
 {
 	if(mh == NULL) return MPG123_BAD_HANDLE;
@@ -1673,6 +2252,7 @@ static const char *mpg123_error[] =
 	,"Custom I/O obviously not prepared."
 	,"Overflow in LFS (large file support) conversion."
 	,"Overflow in integer conversion."
+	,"Stored index data is damaged or does not match the stream."
 };
 
 const char* attribute_align_arg mpg123_plain_strerror(int errcode)
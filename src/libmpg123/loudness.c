@@ -0,0 +1,397 @@
+/*
+	loudness.c: loudness meter on the decoded output (MPG123_LOUDNESS)
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	Integrated loudness after ITU-R BS.1770-4 and EBU R128: The samples go
+	through the K-weighting filter (a high shelf and a high pass biquad),
+	the mean square over the channels is taken in blocks of 400 ms that
+	overlap by 75 %. Blocks above the absolute gate of -70 LUFS are counted
+	in a histogram of 0.1 LU wide bins that also sums their energy. The
+	integrated loudness is the mean over the blocks above the relative gate,
+	10 LU below the mean of the counted ones. Thus, memory does not grow
+	with the stream and the value can be asked for at any time. The bins
+	only blur the relative gate, which is rounded to the bin below.
+
+	The true peak is the largest magnitude of the samples upsampled by 4,
+	through a Hann-windowed sinc of LOUDNESS_TAPS taps per phase.
+
+	The meter sees the output after gapless trimming, with the volume and
+	RVA scaling divided out again. So it measures the stream itself and
+	the result can go right back into the RVA gain (mpg123_loudness_rva()).
+	The samples are processed in chunks of LOUDNESS_CHUNK per channel, the
+	format conversion and the interpolation dot products being simple loops
+	over those for the compiler to vectorize.
+*/
+
+#include "mpg123lib_intern.h"
+#include "debug.h"
+
+#define LD_ABS_GATE -70.
+#define LD_REL_GATE -10.
+#define LD_BIN_RES  10     /* bins per LU */
+#define LD_BINS     (80*LD_BIN_RES) /* -70 to +10 LUFS, louder blocks go to the last one */
+#define LD_SEGMENT  16     /* samples per decision to interpolate for the true peak */
+#define LD_TINY     1e-30  /* filter state below that is flushed to zero */
+
+/* Filter state, for a seek or a new format. */
+void loudness_reset(mpg123_handle *fr)
+{
+	memset(fr->ld.z, 0, sizeof(fr->ld.z));
+	memset(fr->ld.hist, 0, sizeof(fr->ld.hist));
+	fr->ld.part = 0;
+	fr->ld.partsum = 0.;
+	fr->ld.subs = 0;
+	fr->ld.subpos = 0;
+}
+
+/* The measurement, for a new track. */
+void loudness_clear(mpg123_handle *fr)
+{
+	loudness_reset(fr);
+	if(fr->ld.bins != NULL)
+		memset(fr->ld.bins, 0, 2*LD_BINS*sizeof(double));
+	fr->ld.blocks = 0;
+	fr->ld.momentary = -1.;
+	fr->ld.peak = 0.;
+}
+
+void loudness_exit(mpg123_handle *fr)
+{
+	if(fr->ld.bins != NULL) free(fr->ld.bins);
+	fr->ld.bins = NULL;
+	loudness_clear(fr);
+}
+
+/* Filters for the output rate, as given in BS.1770 for 48 kHz and
+   generalized by the bilinear transform of the analog prototypes. */
+static void ld_setup(mpg123_handle *fr)
+{
+	double rate = fr->af.rate;
+	double K, Q, Vh, Vb, a0;
+	int p, k;
+
+	Q  = 0.7071752369554196;
+	K  = tan(M_PI*1681.974450955533/rate);
+	Vh = pow(10., 3.999843853973347/20.);
+	Vb = pow(Vh, 0.4996667741545416);
+	a0 = 1. + K/Q + K*K;
+	fr->ld.b[0] = (Vh + Vb*K/Q + K*K)/a0;
+	fr->ld.b[1] = 2.*(K*K - Vh)/a0;
+	fr->ld.b[2] = (Vh - Vb*K/Q + K*K)/a0;
+	fr->ld.a[0][0] = 2.*(K*K - 1.)/a0;
+	fr->ld.a[0][1] = (1. - K/Q + K*K)/a0;
+
+	Q  = 0.5003270373238773;
+	K  = tan(M_PI*38.13547087602444/rate);
+	a0 = 1. + K/Q + K*K;
+	fr->ld.a[1][0] = 2.*(K*K - 1.)/a0;
+	fr->ld.a[1][1] = (1. - K/Q + K*K)/a0;
+
+	/* Phase p sits p/LOUDNESS_PHASES after tap LOUDNESS_TAPS/2-1, phase 0
+	   just picks that sample. The phases of a tap are next to each other,
+	   for the vectorizer. */
+	fr->ld.tp_gain = 1.;
+	for(k=0; k<LOUDNESS_TAPS; ++k)
+		fr->ld.tp[k][0] = k == LOUDNESS_TAPS/2-1 ? 1. : 0.;
+	for(p=1; p<LOUDNESS_PHASES; ++p)
+	{
+		double sum = 0., gain = 0.;
+		for(k=0; k<LOUDNESS_TAPS; ++k)
+		{
+			double t = LOUDNESS_TAPS/2-1 + (double)p/LOUDNESS_PHASES - k;
+			double c = sin(M_PI*t)/(M_PI*t);
+			c *= 0.5 + 0.5*cos(M_PI*t/(LOUDNESS_TAPS/2));
+			fr->ld.tp[k][p] = c;
+			sum += c;
+		}
+		for(k=0; k<LOUDNESS_TAPS; ++k)
+		{
+			fr->ld.tp[k][p] /= sum;
+			gain += fabs(fr->ld.tp[k][p]);
+		}
+		if(gain > fr->ld.tp_gain) fr->ld.tp_gain = gain;
+	}
+	/* The 100 ms steps of the gating blocks. */
+	fr->ld.partlen = (fr->af.rate+5)/10;
+	fr->ld.rate = fr->af.rate;
+	fr->ld.channels = fr->af.channels;
+	loudness_reset(fr);
+}
+
+/* One 100 ms part done, which may complete a 400 ms block. */
+static void ld_part(mpg123_handle *fr)
+{
+	double e;
+	int i;
+
+	fr->ld.sub[fr->ld.subpos] = fr->ld.partsum/fr->ld.partlen;
+	fr->ld.subpos = (fr->ld.subpos+1) % 4;
+	fr->ld.part = 0;
+	fr->ld.partsum = 0.;
+	if(fr->ld.subs < 4 && ++fr->ld.subs < 4) return;
+
+	for(e=0., i=0; i<4; ++i) e += fr->ld.sub[i];
+	e /= 4;
+	fr->ld.momentary = e;
+	if(e > 0.)
+	{
+		double l = LOUDNESS_OFFSET + 10.*log10(e);
+		if(l > LD_ABS_GATE)
+		{
+			long bin = (long)((l-LD_ABS_GATE)*LD_BIN_RES);
+			if(bin >= LD_BINS) bin = LD_BINS-1;
+			fr->ld.bins[2*bin]   += 1.;
+			fr->ld.bins[2*bin+1] += e;
+			++fr->ld.blocks;
+		}
+	}
+}
+
+/* Convert n samples per channel at the start of in to the history arrays. */
+#define LD_CONVERT(type, expr) \
+{ \
+	const type *smp = (const type*)in; \
+	for(i=0; i<n; ++i) \
+	for(c=0; c<ch; ++c) \
+		fr->ld.hist[c][LOUDNESS_TAPS-1+i] = scale*(expr); \
+}
+
+static void ld_convert(mpg123_handle *fr, const unsigned char *in, size_t n, double scale)
+{
+	int ch = fr->af.channels;
+	size_t i;
+	int c;
+
+	switch(fr->af.encoding)
+	{
+		case MPG123_ENC_FLOAT_32:
+			LD_CONVERT(float, smp[i*ch+c])
+		break;
+		case MPG123_ENC_FLOAT_64:
+			LD_CONVERT(double, smp[i*ch+c])
+		break;
+		case MPG123_ENC_SIGNED_16:
+			LD_CONVERT(int16_t, smp[i*ch+c]/32768.)
+		break;
+		case MPG123_ENC_UNSIGNED_16:
+			LD_CONVERT(uint16_t, ((long)smp[i*ch+c]-32768)/32768.)
+		break;
+		case MPG123_ENC_SIGNED_32:
+			LD_CONVERT(int32_t, smp[i*ch+c]/2147483648.)
+		break;
+		case MPG123_ENC_UNSIGNED_32:
+			LD_CONVERT(uint32_t, ((double)smp[i*ch+c]-2147483648.)/2147483648.)
+		break;
+		case MPG123_ENC_SIGNED_8:
+			LD_CONVERT(signed char, smp[i*ch+c]/128.)
+		break;
+		case MPG123_ENC_UNSIGNED_8:
+			LD_CONVERT(unsigned char, ((int)smp[i*ch+c]-128)/128.)
+		break;
+		case MPG123_ENC_SIGNED_24:
+		case MPG123_ENC_UNSIGNED_24:
+		{
+			long flip = fr->af.encoding == MPG123_ENC_UNSIGNED_24 ? 0x800000 : 0;
+			for(i=0; i<n; ++i)
+			for(c=0; c<ch; ++c)
+			{
+				const unsigned char *b = in+3*(i*ch+c);
+				long v;
+#ifdef WORDS_BIGENDIAN
+				v = ((long)b[0]<<16) | ((long)b[1]<<8) | b[2];
+#else
+				v = ((long)b[2]<<16) | ((long)b[1]<<8) | b[0];
+#endif
+				v ^= flip;
+				if(v & 0x800000) v -= 0x1000000;
+				fr->ld.hist[c][LOUDNESS_TAPS-1+i] = scale*v/8388608.;
+			}
+		}
+		break;
+	}
+}
+
+/* Largest magnitude of the samples and of the points in between. The
+   interpolation only runs on segments where the sum of the coefficient
+   magnitudes times the largest sample could beat the peak so far. */
+static double ld_peak(mpg123_handle *fr, const double *h, size_t n, double peak)
+{
+	size_t i, j, end;
+
+	for(j=0; j<n; j=end)
+	{
+		double m = 0.;
+		double pk[LOUDNESS_PHASES];
+		int p, k;
+
+		end = j+LD_SEGMENT < n ? j+LD_SEGMENT : n;
+		for(i=j; i<end+LOUDNESS_TAPS-1; ++i)
+		{
+			double a = fabs(h[i]);
+			m = a > m ? a : m;
+		}
+		peak = m > peak ? m : peak;
+		if(m*fr->ld.tp_gain <= peak)
+			continue;
+		for(p=0; p<LOUDNESS_PHASES; ++p)
+			pk[p] = 0.;
+		for(i=j; i<end; ++i)
+		{
+			double v[LOUDNESS_PHASES];
+			for(p=0; p<LOUDNESS_PHASES; ++p)
+				v[p] = 0.;
+			for(k=0; k<LOUDNESS_TAPS; ++k)
+			for(p=0; p<LOUDNESS_PHASES; ++p)
+				v[p] += fr->ld.tp[k][p]*h[i+k];
+			for(p=0; p<LOUDNESS_PHASES; ++p)
+			{
+				double a = fabs(v[p]);
+				pk[p] = a > pk[p] ? a : pk[p];
+			}
+		}
+		for(p=0; p<LOUDNESS_PHASES; ++p)
+			peak = pk[p] > peak ? pk[p] : peak;
+	}
+	return peak;
+}
+
+/* One sample of channel c through the shelf and the high pass, in direct
+   form I with the state s[c]: last two inputs, shelf and filter outputs. */
+#define LD_KWEIGHT(c, x, w) \
+{ \
+	double y = b0*(x) + b1*s[c][0] + b2*s[c][1] - a0*s[c][2] - a1*s[c][3]; \
+	w = y - 2.*s[c][2] + s[c][3] - ha0*s[c][4] - ha1*s[c][5]; \
+	s[c][1] = s[c][0]; \
+	s[c][0] = (x); \
+	s[c][3] = s[c][2]; \
+	s[c][2] = y; \
+	s[c][5] = s[c][4]; \
+	s[c][4] = w; \
+}
+
+/* Summed squares of the K-weighted channels for the n new samples.
+   Both channels go through one loop, so their recursions overlap. */
+static void ld_kweight(mpg123_handle *fr, size_t n, double *e)
+{
+	const double *x0 = fr->ld.hist[0]+LOUDNESS_TAPS-1;
+	const double *x1 = fr->ld.hist[1]+LOUDNESS_TAPS-1;
+	double b0 = fr->ld.b[0], b1 = fr->ld.b[1], b2 = fr->ld.b[2];
+	double a0 = fr->ld.a[0][0], a1 = fr->ld.a[0][1];
+	double ha0 = fr->ld.a[1][0], ha1 = fr->ld.a[1][1];
+	double s[2][6];
+	size_t i;
+
+	memcpy(s, fr->ld.z, sizeof(s));
+	if(fr->ld.channels == 2)
+	for(i=0; i<n; ++i)
+	{
+		double w0, w1;
+		LD_KWEIGHT(0, x0[i], w0)
+		LD_KWEIGHT(1, x1[i], w1)
+		e[i] = w0*w0 + w1*w1;
+	}
+	else
+	for(i=0; i<n; ++i)
+	{
+		double w0;
+		LD_KWEIGHT(0, x0[i], w0)
+		e[i] = w0*w0;
+	}
+	/* Silence would let the state decay into denormals, which are slow. */
+	for(i=0; i<6; ++i)
+	{
+		if(fabs(s[0][i]) < LD_TINY) s[0][i] = 0.;
+		if(fabs(s[1][i]) < LD_TINY) s[1][i] = 0.;
+	}
+	memcpy(fr->ld.z, s, sizeof(s));
+}
+
+/* Meter the (trimmed, interleaved) output buffer of a frame. */
+int loudness_buffer(mpg123_handle *fr)
+{
+	const unsigned char *in = fr->buffer.p;
+	size_t left, n, i;
+	double scale;
+	int ch, c;
+
+	if(!(fr->p.flags & MPG123_LOUDNESS) || !fr->buffer.fill)
+		return MPG123_OK;
+	/* Samples that do not map linearly, or no level at all. */
+	if(  fr->af.encoding == MPG123_ENC_ULAW_8 || fr->af.encoding == MPG123_ENC_ALAW_8
+	  || fr->lastscale <= 0. )
+		return MPG123_OK;
+	if(fr->ld.bins == NULL)
+	{
+		fr->ld.bins = malloc(2*LD_BINS*sizeof(double));
+		if(fr->ld.bins == NULL)
+		{
+			if(NOQUIET) error("cannot allocate loudness histogram");
+			fr->err = MPG123_OUT_OF_MEM;
+			return MPG123_ERR;
+		}
+		memset(fr->ld.bins, 0, 2*LD_BINS*sizeof(double));
+	}
+	if(fr->ld.rate != fr->af.rate || fr->ld.channels != fr->af.channels)
+		ld_setup(fr);
+
+	ch = fr->af.channels;
+	scale = 1./fr->lastscale;
+	left = fr->buffer.fill/(fr->af.encsize*ch);
+	while(left)
+	{
+		double e[LOUDNESS_CHUNK];
+
+		n = left < LOUDNESS_CHUNK ? left : LOUDNESS_CHUNK;
+		ld_convert(fr, in, n, scale);
+		in   += n*fr->af.encsize*ch;
+		left -= n;
+		for(c=0; c<ch; ++c)
+		{
+			fr->ld.peak = ld_peak(fr, fr->ld.hist[c], n, fr->ld.peak);
+		}
+		ld_kweight(fr, n, e);
+		for(c=0; c<ch; ++c)
+			memmove(fr->ld.hist[c], fr->ld.hist[c]+n, (LOUDNESS_TAPS-1)*sizeof(double));
+		/* Channel weights are 1 for mono and stereo, just the sum counts. */
+		for(i=0; i<n; )
+		{
+			size_t take = (size_t)(fr->ld.partlen - fr->ld.part);
+			size_t j;
+			double sum = 0.;
+			if(take > n-i) take = n-i;
+			for(j=0; j<take; ++j) sum += e[i+j];
+			fr->ld.partsum += sum;
+			fr->ld.part += take;
+			i += take;
+			if(fr->ld.part == fr->ld.partlen) ld_part(fr);
+		}
+	}
+	return MPG123_OK;
+}
+
+/* Gated loudness in LUFS, returning the number of blocks it covers. */
+long loudness_integrated(mpg123_handle *fr, double *lufs)
+{
+	double count = 0., energy = 0.;
+	long bin, start;
+
+	*lufs = 0.;
+	if(!fr->ld.blocks) return 0;
+	for(bin=0; bin<LD_BINS; ++bin)
+	{
+		count  += fr->ld.bins[2*bin];
+		energy += fr->ld.bins[2*bin+1];
+	}
+	start = (long)((LOUDNESS_OFFSET + 10.*log10(energy/count) + LD_REL_GATE - LD_ABS_GATE)*LD_BIN_RES);
+	if(start < 0) start = 0;
+	count = energy = 0.;
+	for(bin=start; bin<LD_BINS; ++bin)
+	{
+		count  += fr->ld.bins[2*bin];
+		energy += fr->ld.bins[2*bin+1];
+	}
+	*lufs = LOUDNESS_OFFSET + 10.*log10(energy/count);
+	return (long)count;
+}
@@ -302,6 +302,8 @@ off_t bytes_to_samples(mpg123_handle *fr , off_t b);
 off_t outblock_bytes(mpg123_handle *fr, off_t s);
 /* Postprocessing format conversion of freshly decoded buffer. */
 void postprocess_buffer(mpg123_handle *fr);
+/* Left and right channel planes for MPG123_PLANAR, after gapless trimming. */
+int planar_buffer(mpg123_handle *fr);
 
 /* If networking is enabled and we really mean internal networking, the timeout_read function is available. */
 #if defined (NETWORK) && !defined (WANT_WIN32_SOCKETS)
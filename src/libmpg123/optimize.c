@@ -28,6 +28,7 @@ static struct cpuflags cpu_flags;
 #define cpu_sse2(s)     1
 #define cpu_sse3(s)     1
 #define cpu_avx(s)      1
+#define cpu_avx512(s)   1
 #define cpu_neon(s)     1
 #endif
 
@@ -136,6 +137,78 @@ const func_synth plain_i386[r_limit][f_limit] =
 #endif
 
 
+#if defined(OPT_X86_64) || defined(OPT_AVX) || defined(OPT_NEON) || defined(OPT_NEON64)
+/* Downsampling synths of the float SIMD decoders, on top of their dct64 and window tables.
+   The 1to1 entries stay with the decoder-specific assignments. */
+
+#ifdef OPT_X86_64
+static const func_synth down_x86_64[r_limit][f_limit] =
+{
+	 OUT_SYNTHS(NULL, NULL, NULL, NULL)
+#	ifndef NO_DOWNSAMPLE
+	,OUT_SYNTHS(synth_2to1_x86_64, synth_2to1_8bit_x86_64, synth_2to1_real_x86_64, synth_2to1_s32_x86_64)
+	,OUT_SYNTHS(synth_4to1_x86_64, synth_4to1_8bit_x86_64, synth_4to1_real_x86_64, synth_4to1_s32_x86_64)
+#	endif
+#	ifndef NO_NTOM
+	,OUT_SYNTHS(synth_ntom_x86_64, synth_ntom_8bit_x86_64, synth_ntom_real_x86_64, synth_ntom_s32_x86_64)
+#	endif
+};
+#endif
+
+#ifdef OPT_AVX
+static const func_synth down_avx[r_limit][f_limit] =
+{
+	 OUT_SYNTHS(NULL, NULL, NULL, NULL)
+#	ifndef NO_DOWNSAMPLE
+	,OUT_SYNTHS(synth_2to1_avx, synth_2to1_8bit_avx, synth_2to1_real_avx, synth_2to1_s32_avx)
+	,OUT_SYNTHS(synth_4to1_avx, synth_4to1_8bit_avx, synth_4to1_real_avx, synth_4to1_s32_avx)
+#	endif
+#	ifndef NO_NTOM
+	,OUT_SYNTHS(synth_ntom_avx, synth_ntom_8bit_avx, synth_ntom_real_avx, synth_ntom_s32_avx)
+#	endif
+};
+#endif
+
+#ifdef OPT_NEON
+static const func_synth down_neon[r_limit][f_limit] =
+{
+	 OUT_SYNTHS(NULL, NULL, NULL, NULL)
+#	ifndef NO_DOWNSAMPLE
+	,OUT_SYNTHS(synth_2to1_neon, synth_2to1_8bit_neon, synth_2to1_real_neon, synth_2to1_s32_neon)
+	,OUT_SYNTHS(synth_4to1_neon, synth_4to1_8bit_neon, synth_4to1_real_neon, synth_4to1_s32_neon)
+#	endif
+#	ifndef NO_NTOM
+	,OUT_SYNTHS(synth_ntom_neon, synth_ntom_8bit_neon, synth_ntom_real_neon, synth_ntom_s32_neon)
+#	endif
+};
+#endif
+
+#ifdef OPT_NEON64
+static const func_synth down_neon64[r_limit][f_limit] =
+{
+	 OUT_SYNTHS(NULL, NULL, NULL, NULL)
+#	ifndef NO_DOWNSAMPLE
+	,OUT_SYNTHS(synth_2to1_neon64, synth_2to1_8bit_neon64, synth_2to1_real_neon64, synth_2to1_s32_neon64)
+	,OUT_SYNTHS(synth_4to1_neon64, synth_4to1_8bit_neon64, synth_4to1_real_neon64, synth_4to1_s32_neon64)
+#	endif
+#	ifndef NO_NTOM
+	,OUT_SYNTHS(synth_ntom_neon64, synth_ntom_8bit_neon64, synth_ntom_real_neon64, synth_ntom_s32_neon64)
+#	endif
+};
+#endif
+
+static void set_down_synths(mpg123_handle *fr, const func_synth down[r_limit][f_limit])
+{
+	enum synth_resample ri;
+	enum synth_format   fi;
+	for(ri=0; ri<r_limit; ++ri)
+	for(fi=0; fi<f_limit; ++fi)
+	if(down[ri][fi] != NULL)
+	fr->synths.plain[ri][fi] = down[ri][fi];
+}
+#endif
+
+
 enum optdec defdec(void){ return defopt; }
 
 enum optcla decclass(const enum optdec type)
@@ -151,6 +224,7 @@ enum optcla decclass(const enum optdec type)
 		|| type == neon
 		|| type == neon64
 		|| type == avx
+		|| type == avx512
 	) ? mmxsse : normal;
 }
 
@@ -247,6 +321,9 @@ static int find_dectype(mpg123_handle *fr)
 #ifdef OPT_X86_64
 	else if(basic_synth == synth_1to1_x86_64) type = x86_64;
 #endif
+#ifdef OPT_AVX512
+	else if(basic_synth == synth_1to1_avx512) type = avx512;
+#endif
 #ifdef OPT_AVX
 	else if(basic_synth == synth_1to1_avx) type = avx;
 #endif
@@ -285,6 +362,9 @@ static int find_dectype(mpg123_handle *fr)
 #ifdef OPT_X86_64
 	else if(basic_synth == synth_1to1_real_x86_64) type = x86_64;
 #endif
+#ifdef OPT_AVX512
+	else if(basic_synth == synth_1to1_real_avx512) type = avx512;
+#endif
 #ifdef OPT_AVX
 	else if(basic_synth == synth_1to1_real_avx) type = avx;
 #endif
@@ -310,6 +390,9 @@ static int find_dectype(mpg123_handle *fr)
 #ifdef OPT_X86_64
 	else if(basic_synth == synth_1to1_s32_x86_64) type = x86_64;
 #endif
+#ifdef OPT_AVX512
+	else if(basic_synth == synth_1to1_s32_avx512) type = avx512;
+#endif
 #ifdef OPT_AVX
 	else if(basic_synth == synth_1to1_s32_avx) type = avx;
 #endif
@@ -326,6 +409,26 @@ static int find_dectype(mpg123_handle *fr)
 
 #endif /* any 32 bit synth */
 
+#ifdef OPT_X86_64
+	else if(find_synth(basic_synth, down_x86_64)) type = x86_64;
+#endif
+#ifdef OPT_AVX
+	/* AVX-512 shares these, telling by the chosen decoder. */
+	else if(find_synth(basic_synth, down_avx))
+	{
+		type = avx;
+#		ifdef OPT_AVX512
+		if(fr->cpu_opts.type == avx512)
+		type = avx512;
+#		endif
+	}
+#endif
+#ifdef OPT_NEON
+	else if(find_synth(basic_synth, down_neon)) type = neon;
+#endif
+#ifdef OPT_NEON64
+	else if(find_synth(basic_synth, down_neon64)) type = neon64;
+#endif
 #ifdef OPT_X86
 	else if(find_synth(basic_synth, plain_i386))
 	type = idrei;
@@ -364,6 +467,7 @@ int set_synth_functions(mpg123_handle *fr)
 {
 	enum synth_resample resample = r_none;
 	enum synth_format basic_format = f_none; /* Default is always 16bit, or whatever. */
+	enum synth_format out_format;
 
 	/* Select the basic output format, different from 16bit: 8bit, real. */
 	if(FALSE){}
@@ -413,6 +517,24 @@ int set_synth_functions(mpg123_handle *fr)
 		return -1;
 	}
 
+	/* The filtering resampler works on the float output of the 1to1 synth.
+	   It replaces fr->synth_stereo and fr->synth_mono below; fr->synth stays the 1to1 one. */
+	out_format = basic_format;
+#ifdef RESAMPLE_SINC
+	fr->rs.taps = 0;
+	if(resample == r_ntom && fr->p.resample != MPG123_RESAMPLE_NTOM)
+	{
+		if(resample_init(fr) != 0)
+		{
+			if(NOQUIET) error("Failed to set up the resampler!");
+
+			return -1;
+		}
+		resample = r_1to1;
+		basic_format = f_real;
+	}
+#endif
+
 	debug2("selecting synth: resample=%i format=%i", resample, basic_format);
 	/* Finally selecting the synth functions for stereo / mono. */
 	fr->synth = fr->synths.plain[resample][basic_format];
@@ -420,6 +542,16 @@ int set_synth_functions(mpg123_handle *fr)
 	fr->synth_mono = fr->af.channels==2
 		? fr->synths.mono2stereo[resample][basic_format] /* Mono MPEG file decoded to stereo. */
 		: fr->synths.mono[resample][basic_format];       /* Mono MPEG file decoded to mono. */
+#ifdef RESAMPLE_SINC
+	if(fr->rs.taps)
+	{
+		fr->rs.format = out_format;
+		fr->rs.synth_stereo = fr->synth_stereo;
+		fr->rs.synth_mono = fr->synths.mono[resample][basic_format]; /* Duplication is done after filtering. */
+		fr->synth_stereo = resample_stereo;
+		fr->synth_mono = resample_mono;
+	}
+#endif
 
 	if(find_dectype(fr) != MPG123_OK) /* Actually determine the currently active decoder breed. */
 	{
@@ -436,7 +568,7 @@ int set_synth_functions(mpg123_handle *fr)
 	}
 
 #ifndef NO_8BIT
-	if(basic_format == f_8)
+	if(out_format == f_8)
 	{
 		if(make_conv16to8_table(fr) != 0)
 		{
@@ -451,6 +583,7 @@ int set_synth_functions(mpg123_handle *fr)
 	/* Special treatment for MMX, SSE and 3DNowExt stuff.
 	   The real-decoding SSE for x86-64 uses normal tables! */
 	if(fr->cpu_opts.class == mmxsse
+	   && resample == r_1to1 /* Downsampling synths use the float window. */
 #	ifndef NO_REAL
 	   && basic_format != f_real
 #	endif
@@ -464,14 +597,17 @@ int set_synth_functions(mpg123_handle *fr)
 	   && fr->cpu_opts.type != neon
 	   && fr->cpu_opts.type != neon64
 	   && fr->cpu_opts.type != avx
+#	endif
+#	ifdef OPT_AVX512
+	   && fr->cpu_opts.type != avx512 /* Only has the float window synth. */
 #	endif
 	  )
 	{
 #ifndef NO_LAYER3
-		init_layer3_stuff(fr, init_layer3_gainpow2_mmx);
+		init_layer3_stuff(fr, 1);
 #endif
 #ifndef NO_LAYER12
-		init_layer12_stuff(fr, init_layer12_table_mmx);
+		init_layer12_stuff(fr, 1);
 #endif
 		fr->make_decode_tables = make_decode_tables_mmx;
 	}
@@ -479,10 +615,10 @@ int set_synth_functions(mpg123_handle *fr)
 #endif
 	{
 #ifndef NO_LAYER3
-		init_layer3_stuff(fr, init_layer3_gainpow2);
+		init_layer3_stuff(fr, 0);
 #endif
 #ifndef NO_LAYER12
-		init_layer12_stuff(fr, init_layer12_table);
+		init_layer12_stuff(fr, 0);
 #endif
 		fr->make_decode_tables = make_decode_tables;
 	}
@@ -524,6 +660,22 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 #if (defined OPT_3DNOW_VINTAGE || defined OPT_3DNOWEXT_VINTAGE || defined OPT_SSE || defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON || defined OPT_NEON64)
 	fr->cpu_opts.the_dct36 = dct36;
 #endif
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+	fr->cpu_opts.the_antialias = antialias;
+	fr->cpu_opts.the_stereo_ms = stereo_ms;
+	fr->cpu_opts.the_stereo_is = stereo_is;
+	fr->cpu_opts.the_dct12 = NULL;
+#endif
+#endif
+#ifndef NO_LAYER12
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+	fr->cpu_opts.the_dequant_layer12 = dequant_layer12;
+#endif
+#endif
+#ifdef RESAMPLE_SINC
+#if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+	fr->cpu_opts.the_resample_dot = resample_dot;
+#endif
 #endif
 #endif
 	/* covers any i386+ cpu; they actually differ only in the synth_1to1 function, mostly... */
@@ -734,6 +886,43 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 
 #endif /* OPT_X86 */
 
+#ifdef OPT_AVX512
+	if(!done && (auto_choose || want_dec == avx512) && cpu_avx512(cpu_flags))
+	{
+		chosen = "x86-64 (AVX-512)";
+		fr->cpu_opts.type = avx512;
+#ifdef OPT_MULTI
+#		ifndef NO_LAYER3
+		fr->cpu_opts.the_dct36 = dct36_avx;
+		fr->cpu_opts.the_antialias = antialias_avx;
+		fr->cpu_opts.the_stereo_ms = stereo_ms_avx;
+		fr->cpu_opts.the_stereo_is = stereo_is_avx;
+		fr->cpu_opts.the_dct12 = dct12_x86_64;
+#		endif
+#		ifndef NO_LAYER12
+		fr->cpu_opts.the_dequant_layer12 = dequant_layer12_x86_64;
+#		endif
+#		ifdef RESAMPLE_SINC
+		fr->cpu_opts.the_resample_dot = resample_dot_avx;
+#		endif
+#endif
+#		ifndef NO_16BIT
+		fr->synths.plain[r_1to1][f_16] = synth_1to1_avx512;
+		fr->synths.stereo[r_1to1][f_16] = synth_1to1_stereo_avx512;
+#		endif
+#		ifndef NO_REAL
+		fr->synths.plain[r_1to1][f_real] = synth_1to1_real_avx512;
+		fr->synths.stereo[r_1to1][f_real] = synth_1to1_fltst_avx512;
+#		endif
+#		ifndef NO_32BIT
+		fr->synths.plain[r_1to1][f_32] = synth_1to1_s32_avx512;
+		fr->synths.stereo[r_1to1][f_32] = synth_1to1_s32_stereo_avx512;
+#		endif
+		set_down_synths(fr, down_avx);
+		done = 1;
+	}
+#endif
+
 #ifdef OPT_AVX
 	if(!done && (auto_choose || want_dec == avx) && cpu_avx(cpu_flags))
 	{
@@ -742,6 +931,16 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 #ifdef OPT_MULTI
 #		ifndef NO_LAYER3
 		fr->cpu_opts.the_dct36 = dct36_avx;
+		fr->cpu_opts.the_antialias = antialias_avx;
+		fr->cpu_opts.the_stereo_ms = stereo_ms_avx;
+		fr->cpu_opts.the_stereo_is = stereo_is_avx;
+		fr->cpu_opts.the_dct12 = dct12_x86_64;
+#		endif
+#		ifndef NO_LAYER12
+		fr->cpu_opts.the_dequant_layer12 = dequant_layer12_x86_64;
+#		endif
+#		ifdef RESAMPLE_SINC
+		fr->cpu_opts.the_resample_dot = resample_dot_avx;
 #		endif
 #endif
 #		ifndef NO_16BIT
@@ -756,6 +955,7 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 		fr->synths.plain[r_1to1][f_32] = synth_1to1_s32_avx;
 		fr->synths.stereo[r_1to1][f_32] = synth_1to1_s32_stereo_avx;
 #		endif
+		set_down_synths(fr, down_avx);
 		done = 1;
 	}
 #endif
@@ -768,6 +968,16 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 #ifdef OPT_MULTI
 #		ifndef NO_LAYER3
 		fr->cpu_opts.the_dct36 = dct36_x86_64;
+		fr->cpu_opts.the_antialias = antialias_x86_64;
+		fr->cpu_opts.the_stereo_ms = stereo_ms_x86_64;
+		fr->cpu_opts.the_stereo_is = stereo_is_x86_64;
+		fr->cpu_opts.the_dct12 = dct12_x86_64;
+#		endif
+#		ifndef NO_LAYER12
+		fr->cpu_opts.the_dequant_layer12 = dequant_layer12_x86_64;
+#		endif
+#		ifdef RESAMPLE_SINC
+		fr->cpu_opts.the_resample_dot = resample_dot_x86_64;
 #		endif
 #endif
 #		ifndef NO_16BIT
@@ -782,6 +992,7 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 		fr->synths.plain[r_1to1][f_32] = synth_1to1_s32_x86_64;
 		fr->synths.stereo[r_1to1][f_32] = synth_1to1_s32_stereo_x86_64;
 #		endif
+		set_down_synths(fr, down_x86_64);
 		done = 1;
 	}
 #endif
@@ -829,6 +1040,7 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 		fr->synths.plain[r_1to1][f_32] = synth_1to1_s32_neon;
 		fr->synths.stereo[r_1to1][f_32] = synth_1to1_s32_stereo_neon;
 #		endif
+		set_down_synths(fr, down_neon);
 		done = 1;
 	}
 #	endif
@@ -853,6 +1065,16 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 #ifdef OPT_MULTI
 #		ifndef NO_LAYER3
 		fr->cpu_opts.the_dct36 = dct36_neon64;
+		fr->cpu_opts.the_antialias = antialias_neon64;
+		fr->cpu_opts.the_stereo_ms = stereo_ms_neon64;
+		fr->cpu_opts.the_stereo_is = stereo_is_neon64;
+		fr->cpu_opts.the_dct12 = dct12_neon64;
+#		endif
+#		ifndef NO_LAYER12
+		fr->cpu_opts.the_dequant_layer12 = dequant_layer12_neon64;
+#		endif
+#		ifdef RESAMPLE_SINC
+		fr->cpu_opts.the_resample_dot = resample_dot_neon64;
 #		endif
 #endif
 #		ifndef NO_16BIT
@@ -867,6 +1089,7 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 		fr->synths.plain[r_1to1][f_32] = synth_1to1_s32_neon64;
 		fr->synths.stereo[r_1to1][f_32] = synth_1to1_s32st_neon64;
 #		endif
+		set_down_synths(fr, down_neon64);
 		done = 1;
 	}
 #	endif
@@ -916,7 +1139,7 @@ int frame_cpu_opt(mpg123_handle *fr, const char* cpu)
 #ifdef OPT_DITHER
 	if(done && dithered)
 	{
-		/* run-time dither noise table generation */
+		/* point to the shared dither noise table */
 		if(!frame_dither_init(fr))
 		{
 			if(NOQUIET) error("Dither noise setup failed!");
@@ -991,6 +1214,9 @@ static const char *mpg123_supported_decoder_list[] =
 	#ifdef OPT_ALTIVEC
 	NULL,
 	#endif
+	#ifdef OPT_AVX512
+	NULL,
+	#endif
 	#ifdef OPT_AVX
 	NULL,
 	#endif
@@ -1057,6 +1283,9 @@ static const char *mpg123_decoder_list[] =
 	#ifdef OPT_ALTIVEC
 	dn_altivec,
 	#endif
+	#ifdef OPT_AVX512
+	dn_avx512,
+	#endif
 	#ifdef OPT_AVX
 	dn_avx,
 	#endif
@@ -1136,6 +1365,9 @@ void check_decoders(void )
 #ifdef OPT_I386
 	*(d++) = dn_idrei;
 #endif
+#ifdef OPT_AVX512
+	if(cpu_avx512(cpu_flags)) *(d++) = dn_avx512;
+#endif
 #ifdef OPT_AVX
 	if(cpu_avx(cpu_flags)) *(d++) = dn_avx;
 #endif
@@ -24,6 +24,7 @@
 	OPT_ALTIVEC (Motorola/IBM PPC with AltiVec under MacOSX)
 	OPT_X86_64 (x86-64 / AMD64 / Intel 64)
 	OPT_AVX
+	OPT_AVX512 (only together with OPT_AVX in multi mode)
 
 	or you define OPT_MULTI and give a combination which makes sense (do not include i486, do not mix altivec and x86).
 
@@ -61,6 +62,7 @@ perl <<'EOT'
 ,['arm','ARM']
 ,['neon','NEON']
 ,['avx','AVX']
+,['avx512','AVX512']
 ,['dreidnow_vintage', '3DNow_vintage']
 ,['dreidnowext_vintage', '3DNowExt_vintage']
 ,['sse_vintage', 'SSE_vintage']
@@ -110,6 +112,7 @@ enum optdec
 	,neon
 	,neon64
 	,avx
+	,avx512
 	,dreidnow_vintage
 	,dreidnowext_vintage
 	,sse_vintage
@@ -133,6 +136,7 @@ static const char dn_arm[] = "ARM";
 static const char dn_neon[] = "NEON";
 static const char dn_neon64[] = "NEON64";
 static const char dn_avx[] = "AVX";
+static const char dn_avx512[] = "AVX512";
 static const char dn_dreidnow_vintage[] = "3DNow_vintage";
 static const char dn_dreidnowext_vintage[] = "3DNowExt_vintage";
 static const char dn_sse_vintage[] = "SSE_vintage";
@@ -156,6 +160,7 @@ static const char* decname[] =
 	,dn_neon
 	,dn_neon64
 	,dn_avx
+	,dn_avx512
 	,dn_dreidnow_vintage
 	,dn_dreidnowext_vintage
 	,dn_sse_vintage
@@ -194,6 +199,7 @@ enum optcla decclass(const enum optdec);
  || (defined OPT_3DNOW_VINTAGE) || (defined OPT_3DNOWEXT_VINTAGE) \
  || (defined OPT_SSE_VINTAGE) \
  || (defined OPT_NEON) || (defined OPT_NEON64) || (defined OPT_AVX) \
+ || (defined OPT_AVX512) \
  || (defined OPT_GENERIC_DITHER)
 #error "Bad decoder choice together with fixed point math!"
 #endif
@@ -331,6 +337,13 @@ extern const int costab_mmxsse[];
 #ifndef OPT_MULTI
 #	define defopt x86_64
 #	define opt_dct36(fr) dct36_x86_64
+#	define opt_antialias(fr) antialias_x86_64
+#	define opt_stereo_ms(fr) stereo_ms_x86_64
+#	define opt_stereo_is(fr) stereo_is_x86_64
+#	define opt_dct12(fr) dct12_x86_64
+#	define have_dct12(fr) 1
+#	define opt_dequant_layer12(fr) dequant_layer12_x86_64
+#	define opt_resample_dot(fr) resample_dot_x86_64
 #endif
 #endif
 
@@ -339,6 +352,23 @@ extern const int costab_mmxsse[];
 #ifndef OPT_MULTI
 #	define defopt avx
 #	define opt_dct36(fr) dct36_avx
+#	define opt_antialias(fr) antialias_avx
+#	define opt_stereo_ms(fr) stereo_ms_avx
+#	define opt_stereo_is(fr) stereo_is_avx
+#	define opt_dct12(fr) dct12_x86_64
+#	define have_dct12(fr) 1
+#	define opt_dequant_layer12(fr) dequant_layer12_x86_64
+#	define opt_resample_dot(fr) resample_dot_avx
+#endif
+#endif
+
+/* Shares dct36, dct64 and the other layer 3 helpers with AVX, only the synth is different. */
+#ifdef OPT_AVX512
+#ifndef OPT_AVX
+#error "AVX-512 decoder needs the AVX one, too."
+#endif
+#ifndef OPT_MULTI
+#error "AVX-512 decoder only works with runtime CPU detection."
 #endif
 #endif
 
@@ -361,6 +391,13 @@ extern const int costab_mmxsse[];
 #ifndef OPT_MULTI
 #	define defopt neon64
 #	define opt_dct36(fr) dct36_neon64
+#	define opt_antialias(fr) antialias_neon64
+#	define opt_stereo_ms(fr) stereo_ms_neon64
+#	define opt_stereo_is(fr) stereo_is_neon64
+#	define opt_dct12(fr) dct12_neon64
+#	define have_dct12(fr) 1
+#	define opt_dequant_layer12(fr) dequant_layer12_neon64
+#	define opt_resample_dot(fr) resample_dot_neon64
 #endif
 #endif
 
@@ -381,11 +418,38 @@ void check_decoders(void);
 #		define opt_dct36(fr) ((fr)->cpu_opts.the_dct36)
 #	endif
 
+#	if (defined OPT_X86_64 || defined OPT_AVX || defined OPT_NEON64)
+#		define opt_antialias(fr) ((fr)->cpu_opts.the_antialias)
+#		define opt_stereo_ms(fr) ((fr)->cpu_opts.the_stereo_ms)
+#		define opt_stereo_is(fr) ((fr)->cpu_opts.the_stereo_is)
+#		define opt_dct12(fr) ((fr)->cpu_opts.the_dct12)
+#		define have_dct12(fr) (opt_dct12(fr) != NULL)
+#		define opt_dequant_layer12(fr) ((fr)->cpu_opts.the_dequant_layer12)
+#		define opt_resample_dot(fr) ((fr)->cpu_opts.the_resample_dot)
+#	endif
+
 #endif /* OPT_MULTI else */
 
 #	ifndef opt_dct36
 #		define opt_dct36(fr) dct36
 #	endif
 
+#	ifndef opt_antialias
+#		define opt_antialias(fr) antialias
+#		define opt_stereo_ms(fr) stereo_ms
+#		define opt_stereo_is(fr) stereo_is
+#	endif
+
+#	ifndef opt_dequant_layer12
+#		define opt_dequant_layer12(fr) dequant_layer12
+#	endif
+
+#	ifndef opt_resample_dot
+#		define opt_resample_dot(fr) resample_dot
+#	endif
+
+/* opt_dct12() does 4 sub-bands at once and has no C counterpart; without it
+   (or with have_dct12() false) layer3.c only uses the C dct12. */
+
 #endif /* MPG123_H_OPTIMIZE */
 
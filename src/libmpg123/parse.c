@@ -459,6 +459,7 @@ static int halfspeed_do(mpg123_handle *fr)
 			fr->to_decode = fr->to_ignore = TRUE;
 			--fr->halfphase;
 			fr->bitindex = 0;
+			fr->bsbuf = fr->bsstage;
 			fr->wordpointer = (unsigned char *) fr->bsbuf;
 			if(fr->lay == 3) memcpy (fr->bsbuf, fr->ssave, fr->ssize);
 			if(fr->error_protection) fr->crc = getbits(fr, 16); /* skip crc */
@@ -507,7 +508,7 @@ int read_frame(mpg123_handle *fr)
 
 	fr->fsizeold=fr->framesize;       /* for Layer3 */
 
-	if(halfspeed_do(fr) == 1) return 1;
+	if(!(fr->state_flags & FRAME_SCANNING) && halfspeed_do(fr) == 1) return 1;
 
 read_again:
 	/* In case we are looping to find a valid frame, discard any buffered data before the current position.
@@ -551,20 +552,76 @@ init_resync:
 
 	/* if filepos is invalid, so is framepos */
 	framepos = fr->rd->tell(fr) - 4;
-	/* flip/init buffer for Layer 3 */
+	if(fr->state_flags & FRAME_SCANNING)
 	{
-		unsigned char *newbuf = fr->bsspace[fr->bsnum]+512;
-		/* read main data into memory */
-		if((ret=fr->rd->read_frame_body(fr,newbuf,fr->framesize))<0)
+		/* Only the header counts for the scan, hop over the body.
+		   Reading its last byte makes sure that a truncated frame at the end is not counted,
+		   as seeking past the end of a file does not fail. */
+		unsigned char last;
+		if( fr->framesize > 0 && (
+		       fr->rd->skip_bytes(fr, fr->framesize-1) < 0
+		    || fr->rd->fullread(fr, &last, 1) != 1 ) )
 		{
-			/* if failed: flip back */
-			debug("need more?");
+			debug("scan: truncated frame");
+			ret = READER_MORE;
 			goto read_frame_bad;
 		}
+	}
+	else
+	{
+		unsigned char *body = NULL;
+		unsigned char *newbuf;
+		/* Layer I and II work on the body where the reader has it.
+		   Layer III needs its bit reservoir in front of the main data: only the
+		   side info and the start of the main data are staged in bsspace for
+		   set_pointer() to put the reservoir before, the bit reader continues in
+		   the body (see getbits.h). The next frame takes its reservoir from that
+		   body, so it has to stay, which it does with readers that never forget()
+		   their memory. The first frame is copied whole for check_lame_tag(). */
+		if(  fr->rd->frame_body != NULL
+		  && (fr->lay != 3 || (fr->rd->forget == NULL && fr->firsthead)) )
+		body = fr->rd->frame_body(fr, fr->framesize);
+		if(body == NULL || fr->lay == 3)
+		{
+			/* flip/init buffer for Layer 3 */
+			newbuf = fr->bsspace[fr->bsnum]+512;
+			if(body != NULL)
+			memcpy(newbuf, body, fr->ssize+BITS_STAGED);
+			/* read main data into memory */
+			else if((ret=fr->rd->read_frame_body(fr,newbuf,fr->framesize))<0)
+			{
+				/* if failed: flip back */
+				debug("need more?");
+				goto read_frame_bad;
+			}
+			fr->bsnum = (fr->bsnum + 1) & 1;
+		}
+		else newbuf = body;
+		/* Where the main data of the frame before is, for the reservoir. */
+		fr->bsbodyold = fr->bsbody;
+		fr->bsmainold = fr->bsmain;
+		if(fr->bsbody != NULL)
+		fr->bsbufold = fr->bsstage;
+		/* A Layer I or II body left in the reader's memory has no room in front
+		   for a bit reservoir, could be at the very start of a mapping and might
+		   be released already with fed data. Use the other buffer instead. */
+		else if(fr->state_flags & FRAME_INPLACE)
+		fr->bsbufold = fr->bsspace[fr->bsnum]+512;
+		else
 		fr->bsbufold = fr->bsbuf;
+		fr->bsbody  = fr->lay == 3 ? body : NULL;
+		fr->bsstage = newbuf;
+		fr->bsmain  = fr->ssize;
+		if(newbuf == body)
+		fr->state_flags |= FRAME_INPLACE;
+		else
+		fr->state_flags &= ~FRAME_INPLACE;
 		fr->bsbuf = newbuf;
+		/* Layer III main data does not reach back over a Layer I or II frame,
+		   so it does not matter where such a frame body is. */
+		if(fr->lay != 3)
+		fr->bitreservoir = 0;
 	}
-	fr->bsnum = (fr->bsnum + 1) & 1;
 
 	if(!fr->firsthead)
 	{
@@ -617,15 +674,20 @@ init_resync:
 		(off_p)fr->track_frames);
 	}
 
-	halfspeed_prepare(fr);
+	if(!(fr->state_flags & FRAME_SCANNING)) halfspeed_prepare(fr);
 
 	/* index the position */
 	fr->input_offset = framepos;
 #ifdef FRAME_INDEX
 	/* Keep track of true frame positions in our frame index.
 	   but only do so when we are sure that the frame number is accurate... */
-	if((fr->state_flags & FRAME_ACCURATE) && FI_NEXT(fr->index, fr->num))
-	fi_add(&fr->index, framepos);
+	if(fr->state_flags & FRAME_ACCURATE)
+	{
+		if(FI_NEXT(fr->index, fr->num))
+		fi_add(&fr->index, framepos);
+		if((fr->p.flags & MPG123_FULL_INDEX) && FI_NEXT_FULL(fr->index, fr->num))
+		fi_add_full(&fr->index, framepos);
+	}
 #endif
 
 	if(fr->silent_resync > 0) --fr->silent_resync;
@@ -633,7 +695,8 @@ init_resync:
 	if(fr->rd->forget != NULL) fr->rd->forget(fr);
 
 	fr->to_decode = fr->to_ignore = TRUE;
-	if(fr->error_protection) fr->crc = getbits(fr, 16); /* skip crc */
+	if(fr->error_protection && !(fr->state_flags & FRAME_SCANNING))
+	fr->crc = getbits(fr, 16); /* skip crc */
 
 	/*
 		Let's check for header change after deciding that the new one is good
@@ -878,8 +941,20 @@ static int decode_header(mpg123_handle *fr,unsigned long newhead, int *freeforma
 
 void set_pointer(mpg123_handle *fr, long backstep)
 {
+	/* Start over in the staged part of a body in the reader's memory. */
+	fr->bsbuf = fr->bsstage;
 	fr->wordpointer = fr->bsbuf + fr->ssize - backstep;
-	if (backstep)
+	if(backstep && fr->bsbodyold != NULL)
+	{
+		/* The old main data continues in its body from its start on. */
+		long from  = fr->fsizeold - backstep;
+		long split = fr->bsmainold;
+		if(split < from)         split = from;
+		if(split > fr->fsizeold) split = fr->fsizeold;
+		memcpy(fr->wordpointer, fr->bsbufold+from, split-from);
+		memcpy(fr->wordpointer+split-from, fr->bsbodyold+split, fr->fsizeold-split);
+	}
+	else if (backstep)
 	memcpy(fr->wordpointer,fr->bsbufold+fr->fsizeold-backstep,backstep);
 
 	fr->bitindex = 0; 
@@ -0,0 +1,351 @@
+/*
+	peaks.c: waveform envelope behind the synth functions, see mpg123_peaks()
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	While mpg123_peaks() decodes a frame, fr->synth_stereo and fr->synth_mono
+	are replaced by the functions here, which get the 32 subband samples of
+	each slot after the Layer III hybrid filter or the Layer I/II
+	dequantization.
+
+	With MPG123_PEAKS_SYNTH, the normal synth writes the slot into a scratch
+	block and the samples of that go into the envelope, exactly as they would
+	be in the output (before the conversion to unsigned or 24 bit).
+
+	Otherwise, there is no synthesis at all. The polyphase filter bank is
+	close to orthogonal, so the sum of squares of the subband samples gives
+	the energy of the 32 output samples of the slot, up to a constant factor.
+	That is delayed by the latency of the synthesis window and spread evenly
+	over the samples the slot yields at the output rate. The extremes are
+	estimated as the peaks of a sine wave with that mean square.
+
+	Windows are counted in samples at the output rate, after gapless
+	trimming. Entries that complete while the caller's arrays are full wait
+	in fr->pk.pend for the next call.
+*/
+
+#include "mpg123lib_intern.h"
+#include "debug.h"
+
+void peaks_reset(mpg123_handle *fr)
+{
+	fr->pk.pos = 0;
+	fr->pk.pend_fill = fr->pk.pend_pos = 0;
+	memset(fr->pk.delay, 0, sizeof(fr->pk.delay));
+	fr->pk.dpos = 0;
+}
+
+void peaks_exit(mpg123_handle *fr)
+{
+	if(fr->pk.pend != NULL) free(fr->pk.pend);
+	fr->pk.pend = NULL;
+	fr->pk.pend_size = 0;
+	peaks_reset(fr);
+}
+
+int peaks_reserve(mpg123_handle *fr, size_t n)
+{
+	size_t need = n/fr->pk.window + 2;
+	size_t room = fr->pk.count - fr->pk.fill;
+	size_t size;
+	float *pend;
+
+	if(need <= room) return MPG123_OK;
+	need = fr->pk.pend_fill + need - room;
+	if(need <= fr->pk.pend_size) return MPG123_OK;
+	for(size = fr->pk.pend_size ? 2*fr->pk.pend_size : 64; size < need; size *= 2);
+	pend = safe_realloc(fr->pk.pend, 3*sizeof(float)*size);
+	if(pend == NULL)
+	{
+		fr->err = MPG123_OUT_OF_MEM;
+		return MPG123_ERR;
+	}
+	fr->pk.pend = pend;
+	fr->pk.pend_size = size;
+	return MPG123_OK;
+}
+
+/* Store a finished entry in the caller's arrays or in the pending list,
+   which peaks_reserve() made big enough. */
+static void pk_emit(mpg123_handle *fr)
+{
+	float e[3];
+
+	e[0] = (float)fr->pk.min;
+	e[1] = (float)fr->pk.max;
+	e[2] = (float)sqrt(fr->pk.sum/fr->pk.pos);
+	fr->pk.pos = 0;
+	if(fr->pk.fill < fr->pk.count)
+	{
+		if(fr->pk.out[0]) fr->pk.out[0][fr->pk.fill] = e[0];
+		if(fr->pk.out[1]) fr->pk.out[1][fr->pk.fill] = e[1];
+		if(fr->pk.out[2]) fr->pk.out[2][fr->pk.fill] = e[2];
+		++fr->pk.fill;
+		return;
+	}
+	memcpy(fr->pk.pend+3*fr->pk.pend_fill++, e, sizeof(e));
+}
+
+/* The part [*from, *to) of the next n samples of this frame that lies in the gapless range. */
+static void pk_range(mpg123_handle *fr, size_t n, size_t *from, size_t *to)
+{
+	off_t begin = fr->pk.got;
+
+	fr->pk.got += n;
+	*from = begin < fr->pk.skip ? (size_t)(fr->pk.skip-begin < (off_t)n ? fr->pk.skip-begin : (off_t)n) : 0;
+	*to = n;
+	if(fr->pk.end >= 0 && fr->pk.got > fr->pk.end)
+		*to = fr->pk.end > begin ? (size_t)(fr->pk.end-begin) : 0;
+	if(*to < *from) *to = *from;
+}
+
+/* n samples with mean square ms each, extremes estimated from that. */
+static void pk_even(mpg123_handle *fr, size_t n, double ms)
+{
+	size_t from, to;
+	double peak = sqrt(2.*ms);
+
+	pk_range(fr, n, &from, &to);
+	n = to-from;
+	while(n)
+	{
+		size_t take = fr->pk.window - fr->pk.pos;
+		if(take > n) take = n;
+		if(!fr->pk.pos)
+		{
+			fr->pk.min = -peak;
+			fr->pk.max = peak;
+			fr->pk.sum = 0.;
+		}
+		else if(peak > fr->pk.max)
+		{
+			fr->pk.min = -peak;
+			fr->pk.max = peak;
+		}
+		fr->pk.sum += take*ms;
+		fr->pk.pos += take;
+		n -= take;
+		if(fr->pk.pos == fr->pk.window) pk_emit(fr);
+	}
+}
+
+/* The samples in fr->pk.block, written by the normal synth. */
+static void pk_block(mpg123_handle *fr, int channels)
+{
+	size_t n, from, to, i;
+	double scale = 1.;
+
+	switch(fr->pk.format)
+	{
+#ifndef NO_16BIT
+		case f_16:
+			n = fr->buffer.fill/sizeof(short);
+			scale = 1./32768;
+		break;
+#endif
+#ifndef NO_32BIT
+		case f_32:
+			n = fr->buffer.fill/sizeof(int32_t);
+			scale = 1./2147483648.;
+		break;
+#endif
+		default:
+			n = fr->buffer.fill/sizeof(real);
+	}
+	n /= channels;
+	pk_range(fr, n, &from, &to);
+	for(i=from; i<to; ++i)
+	{
+		double v[2] = { 0., 0. }, sq = 0.;
+		int c;
+		for(c=0; c<channels; ++c)
+		{
+			size_t j = i*channels+c;
+			switch(fr->pk.format)
+			{
+#ifndef NO_16BIT
+				case f_16: v[c] = ((short*)fr->pk.block)[j]; break;
+#endif
+#ifndef NO_32BIT
+				case f_32: v[c] = ((int32_t*)fr->pk.block)[j]; break;
+#endif
+				default:   v[c] = REAL_TO_DOUBLE(fr->pk.block[j]);
+			}
+			v[c] *= scale;
+			sq += v[c]*v[c];
+		}
+		if(!fr->pk.pos)
+		{
+			fr->pk.min = fr->pk.max = v[0];
+			fr->pk.sum = 0.;
+		}
+		for(c=0; c<channels; ++c)
+		{
+			if(v[c] < fr->pk.min) fr->pk.min = v[c];
+			if(v[c] > fr->pk.max) fr->pk.max = v[c];
+		}
+		fr->pk.sum += sq/channels;
+		if(++fr->pk.pos == fr->pk.window) pk_emit(fr);
+	}
+}
+
+/* Sum of squares of one slot of subband samples. */
+static double pk_energy(real *bandPtr)
+{
+	double e = 0.;
+	int i;
+
+	for(i=0; i<SBLIMIT; ++i)
+	{
+		double v = REAL_TO_DOUBLE(bandPtr[i]);
+		e += v*v;
+	}
+	return e;
+}
+
+/* One slot of subband energy, coming out after the synth latency. */
+static void pk_slot(mpg123_handle *fr, double energy)
+{
+	size_t n = SBLIMIT>>fr->down_sample;
+	double ms = fr->pk.delay[fr->pk.dpos];
+
+	fr->pk.delay[fr->pk.dpos] = energy*fr->pk.scale;
+	fr->pk.dpos = (fr->pk.dpos+1) % PEAKS_DELAY;
+#ifndef NO_NTOM
+	if(fr->down_sample == 3)
+	{
+		unsigned long ntom = fr->ntom_val[0] + SBLIMIT*fr->ntom_step;
+		n = ntom/NTOM_MUL;
+		fr->ntom_val[0] = fr->ntom_val[1] = ntom % NTOM_MUL;
+	}
+#endif
+	pk_even(fr, n, ms);
+}
+
+/* Replacements for fr->synth_stereo and fr->synth_mono. */
+int peaks_stereo(real *bandPtr_l, real *bandPtr_r, mpg123_handle *fr)
+{
+	int clip;
+	unsigned char *samples = fr->buffer.data;
+	size_t pnt = fr->buffer.fill;
+
+	if(!(fr->pk.flags & MPG123_PEAKS_SYNTH))
+	{
+		pk_slot(fr, 0.5*(pk_energy(bandPtr_l)+pk_energy(bandPtr_r)));
+		return 0;
+	}
+	fr->buffer.data = (unsigned char*) fr->pk.block;
+	fr->buffer.fill = 0;
+	clip = (fr->pk.synth_stereo)(bandPtr_l, bandPtr_r, fr);
+	pk_block(fr, 2);
+	fr->buffer.data = samples;
+	fr->buffer.fill = pnt;
+
+	return clip;
+}
+
+int peaks_mono(real *bandPtr, mpg123_handle *fr)
+{
+	int clip;
+	unsigned char *samples = fr->buffer.data;
+	size_t pnt = fr->buffer.fill;
+
+	if(!(fr->pk.flags & MPG123_PEAKS_SYNTH))
+	{
+		pk_slot(fr, pk_energy(bandPtr));
+		return 0;
+	}
+	fr->buffer.data = (unsigned char*) fr->pk.block;
+	fr->buffer.fill = 0;
+	clip = (fr->pk.synth_mono)(bandPtr, fr);
+	pk_block(fr, fr->af.channels);
+	fr->buffer.data = samples;
+	fr->buffer.fill = pnt;
+
+	return clip;
+}
+
+int peaks_setup(mpg123_handle *fr)
+{
+	if(fr->pk.flags & MPG123_PEAKS_SYNTH)
+	{
+		/* Same choice as in set_synth_functions(). */
+		if(FALSE){}
+#ifndef NO_16BIT
+		else if(fr->af.dec_enc & MPG123_ENC_16)
+			fr->pk.format = f_16;
+#endif
+#ifndef NO_REAL
+		else if(fr->af.dec_enc & MPG123_ENC_FLOAT)
+			fr->pk.format = f_real;
+#endif
+#ifndef NO_32BIT
+		else if(fr->af.dec_enc & MPG123_ENC_32 || fr->af.dec_enc & MPG123_ENC_24)
+			fr->pk.format = f_32;
+#endif
+		else
+		{
+			/* 8 bit samples went through a table, possibly a non-linear one. */
+			fr->err = MPG123_BAD_OUTFORMAT;
+			return MPG123_ERR;
+		}
+	}
+	else
+	{
+		/* Subband samples for the mmx-like synths are scaled up. */
+		double scale = fr->lastscale < 0 ? fr->p.outscale : fr->lastscale;
+#ifdef OPT_MMXORSSE
+		if(fr->make_decode_tables == make_decode_tables_mmx)
+			scale /= 16384.;
+#endif
+		fr->pk.scale = scale*scale;
+	}
+	return MPG123_OK;
+}
+
+void peaks_frame(mpg123_handle *fr, off_t skip, off_t end)
+{
+	func_synth_stereo synth_stereo = fr->synth_stereo;
+	func_synth_mono synth_mono = fr->synth_mono;
+	off_t expect = frame_expect_outsamples(fr);
+
+	fr->pk.skip = skip;
+	fr->pk.end = end;
+	fr->pk.got = 0;
+	fr->pk.synth_stereo = synth_stereo;
+	fr->pk.synth_mono = synth_mono;
+	fr->synth_stereo = peaks_stereo;
+	fr->synth_mono = peaks_mono;
+	fr->clip += (fr->do_layer)(fr);
+	fr->synth_stereo = synth_stereo;
+	fr->synth_mono = synth_mono;
+	/* A broken frame still takes its time. */
+	if(fr->pk.got < expect)
+	{
+		pk_even(fr, (size_t)(expect-fr->pk.got), 0.);
+#ifndef NO_NTOM
+		ntom_set_ntom(fr, fr->num+1);
+#endif
+	}
+}
+
+void peaks_flush(mpg123_handle *fr)
+{
+	if(fr->pk.pos) pk_emit(fr);
+}
+
+size_t peaks_pending(mpg123_handle *fr)
+{
+	while(fr->pk.pend_pos < fr->pk.pend_fill && fr->pk.fill < fr->pk.count)
+	{
+		float *e = fr->pk.pend+3*fr->pk.pend_pos++;
+		if(fr->pk.out[0]) fr->pk.out[0][fr->pk.fill] = e[0];
+		if(fr->pk.out[1]) fr->pk.out[1][fr->pk.fill] = e[1];
+		if(fr->pk.out[2]) fr->pk.out[2][fr->pk.fill] = e[2];
+		++fr->pk.fill;
+	}
+	if(fr->pk.pend_pos == fr->pk.pend_fill)
+		fr->pk.pend_pos = fr->pk.pend_fill = 0;
+	return fr->pk.pend_fill - fr->pk.pend_pos;
+}
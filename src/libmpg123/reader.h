@@ -12,6 +12,11 @@
 #include "config.h"
 #include "mpg123.h"
 
+/* Background reading needs threads and atomic operations. */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_CREATE) && defined(__GNUC__)
+#define READ_THREAD
+#endif
+
 #ifndef NO_FEEDER
 struct buffy
 {
@@ -19,6 +24,9 @@ struct buffy
 	ssize_t size;
 	ssize_t realsize;
 	struct buffy *next;
+	/* For data that is only referenced, not owned: hand it back with that. */
+	void (*release)(void *);
+	void *handle;
 };
 
 
@@ -74,6 +82,17 @@ struct reader_data
 	off_t   (*lseek)(int fd, off_t offset, int whence);
 	/* Buffered readers want that abstracted, set internally. */
 	ssize_t (*fullread)(mpg123_handle *, unsigned char *, ssize_t);
+	/* The whole file for the mmap reader, NULL otherwise. */
+	unsigned char *mapdata;
+	size_t mapsize;
+	/* Ring and read-ahead blocks for the io_uring reader, NULL otherwise. */
+	struct uring *uring;
+	/* Reader thread filling a ring buffer behind fdread and io_seek, NULL otherwise. */
+	struct readthread *thread;
+	/* Read window of the scan reader, only there during mpg123_scan(). */
+	unsigned char *scanbuf;
+	off_t   scanpos;  /* file offset of the window */
+	ssize_t scanfill; /* valid bytes in the window */
 #ifndef NO_FEEDER
 	struct bufferchain buffer; /* Not dynamically allocated, these few struct bytes aren't worth the trouble. */
 #endif
@@ -94,6 +113,13 @@ struct reader
 	off_t   (*tell)           (mpg123_handle *);
 	void    (*rewind)         (mpg123_handle *);
 	void    (*forget)         (mpg123_handle *);
+	/* Optional: frame body of given size right where the reader has it, NULL to let read_frame_body() copy it.
+	   It has to stay valid until the next forget(). Layer I and II bodies are marked with FRAME_INPLACE,
+	   so that a following Layer III frame never takes its bit reservoir from one: there is no room in
+	   front of it, maybe not even memory (start of a mapping), and fed buffers may be released already.
+	   Layer III bodies are only taken from readers without forget(), as the next frame reads its
+	   reservoir from the body before (see read_frame()). */
+	unsigned char* (*frame_body)(mpg123_handle *, int size);
 };
 
 /* Open a file by path or use an opened file descriptor. */
@@ -105,11 +131,28 @@ int open_stream_handle(mpg123_handle *, void *iohandle);
 int open_feed(mpg123_handle *);
 /* externally called function, returns 0 on success, -1 on error */
 int  feed_more(mpg123_handle *fr, const unsigned char *in, long count);
+/* Same, but only reference the data until it is given back via release(handle). */
+int  feed_more_ref(mpg123_handle *fr, const unsigned char *in, long count, void (*release)(void *), void *handle);
 void feed_forget(mpg123_handle *fr);  /* forget the data that has been read (free some buffers) */
 off_t feed_set_pos(mpg123_handle *fr, off_t pos); /* Set position (inside available data if possible), return wanted byte offset of next feed. */
 
 void open_bad(mpg123_handle *);
 
+/* Switch a plain seekable stream to header scanning: small reads are served from a read window,
+   skipping the frame bodies does not touch the file. close_scan() returns to normal reading. */
+void open_scan(mpg123_handle *);
+int  close_scan(mpg123_handle *);
+
+/* With MPG123_MMAP, switch a plain stream on a regular file to the mmap reader, if possible. */
+void open_map(mpg123_handle *);
+/* With MPG123_READAHEAD, switch a plain seekable stream to the io_uring reader, if possible. */
+void open_uring(mpg123_handle *);
+/* With MPG123_READ_THREAD, let a separate thread do the reading of a stream, if possible. */
+void open_thread(mpg123_handle *);
+
+/* Modification time of the opened file, 0 if unknown (custom I/O, no file). */
+int64_t stream_mtime(mpg123_handle *);
+
 #define READER_FD_OPENED 0x1
 #define READER_ID3TAG    0x2
 #define READER_SEEKABLE  0x4
@@ -22,6 +22,22 @@
 #ifdef _MSC_VER
 #include <io.h>
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+/* The io_uring reader talks to the kernel directly, no liburing needed. */
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_SYSCALL_H) && defined(HAVE_MMAP) && defined(__GNUC__)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+/* IORING_OP_READ is an enum, but came with the same kernel as this feature bit. */
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_RW_CUR_POS)
+#define URING_READER
+#endif
+#endif
+
+#ifdef READ_THREAD
+#include <pthread.h>
+#endif
 
 #include "compat.h"
 #include "debug.h"
@@ -38,6 +54,11 @@ static ssize_t plain_fullread(mpg123_handle *fr,unsigned char *buf, ssize_t coun
 static off_t io_seek(struct reader_data *rdat, off_t offset, int whence);
 static ssize_t io_read(struct reader_data *rdat, void *buf, size_t count);
 
+#ifdef READ_THREAD
+static off_t thread_seek(struct reader_data *rdat, off_t offset, int whence);
+static void thread_exit(struct reader_data *rdat);
+#endif
+
 #ifndef NO_FEEDER
 /* Bufferchain methods. */
 static void bc_init(struct bufferchain *bc);
@@ -238,6 +259,10 @@ static off_t stream_lseek(mpg123_handle *fr, off_t pos, int whence)
 
 static void stream_close(mpg123_handle *fr)
 {
+#ifdef READ_THREAD
+	/* Done with the descriptor before it is closed. */
+	thread_exit(&fr->rdat);
+#endif
 	if(fr->rdat.flags & READER_FD_OPENED) compat_close(fr->rdat.filept);
 
 	fr->rdat.filept = 0;
@@ -470,6 +495,23 @@ static struct buffy* buffy_new(size_t size, size_t minsize)
 	}
 	newbuf->size = 0;
 	newbuf->next = NULL;
+	newbuf->release = NULL;
+	newbuf->handle = NULL;
+	return newbuf;
+}
+
+/* A buffy around foreign data, full from the start. */
+static struct buffy* buffy_ref(const unsigned char *data, ssize_t size, void (*release)(void *), void *handle)
+{
+	struct buffy *newbuf;
+	newbuf = malloc(sizeof(struct buffy));
+	if(newbuf == NULL) return NULL;
+
+	newbuf->data = (unsigned char*)data;
+	newbuf->size = newbuf->realsize = size;
+	newbuf->next = NULL;
+	newbuf->release = release;
+	newbuf->handle = handle;
 	return newbuf;
 }
 
@@ -477,7 +519,8 @@ static void buffy_del(struct buffy* buf)
 {
 	if(buf)
 	{
-		free(buf->data);
+		if(buf->release != NULL) buf->release(buf->handle);
+		else free(buf->data);
 		free(buf);
 	}
 }
@@ -542,7 +585,8 @@ static void bc_free(struct bufferchain *bc, struct buffy* buf)
 {
 	if(!buf) return;
 
-	if(bc->pool_fill < bc->pool_size)
+	/* Borrowed memory goes back to the owner, never into the pool. */
+	if(buf->release == NULL && bc->pool_fill < bc->pool_size)
 	{
 		buf->next = bc->pool;
 		bc->pool = buf;
@@ -653,6 +697,24 @@ static int bc_add(struct bufferchain *bc, const unsigned char *data, ssize_t siz
 	return ret;
 }
 
+/* Append foreign data without copying. */
+static int bc_add_ref(struct bufferchain *bc, const unsigned char *data, ssize_t size, void (*release)(void *), void *handle)
+{
+	struct buffy *newbuf;
+	debug2("bc_add_ref: linking %"SSIZE_P" bytes at %"OFF_P, (ssize_p)size, (off_p)(bc->fileoff+bc->size));
+	if(size < 1) return -1;
+
+	newbuf = buffy_ref(data, size, release, handle);
+	if(newbuf == NULL) return -2;
+
+	if(bc->last != NULL)  bc->last->next = newbuf;
+	else if(bc->first == NULL) bc->first = newbuf;
+
+	bc->last  = newbuf;
+	bc->size += size;
+	return 0;
+}
+
 /* Common handler for "You want more than I can give." situation. */
 static ssize_t bc_need_more(struct bufferchain *bc)
 {
@@ -700,6 +762,26 @@ static ssize_t bc_give(struct bufferchain *bc, unsigned char *out, ssize_t size)
 	return gotcount;
 }
 
+/* Hand out a pointer to size bytes plus lookahead if they are in a single buffy, advancing position. */
+static unsigned char* bc_peek(struct bufferchain *bc, ssize_t size, ssize_t lookahead)
+{
+	struct buffy *b = bc->first;
+	ssize_t offset = 0;
+	unsigned char *data;
+	if(bc->size - bc->pos < size) return NULL;
+
+	while(b != NULL && (offset + b->size) <= bc->pos)
+	{
+		offset += b->size;
+		b = b->next;
+	}
+	if(b == NULL || bc->pos+size+lookahead > offset+b->size) return NULL;
+
+	data = b->data + (bc->pos-offset);
+	bc->pos += size;
+	return data;
+}
+
 /* Skip some bytes and return the new position.
    The buffers are still there, just the read pointer is moved! */
 static ssize_t bc_skip(struct bufferchain *bc, ssize_t count)
@@ -773,6 +855,18 @@ int feed_more(mpg123_handle *fr, const unsigned char *in, long count)
 	return ret;
 }
 
+int feed_more_ref(mpg123_handle *fr, const unsigned char *in, long count, void (*release)(void *), void *handle)
+{
+	int ret = 0;
+	if(VERBOSE3) debug("feed_more_ref");
+	if((ret = bc_add_ref(&fr->rdat.buffer, in, count, release, handle)) != 0)
+	{
+		ret = READER_ERROR;
+		if(NOQUIET) error1("Failed to link buffer, return: %i", ret);
+	}
+	return ret;
+}
+
 static ssize_t feed_read(mpg123_handle *fr, unsigned char *out, ssize_t count)
 {
 	ssize_t gotcount = bc_give(&fr->rdat.buffer, out, count);
@@ -800,6 +894,13 @@ static int feed_back_bytes(mpg123_handle *fr, off_t bytes)
 
 static int feed_seek_frame(mpg123_handle *fr, off_t num){ return READER_ERROR; }
 
+/* A frame body within one buffer, with room behind it like in bsspace for the bit reader
+   running over the end. The buffer stays until the next forget, after decoding. */
+static unsigned char* feed_frame_body(mpg123_handle *fr, int size)
+{
+	return bc_peek(&fr->rdat.buffer, size, MAXFRAMESIZE+16);
+}
+
 /* Not just for feed reader, also for self-feeding buffered reader. */
 static void buffered_forget(mpg123_handle *fr)
 {
@@ -875,6 +976,11 @@ int feed_more(mpg123_handle *fr, const unsigned char *in, long count)
 	fr->err = MPG123_MISSING_FEATURE;
 	return -1;
 }
+int feed_more_ref(mpg123_handle *fr, const unsigned char *in, long count, void (*release)(void *), void *handle)
+{
+	fr->err = MPG123_MISSING_FEATURE;
+	return -1;
+}
 off_t feed_set_pos(mpg123_handle *fr, off_t pos)
 {
 	fr->err = MPG123_MISSING_FEATURE;
@@ -943,6 +1049,7 @@ static struct reader readers[] =
 #define feed_back_bytes NULL
 #define feed_skip_bytes NULL
 #define buffered_forget NULL
+#define feed_frame_body NULL
 #endif
 	{ /* READER_FEED */
 		feed_init,
@@ -956,7 +1063,8 @@ static struct reader readers[] =
 		feed_seek_frame,
 		generic_tell,
 		stream_rewind,
-		buffered_forget
+		buffered_forget,
+		feed_frame_body
 	},
 	{ /* READER_BUF_STREAM */
 		default_init,
@@ -1115,6 +1223,917 @@ void open_bad(mpg123_handle *mh)
 	mh->rdat.filelen = -1;
 }
 
+/*
+	The reader for mpg123_scan() on plain seekable streams.
+	Small reads (headers, the last byte of a frame) are served from a window of the file,
+	skipping just moves the position. Only when it leaves the window, the next read seeks there.
+	So, frame headers cost no system calls and frame bodies are not read at all
+	when they are bigger than the window is wide.
+*/
+
+#define SCAN_WINDOW 4096
+
+static ssize_t scan_fullread(mpg123_handle *fr, unsigned char *buf, ssize_t count)
+{
+	struct reader_data *rdat = &fr->rdat;
+	ssize_t cnt = 0;
+
+	while(cnt < count)
+	{
+		ssize_t got;
+		off_t off = rdat->filepos - rdat->scanpos;
+		if(off >= 0 && off < rdat->scanfill)
+		{
+			got = rdat->scanfill - (ssize_t)off;
+			if(got > count-cnt) got = count-cnt;
+			memcpy(buf+cnt, rdat->scanbuf+off, got);
+			rdat->filepos += got;
+			cnt += got;
+			continue;
+		}
+		/* The descriptor is positioned at the end of the window. */
+		if(rdat->scanpos+rdat->scanfill != rdat->filepos
+		   && io_seek(rdat, rdat->filepos, SEEK_SET) != rdat->filepos)
+		{
+			fr->err = MPG123_LSEEK_FAILED;
+			return READER_ERROR;
+		}
+		rdat->scanpos  = rdat->filepos;
+		rdat->scanfill = 0;
+		got = rdat->fdread(fr, rdat->scanbuf, SCAN_WINDOW);
+		if(got < 0) return READER_ERROR;
+		if(got == 0) break;
+		rdat->scanfill = got;
+	}
+	return cnt;
+}
+
+static off_t scan_skip_bytes(mpg123_handle *fr, off_t len)
+{
+	if(fr->rdat.filepos+len < 0)
+	{
+		fr->err = MPG123_LSEEK_FAILED;
+		return READER_ERROR;
+	}
+	fr->rdat.filepos += len;
+	return fr->rdat.filepos;
+}
+
+static int scan_back_bytes(mpg123_handle *fr, off_t bytes)
+{
+	return scan_skip_bytes(fr, -bytes) < 0 ? READER_ERROR : 0;
+}
+
+static struct reader scan_reader =
+{
+	default_init,
+	stream_close,
+	scan_fullread,
+	generic_head_read,
+	generic_head_shift,
+	scan_skip_bytes,
+	generic_read_frame_body,
+	scan_back_bytes,
+	bad_seek_frame,
+	generic_tell,
+	bad_rewind,
+	NULL
+};
+
+void open_scan(mpg123_handle *fr)
+{
+	/* Other readers just keep going with what they have. */
+	if(fr->rd != &readers[READER_STREAM]) return;
+
+	fr->rdat.scanbuf = malloc(SCAN_WINDOW);
+	if(fr->rdat.scanbuf == NULL) return;
+
+	debug("scan reader");
+	fr->rdat.scanpos  = fr->rdat.filepos;
+	fr->rdat.scanfill = 0;
+	fr->rd = &scan_reader;
+}
+
+int close_scan(mpg123_handle *fr)
+{
+	if(fr->rd != &scan_reader) return 0;
+
+	free(fr->rdat.scanbuf);
+	fr->rdat.scanbuf = NULL;
+	fr->rd = &readers[READER_STREAM];
+	/* Bring the descriptor back to the logical position. */
+	return stream_lseek(fr, fr->rdat.filepos, SEEK_SET) < 0 ? READER_ERROR : 0;
+}
+
+/*
+	The mmap reader: a regular file mapped as a whole.
+	Reading is copying from the mapping, skipping and seeking just move the position.
+	Frame bodies for Layer I and II are not copied at all, see read_frame().
+*/
+
+#ifdef HAVE_MMAP
+static ssize_t map_fullread(mpg123_handle *fr, unsigned char *buf, ssize_t count)
+{
+	off_t left = (off_t)fr->rdat.mapsize - fr->rdat.filepos;
+
+	if(left <= 0 || fr->rdat.filepos < 0) return 0;
+	if(count > left) count = (ssize_t)left;
+	memcpy(buf, fr->rdat.mapdata+fr->rdat.filepos, count);
+	fr->rdat.filepos += count;
+	return count;
+}
+
+static unsigned char* map_frame_body(mpg123_handle *fr, int size)
+{
+	unsigned char *body;
+	/* The bit reader looks a bit beyond the frame and damaged frames can claim more bits than
+	   they have. Like the bsspace buffers, make room for a whole frame behind the body,
+	   so near the end of the mapping it is rather copied. */
+	if(fr->rdat.filepos < 0 || fr->rdat.filepos+size+MAXFRAMESIZE+16 > (off_t)fr->rdat.mapsize)
+	return NULL;
+
+	body = fr->rdat.mapdata+fr->rdat.filepos;
+	fr->rdat.filepos += size;
+	return body;
+}
+
+static off_t map_skip_bytes(mpg123_handle *fr, off_t len)
+{
+	if(fr->rdat.filepos+len < 0)
+	{
+		fr->err = MPG123_LSEEK_FAILED;
+		return READER_ERROR;
+	}
+	fr->rdat.filepos += len;
+	return fr->rdat.filepos;
+}
+
+static int map_back_bytes(mpg123_handle *fr, off_t bytes)
+{
+	return map_skip_bytes(fr, -bytes) < 0 ? READER_ERROR : 0;
+}
+
+static void map_rewind(mpg123_handle *fr)
+{
+	fr->rdat.filepos = 0;
+}
+
+static void map_close(mpg123_handle *fr)
+{
+	munmap(fr->rdat.mapdata, fr->rdat.mapsize);
+	fr->rdat.mapdata = NULL;
+	fr->rdat.mapsize = 0;
+	stream_close(fr);
+}
+
+static struct reader map_reader =
+{
+	default_init,
+	map_close,
+	map_fullread,
+	generic_head_read,
+	generic_head_shift,
+	map_skip_bytes,
+	generic_read_frame_body,
+	map_back_bytes,
+	stream_seek_frame,
+	generic_tell,
+	map_rewind,
+	NULL,
+	map_frame_body
+};
+#endif
+
+void open_map(mpg123_handle *fr)
+{
+#ifdef HAVE_MMAP
+	struct stat st;
+	void *data;
+
+	/* Only for plain files we read ourselves, without timeout. A file that grows
+	   during playback does not, either, only what is there now is mapped. */
+	if(  fr->rd != &readers[READER_STREAM] || fr->rdat.flags & (READER_HANDLEIO|READER_NONBLOCK)
+	  || fr->rdat.r_read != NULL || fr->rdat.r_lseek != NULL )
+	return;
+	if(  fstat(fr->rdat.filept, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0
+	  || (off_t)(size_t)st.st_size != st.st_size )
+	return;
+
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fr->rdat.filept, 0);
+	if(data == MAP_FAILED)
+	{
+		if(NOQUIET) error1("mmap of input file failed: %s", strerror(errno));
+		return;
+	}
+#ifdef MADV_SEQUENTIAL
+	madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+	debug1("mmap reader for %"OFF_P" bytes", (off_p)st.st_size);
+	fr->rdat.mapdata = data;
+	fr->rdat.mapsize = (size_t)st.st_size;
+	fr->rd = &map_reader;
+#endif
+}
+
+/*
+	The io_uring reader: a window of URING_BLOCK sized reads that are kept in flight
+	ahead of the read position, for storage where the latency of each read() hurts.
+	Slot first covers the window start, the following ones (modulo count) the next blocks.
+	Seeks out of the window cancel the reads and start a new window at the target.
+*/
+
+#ifdef URING_READER
+#define URING_BLOCK 65536
+#define URING_MAX   256
+#define URING_CANCEL (~(__u64)0)
+
+enum uring_state { URING_IDLE = 0, URING_PENDING, URING_DONE };
+
+struct uring_slot
+{
+	unsigned char *data;
+	off_t off;
+	ssize_t fill; /* bytes read or negative error code */
+	enum uring_state state;
+	int retried; /* Short block at the end was read again. */
+};
+
+struct uring
+{
+	int fd;
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	struct io_uring_sqe *sqes;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len, sqe_len;
+	struct uring_slot *slot;
+	unsigned char *mem;
+	unsigned int count;
+	unsigned int first;
+	off_t start; /* file offset of slot first */
+};
+
+static int uring_enter(struct uring *u, unsigned int submit, unsigned int wait)
+{
+	int ret;
+	do ret = syscall(__NR_io_uring_enter, u->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	while(ret < 0 && errno == EINTR);
+	return ret;
+}
+
+/* Queue a request, the kernel only sees it with the next uring_flush() or uring_wait(). */
+static void uring_push(struct uring *u, int fd, __u8 opcode, __u64 addr, __u32 len, off_t off, __u64 data)
+{
+	unsigned int tail = *u->sq_tail;
+	unsigned int idx = tail & *u->sq_mask;
+	struct io_uring_sqe *sqe = &u->sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = addr;
+	sqe->len = len;
+	sqe->off = (__u64)off;
+	sqe->user_data = data;
+	u->sq_array[idx] = idx;
+	__atomic_store_n(u->sq_tail, tail+1, __ATOMIC_RELEASE);
+}
+
+/* Requests queued but not yet taken by the kernel. */
+static unsigned int uring_queued(struct uring *u)
+{
+	return *u->sq_tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/* Hand all queued requests to the kernel in one go. */
+static int uring_flush(struct uring *u)
+{
+	unsigned int queued = uring_queued(u);
+	return (queued && uring_enter(u, queued, 0) < 0) ? -1 : 0;
+}
+
+static void uring_submit(mpg123_handle *fr, unsigned int s, off_t off)
+{
+	struct uring *u = fr->rdat.uring;
+	u->slot[s].off = off;
+	u->slot[s].fill = 0;
+	u->slot[s].state = URING_PENDING;
+	u->slot[s].retried = 0;
+	uring_push( u, fr->rdat.filept, IORING_OP_READ
+	,	(__u64)(unsigned long)u->slot[s].data, URING_BLOCK, off, s );
+}
+
+/* Collect all completions there are. */
+static void uring_reap(struct uring *u)
+{
+	unsigned int head = *u->cq_head;
+	while(head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE))
+	{
+		struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+		if(cqe->user_data < u->count)
+		{
+			u->slot[cqe->user_data].fill  = cqe->res;
+			u->slot[cqe->user_data].state = URING_DONE;
+		}
+		++head;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* Wait for slot s, submitting what is still queued on the way. */
+static int uring_wait(struct uring *u, unsigned int s)
+{
+	uring_reap(u);
+	while(u->slot[s].state == URING_PENDING)
+	{
+		/* Busy means completions to reap first, again means try again. */
+		if(  uring_enter(u, uring_queued(u), 1) < 0
+		  && errno != EBUSY && errno != EAGAIN )
+		return -1;
+		uring_reap(u);
+	}
+	return 0;
+}
+
+/*
+	Cancel what is in flight and wait until the kernel is done with all buffers.
+	If that fails, the kernel may still write to them: The ring has to be torn down
+	without touching the buffers again.
+*/
+static int uring_drain(struct uring *u)
+{
+	unsigned int s;
+	uring_reap(u);
+	for(s=0; s<u->count; ++s)
+	if(u->slot[s].state == URING_PENDING)
+	uring_push(u, -1, IORING_OP_ASYNC_CANCEL, s, 0, 0, URING_CANCEL);
+
+	for(s=0; s<u->count; ++s)
+	{
+		if(uring_wait(u, s)) return -1;
+		u->slot[s].state = URING_IDLE;
+	}
+	return 0;
+}
+
+/* New window at the block containing pos. */
+static int uring_restart(mpg123_handle *fr, off_t pos)
+{
+	struct uring *u = fr->rdat.uring;
+	unsigned int s;
+	debug1("uring window restart at %"OFF_P, (off_p)pos);
+	if(uring_drain(u)) return -1;
+	u->first = 0;
+	u->start = pos - pos % URING_BLOCK;
+	for(s=0; s<u->count; ++s)
+	uring_submit(fr, s, u->start + (off_t)s*URING_BLOCK);
+	return uring_flush(u);
+}
+
+/* Move the window start to the block containing the read position, refilling behind. */
+static int uring_advance(mpg123_handle *fr)
+{
+	struct uring *u = fr->rdat.uring;
+	off_t pos = fr->rdat.filepos;
+
+	if(pos < u->start || pos >= u->start + (off_t)u->count*URING_BLOCK)
+	return uring_restart(fr, pos);
+
+	while(pos >= u->start + URING_BLOCK)
+	{
+		/* Skipped blocks may still be in flight. */
+		if(uring_wait(u, u->first)) return -1;
+		uring_submit(fr, u->first, u->start + (off_t)u->count*URING_BLOCK);
+		u->first = (u->first+1) % u->count;
+		u->start += URING_BLOCK;
+	}
+	return uring_flush(u);
+}
+
+static void uring_exit(struct uring *u);
+
+/* Give up on the ring and continue with plain read() from the logical position. */
+static int uring_fallback(mpg123_handle *fr)
+{
+	if(NOQUIET) error1("io_uring failed (%s), falling back to read()", strerror(errno));
+	uring_exit(fr->rdat.uring);
+	fr->rdat.uring = NULL;
+	fr->rd = &readers[READER_STREAM];
+	/* The descriptor itself was not moved by the ring reads. */
+	return stream_lseek(fr, fr->rdat.filepos, SEEK_SET) < 0 ? READER_ERROR : 0;
+}
+
+static ssize_t uring_fullread(mpg123_handle *fr, unsigned char *buf, ssize_t count)
+{
+	struct uring *u = fr->rdat.uring;
+	ssize_t cnt = 0;
+
+	while(cnt < count)
+	{
+		struct uring_slot *slot;
+		ssize_t loff, chunk;
+
+		if(uring_advance(fr))
+		{
+			ssize_t ret;
+			if(uring_fallback(fr)) return READER_ERROR;
+			ret = fr->rd->fullread(fr, buf+cnt, count-cnt);
+			return ret < 0 ? ret : cnt+ret;
+		}
+		slot = &u->slot[u->first];
+		if(uring_wait(u, u->first) || slot->fill < 0)
+		{
+			if(NOQUIET) error1("io_uring read failed: %s", strerror(slot->fill < 0 ? -slot->fill : errno));
+			return READER_ERROR;
+		}
+		loff = (ssize_t)(fr->rdat.filepos - u->start);
+		if(loff >= slot->fill)
+		{
+			/* End of data for now. Read once more in case the file grew. */
+			if(slot->fill == URING_BLOCK || slot->retried) break;
+			uring_submit(fr, u->first, slot->off);
+			slot->retried = 1;
+			continue;
+		}
+		chunk = slot->fill - loff;
+		if(chunk > count-cnt) chunk = count-cnt;
+		memcpy(buf+cnt, slot->data+loff, chunk);
+		fr->rdat.filepos += chunk;
+		cnt += chunk;
+	}
+	return cnt;
+}
+
+static off_t uring_skip_bytes(mpg123_handle *fr, off_t len)
+{
+	struct uring *u = fr->rdat.uring;
+	if(fr->rdat.filepos+len < 0)
+	{
+		fr->err = MPG123_LSEEK_FAILED;
+		return READER_ERROR;
+	}
+	fr->rdat.filepos += len;
+	/* Start reading at a far target right away. */
+	if(  (fr->rdat.filepos < u->start || fr->rdat.filepos >= u->start + (off_t)u->count*URING_BLOCK)
+	  && uring_restart(fr, fr->rdat.filepos) && uring_fallback(fr) )
+	return READER_ERROR;
+	return fr->rdat.filepos;
+}
+
+static int uring_back_bytes(mpg123_handle *fr, off_t bytes)
+{
+	return uring_skip_bytes(fr, -bytes) < 0 ? READER_ERROR : 0;
+}
+
+static void uring_rewind(mpg123_handle *fr)
+{
+	uring_skip_bytes(fr, -fr->rdat.filepos);
+}
+
+static void uring_exit(struct uring *u)
+{
+	/* Rather leak the buffers than free them under reads that may still be running. */
+	if(u->slot != NULL && uring_drain(u))
+	{
+		debug("io_uring not drained, leaking its buffers");
+		u->mem = NULL;
+	}
+	if(u->sqes != NULL) munmap(u->sqes, u->sqe_len);
+	if(u->cq_ptr != NULL && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+	if(u->sq_ptr != NULL) munmap(u->sq_ptr, u->sq_len);
+	if(u->fd >= 0) close(u->fd);
+	free(u->mem);
+	free(u->slot);
+	free(u);
+}
+
+static void uring_close(mpg123_handle *fr)
+{
+	uring_exit(fr->rdat.uring);
+	fr->rdat.uring = NULL;
+	stream_close(fr);
+}
+
+static struct reader uring_reader =
+{
+	default_init,
+	uring_close,
+	uring_fullread,
+	generic_head_read,
+	generic_head_shift,
+	uring_skip_bytes,
+	generic_read_frame_body,
+	uring_back_bytes,
+	stream_seek_frame,
+	generic_tell,
+	uring_rewind,
+	NULL,
+	NULL
+};
+
+static struct uring* uring_new(unsigned int count)
+{
+	struct io_uring_params p;
+	struct uring *u;
+	void *ptr;
+	unsigned int s;
+
+	u = malloc(sizeof(*u));
+	if(u == NULL) return NULL;
+	memset(u, 0, sizeof(*u));
+	memset(&p, 0, sizeof(p));
+	/* Room for a cancel request next to each read. */
+	u->fd = syscall(__NR_io_uring_setup, 2*count, &p);
+	if(u->fd < 0) goto uring_new_bad;
+
+	u->sq_len = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+	u->cq_len = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP && u->cq_len > u->sq_len)
+	u->sq_len = u->cq_len;
+	ptr = mmap( NULL, u->sq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE
+	,	u->fd, IORING_OFF_SQ_RING );
+	if(ptr == MAP_FAILED) goto uring_new_bad;
+	u->sq_ptr = ptr;
+	if(p.features & IORING_FEAT_SINGLE_MMAP) u->cq_ptr = u->sq_ptr;
+	else
+	{
+		ptr = mmap( NULL, u->cq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE
+		,	u->fd, IORING_OFF_CQ_RING );
+		if(ptr == MAP_FAILED) goto uring_new_bad;
+		u->cq_ptr = ptr;
+	}
+	u->sqe_len = p.sq_entries*sizeof(struct io_uring_sqe);
+	ptr = mmap( NULL, u->sqe_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE
+	,	u->fd, IORING_OFF_SQES );
+	if(ptr == MAP_FAILED) goto uring_new_bad;
+	u->sqes = ptr;
+
+	u->sq_head  = (unsigned int*)((char*)u->sq_ptr + p.sq_off.head);
+	u->sq_tail  = (unsigned int*)((char*)u->sq_ptr + p.sq_off.tail);
+	u->sq_mask  = (unsigned int*)((char*)u->sq_ptr + p.sq_off.ring_mask);
+	u->sq_array = (unsigned int*)((char*)u->sq_ptr + p.sq_off.array);
+	u->cq_head  = (unsigned int*)((char*)u->cq_ptr + p.cq_off.head);
+	u->cq_tail  = (unsigned int*)((char*)u->cq_ptr + p.cq_off.tail);
+	u->cq_mask  = (unsigned int*)((char*)u->cq_ptr + p.cq_off.ring_mask);
+	u->cqes     = (struct io_uring_cqe*)((char*)u->cq_ptr + p.cq_off.cqes);
+
+	u->mem  = malloc((size_t)count*URING_BLOCK);
+	u->slot = malloc(count*sizeof(struct uring_slot));
+	if(u->mem == NULL || u->slot == NULL) goto uring_new_bad;
+	u->count = count;
+	for(s=0; s<count; ++s)
+	{
+		u->slot[s].data  = u->mem + (size_t)s*URING_BLOCK;
+		u->slot[s].state = URING_IDLE;
+	}
+	return u;
+
+uring_new_bad:
+	/* Nothing pending, no slots to drain. */
+	free(u->slot);
+	u->slot = NULL;
+	uring_exit(u);
+	return NULL;
+}
+#endif
+
+void open_uring(mpg123_handle *fr)
+{
+#ifdef URING_READER
+	struct uring *u;
+	unsigned int count = fr->p.readahead > URING_MAX ? URING_MAX : (unsigned int)fr->p.readahead;
+
+	if(  count < 1 || fr->rd != &readers[READER_STREAM] || !(fr->rdat.flags & READER_SEEKABLE)
+	  || fr->rdat.flags & (READER_HANDLEIO|READER_NONBLOCK)
+	  || fr->rdat.r_read != NULL || fr->rdat.r_lseek != NULL )
+	return;
+	if((u = uring_new(count)) == NULL)
+	{
+		debug1("no io_uring: %s", strerror(errno));
+		return;
+	}
+	fr->rdat.uring = u;
+	fr->rd = &uring_reader;
+	/* The first block tells if the kernel can do these reads at all. */
+	if(  uring_restart(fr, fr->rdat.filepos)
+	  || uring_wait(u, u->first) || u->slot[u->first].fill < 0 )
+	{
+		debug("io_uring reads failed, falling back to read()");
+		uring_exit(u);
+		fr->rdat.uring = NULL;
+		fr->rd = &readers[READER_STREAM];
+		/* The descriptor itself was not moved. */
+		return;
+	}
+	debug1("io_uring reader with %u blocks in flight", count);
+#endif
+}
+
+/*
+	The reader thread: It calls io_read() to fill a ring buffer ahead of the
+	consumer, which is plain_fullread() and friends via fdread. Only the producer
+	advances head and only the consumer moves tail and keep, so passing data needs no lock.
+	The mutex and condition are just for sleeping on an empty or full ring.
+	Seeks within the buffered data and back to keep (a bit of history behind tail)
+	only move tail, others stop the thread, seek the descriptor and start it again.
+*/
+
+#ifdef READ_THREAD
+#define THREAD_CHUNK 65536
+#define THREAD_MINSIZE 4096
+
+struct readthread
+{
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct reader_data *rdat;
+	unsigned char *ring;
+	size_t size;
+	size_t history; /* consumed bytes kept for seeking back */
+	size_t head;    /* bytes stored in total, by the thread */
+	size_t tail;    /* bytes consumed in total */
+	size_t keep;    /* data from here on must stay, only grows until restart */
+	off_t pos;      /* stream position of tail */
+	int eof;        /* 1 for end of input, -1 for read error, cleared by the consumer */
+	int stop;
+	int waiting;
+	int wake[2];    /* self-pipe to end a wait for input on stop */
+};
+
+#define THREAD_LOAD(x)    __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define THREAD_STORE(x,v) __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+
+/* Wake up the other side if it is sleeping. */
+static void thread_wake(struct readthread *t)
+{
+	if(THREAD_LOAD(t->waiting))
+	{
+		pthread_mutex_lock(&t->lock);
+		pthread_cond_broadcast(&t->cond);
+		pthread_mutex_unlock(&t->lock);
+	}
+}
+
+static size_t thread_space(struct readthread *t)
+{
+	return THREAD_LOAD(t->keep) + t->size - t->head;
+}
+
+/* Consumer moved tail, let the producer have what is behind the history. */
+static void thread_consumed(struct readthread *t, size_t tail)
+{
+	THREAD_STORE(t->tail, tail);
+	if(tail > t->keep + t->history) THREAD_STORE(t->keep, tail - t->history);
+	thread_wake(t);
+}
+
+/*
+	Wait until there is input or the thread shall stop, returning 0 for the latter.
+	A read blocking on a pipe or socket could not be interrupted otherwise.
+	Descriptors that select() cannot take are just read from.
+*/
+static int thread_input(struct readthread *t)
+{
+	fd_set fds;
+	int fd = t->rdat->filept;
+	int ret;
+
+	if(fd < 0 || fd >= FD_SETSIZE) return 1;
+	FD_ZERO(&fds);
+	FD_SET(fd, &fds);
+	FD_SET(t->wake[0], &fds);
+	ret = select((fd > t->wake[0] ? fd : t->wake[0])+1, &fds, NULL, NULL, NULL);
+	if(ret < 0) return errno == EINTR ? 0 : 1;
+	return !FD_ISSET(t->wake[0], &fds);
+}
+
+static void* thread_main(void *arg)
+{
+	struct readthread *t = arg;
+
+	while(!THREAD_LOAD(t->stop))
+	{
+		size_t chunk, off;
+		ssize_t got;
+
+		if(THREAD_LOAD(t->eof) || !thread_space(t))
+		{
+			pthread_mutex_lock(&t->lock);
+			__atomic_add_fetch(&t->waiting, 1, __ATOMIC_SEQ_CST);
+			while(!THREAD_LOAD(t->stop) && (THREAD_LOAD(t->eof) || !thread_space(t)))
+			pthread_cond_wait(&t->cond, &t->lock);
+			__atomic_sub_fetch(&t->waiting, 1, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&t->lock);
+			continue;
+		}
+		off = t->head % t->size;
+		chunk = thread_space(t);
+		if(chunk > t->size - off) chunk = t->size - off;
+		if(chunk > THREAD_CHUNK) chunk = THREAD_CHUNK;
+
+		if(!thread_input(t)) continue;
+		got = io_read(t->rdat, t->ring+off, chunk);
+		if(got < 0 && errno == EINTR) continue;
+
+		if(got > 0) THREAD_STORE(t->head, t->head+got);
+		else THREAD_STORE(t->eof, got < 0 ? -1 : 1);
+		thread_wake(t);
+	}
+	return NULL;
+}
+
+static int thread_start(struct readthread *t)
+{
+	THREAD_STORE(t->stop, 0);
+	return pthread_create(&t->thread, NULL, thread_main, t);
+}
+
+static void thread_stop(struct readthread *t)
+{
+	unsigned char c = 0;
+	ssize_t woke;
+
+	THREAD_STORE(t->stop, 1);
+	pthread_mutex_lock(&t->lock);
+	pthread_cond_broadcast(&t->cond);
+	pthread_mutex_unlock(&t->lock);
+	/* It may sit in select(), waiting for a pipe or socket. */
+	do woke = write(t->wake[1], &c, 1);
+	while(woke < 0 && errno == EINTR);
+	pthread_join(t->thread, NULL);
+	/* Empty the pipe for the next start. */
+	if(woke == 1)
+	while(read(t->wake[0], &c, 1) < 0 && errno == EINTR);
+}
+
+static void thread_free(struct readthread *t)
+{
+	if(t->wake[0] >= 0) close(t->wake[0]);
+	if(t->wake[1] >= 0) close(t->wake[1]);
+	pthread_cond_destroy(&t->cond);
+	pthread_mutex_destroy(&t->lock);
+	free(t->ring);
+	free(t);
+}
+
+/* The fdread for the consumer: Like read(), return what is there, waiting for at least one byte. */
+static ssize_t thread_read(mpg123_handle *fr, void *buf, size_t count)
+{
+	struct readthread *t = fr->rdat.thread;
+	size_t head, off, n, part;
+
+	while((head = THREAD_LOAD(t->head)) == t->tail)
+	{
+		int eof = THREAD_LOAD(t->eof);
+		if(eof)
+		{
+			/* The data before the end might have come in just now. */
+			if(THREAD_LOAD(t->head) != t->tail) continue;
+			/* Report it once, the next read tries again, as read() would. */
+			THREAD_STORE(t->eof, 0);
+			thread_wake(t);
+			return eof < 0 ? -1 : 0;
+		}
+		pthread_mutex_lock(&t->lock);
+		__atomic_add_fetch(&t->waiting, 1, __ATOMIC_SEQ_CST);
+		while(THREAD_LOAD(t->head) == t->tail && !THREAD_LOAD(t->eof))
+		pthread_cond_wait(&t->cond, &t->lock);
+		__atomic_sub_fetch(&t->waiting, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&t->lock);
+	}
+	n = head - t->tail;
+	if(n > count) n = count;
+	off = t->tail % t->size;
+	part = t->size - off;
+	if(part > n) part = n;
+	memcpy(buf, t->ring+off, part);
+	memcpy((unsigned char*)buf+part, t->ring, n-part);
+	t->pos += n;
+	thread_consumed(t, t->tail+n);
+	return (ssize_t)n;
+}
+
+static off_t thread_seek(struct reader_data *rdat, off_t offset, int whence)
+{
+	struct readthread *t = rdat->thread;
+	off_t ret, pos;
+
+	if(whence != SEEK_END)
+	{
+		off_t rel = whence == SEEK_CUR ? offset : offset - t->pos;
+		size_t head = THREAD_LOAD(t->head);
+		if(rel >= 0 ? (size_t)rel <= head - t->tail : (size_t)-rel <= t->tail - t->keep)
+		{
+			t->pos += rel;
+			thread_consumed(t, t->tail+rel);
+			return t->pos;
+		}
+	}
+	if(!(rdat->flags & READER_SEEKABLE)) return -1;
+
+	/* The descriptor is ahead of the consumer, seek from where that one is. */
+	thread_stop(t);
+	if(whence == SEEK_CUR)
+	{
+		offset += t->pos;
+		whence = SEEK_SET;
+	}
+	rdat->thread = NULL;
+	ret = io_seek(rdat, offset, whence);
+	/* The buffered data does not fit the descriptor anymore in any case. After a failed
+	   seek, go back to where the consumer is, or at least learn where the descriptor is. */
+	pos = ret >= 0 ? ret : io_seek(rdat, t->pos, SEEK_SET);
+	if(pos < 0) pos = io_seek(rdat, 0, SEEK_CUR);
+	t->head = t->tail = t->keep = 0;
+	t->eof = 0;
+	t->pos = pos;
+	if(pos < 0 || thread_start(t))
+	{
+		/* Go on without the thread, reading from wherever the descriptor is. */
+		thread_free(t);
+		rdat->fdread = plain_read;
+		return ret;
+	}
+	rdat->thread = t;
+	return ret;
+}
+
+/* Stop the thread for good and go back to direct reading. */
+static void thread_exit(struct reader_data *rdat)
+{
+	struct readthread *t = rdat->thread;
+	if(t == NULL) return;
+
+	thread_stop(t);
+	thread_free(t);
+	rdat->thread = NULL;
+	rdat->fdread = plain_read;
+}
+#endif
+
+void open_thread(mpg123_handle *fr)
+{
+#ifdef READ_THREAD
+	struct readthread *t;
+	off_t pos;
+
+	/* Not for the timeout reader, the feeder or the readers that do their own thing.
+	   Also not for callback I/O: A read blocking in there could not be ended. */
+	if(  fr->rdat.fdread != plain_read || fr->rdat.flags & (READER_NONBLOCK|READER_HANDLEIO)
+	  || !(  fr->rd == &readers[READER_STREAM] || fr->rd == &readers[READER_ICY_STREAM]
+#ifndef NO_FEEDER
+	      || fr->rd == &readers[READER_BUF_STREAM] || fr->rd == &readers[READER_BUF_ICY_STREAM]
+#endif
+	  ) )
+	return;
+
+	t = malloc(sizeof(*t));
+	if(t == NULL) return;
+	memset(t, 0, sizeof(*t));
+	t->size = fr->p.read_thread < THREAD_MINSIZE ? THREAD_MINSIZE : (size_t)fr->p.read_thread;
+	t->history = t->size/4;
+	t->ring = malloc(t->size);
+	if(t->ring == NULL)
+	{
+		free(t);
+		return;
+	}
+	pthread_mutex_init(&t->lock, NULL);
+	pthread_cond_init(&t->cond, NULL);
+	if(pipe(t->wake))
+	{
+		t->wake[0] = t->wake[1] = -1;
+		thread_free(t);
+		return;
+	}
+	t->rdat = &fr->rdat;
+	pos = io_seek(&fr->rdat, 0, SEEK_CUR);
+	t->pos = pos < 0 ? 0 : pos;
+	if(thread_start(t))
+	{
+		if(NOQUIET) error("cannot start reader thread");
+		thread_free(t);
+		return;
+	}
+	fr->rdat.thread = t;
+	fr->rdat.fdread = thread_read;
+	debug1("reader thread with %lu bytes buffer", (unsigned long)t->size);
+#endif
+}
+
+int64_t stream_mtime(mpg123_handle *fr)
+{
+	struct stat st;
+	/* Only for descriptors the library reads from itself, nothing else to ask. */
+	if(  fr->rdat.flags & READER_HANDLEIO || fr->rdat.r_read != NULL
+	  || fr->rdat.r_lseek != NULL || fr->rdat.filelen < 0 )
+	return 0;
+
+	return fstat(fr->rdat.filept, &st) == 0 ? (int64_t)st.st_mtime : 0;
+}
+
 int open_feed(mpg123_handle *fr)
 {
 	debug("feed reader");
@@ -1160,6 +2179,10 @@ static int open_finish(mpg123_handle *fr)
 	}
 
 	if(fr->rd->init(fr) < 0) return -1;
+	/* Now we know if it is a plain seekable stream. */
+	if(fr->p.flags & MPG123_MMAP) open_map(fr);
+	if(fr->p.readahead > 0) open_uring(fr);
+	if(fr->p.read_thread > 0) open_thread(fr);
 
 	return MPG123_OK;
 }
@@ -1210,6 +2233,9 @@ int open_stream_handle(mpg123_handle *fr, void *iohandle)
 /* Wrappers for actual reading/seeking... I'm full of wrappers here. */
 static off_t io_seek(struct reader_data *rdat, off_t offset, int whence)
 {
+#ifdef READ_THREAD
+	if(rdat->thread != NULL) return thread_seek(rdat, offset, whence);
+#endif
 	if(rdat->flags & READER_HANDLEIO)
 	{
 		if(rdat->r_lseek_handle != NULL)
@@ -0,0 +1,330 @@
+/*
+	resample.c: windowed-sinc resampling for NtoM rate conversion
+
+	copyright 1995-2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The ntom synth computes only the synth output sample that is nearest to
+	each output position. That is cheap but aliases badly. With
+	MPG123_RESAMPLE set, the plain 1to1 synth produces floating point samples
+	and those go through a polyphase FIR filter (Kaiser-windowed sinc) to the
+	same output positions.
+
+	The positions are taken from the very same ntom_val/ntom_step phase
+	accumulator as in the ntom synth, so each frame yields exactly
+	ntom_frame_outsamples() samples and all the sample offset computations
+	(ntom_ins2outs(), ntom_frameoff(), seeking, gapless) stay valid. The
+	filter adds a fixed delay of taps/2-1 input samples, which the gapless
+	code accounts for via resample_delay().
+
+	For an output position at fraction d of an input sample before input j,
+	the filter runs over the taps input samples ending at j. Coefficients for
+	d come from RESAMPLE_PHASES precomputed rows, linearly interpolated
+	between neighbours. Each row stores the coefficients followed by the
+	differences to the next row, so one pass of resample_dot() gives both
+	sums needed for the interpolation.
+*/
+
+#include "mpg123lib_intern.h"
+#include "sample.h"
+#include "debug.h"
+
+#ifdef RESAMPLE_SINC
+
+/* Filter length, relative passband edge and Kaiser window beta for each quality. */
+static const struct
+{
+	int taps;
+	double rolloff;
+	double beta;
+} rs_quality[] =
+{
+	 {  0, 0.,   0. } /* MPG123_RESAMPLE_NTOM, not handled here */
+	,{ 16, 0.85, 5. } /* MPG123_RESAMPLE_LOW */
+	,{ 32, 0.90, 7. } /* MPG123_RESAMPLE_MEDIUM */
+	,{ 64, 0.95, 9. } /* MPG123_RESAMPLE_HIGH */
+};
+
+/* Modified Bessel function of the first kind, order 0, for the Kaiser window. */
+static double bessel_i0(double x)
+{
+	double sum  = 1.;
+	double term = 1.;
+	int k;
+	for(k=1; k<64; ++k)
+	{
+		term *= (x/(2*k))*(x/(2*k));
+		sum  += term;
+		if(term < sum*1e-12) break;
+	}
+	return sum;
+}
+
+/* Impulse response at distance x (in input samples) from the output position. */
+static double rs_kernel(double x, double fc, double beta, int half)
+{
+	double t, w;
+	if(x <= -half || x >= half) return 0.;
+	t = x/half;
+	w = bessel_i0(beta*sqrt(1.-t*t))/bessel_i0(beta);
+	if(x == 0.) return fc*w;
+	return fc*w*sin(M_PI*fc*x)/(M_PI*fc*x);
+}
+
+/* Compute the coefficient rows for the current rates and quality. */
+static int rs_make_table(mpg123_handle *fr, long rate_in, long rate_out, int quality)
+{
+	int taps = rs_quality[quality].taps;
+	int half = taps/2;
+	double fc = rs_quality[quality].rolloff;
+	double *row;
+	int p, i;
+
+	if(rate_out < rate_in) fc *= (double)rate_out/rate_in;
+
+	if(fr->rs.table != NULL) free(fr->rs.table);
+	fr->rs.table = malloc(sizeof(real)*2*taps*RESAMPLE_PHASES);
+	row = malloc(sizeof(double)*taps*(RESAMPLE_PHASES+1));
+	if(fr->rs.table == NULL || row == NULL)
+	{
+		if(row != NULL) free(row);
+		if(fr->rs.table != NULL) free(fr->rs.table);
+		fr->rs.table = NULL;
+		fr->rs.taps = 0;
+		fr->err = MPG123_OUT_OF_MEM;
+		return -1;
+	}
+	/* Row p is for d = p/RESAMPLE_PHASES, normalized to unity gain at DC.
+	   Tap i sits at distance i-half+d from the output position. */
+	for(p=0; p<=RESAMPLE_PHASES; ++p)
+	{
+		double *h = row + p*taps;
+		double sum = 0.;
+		double d = (double)p/RESAMPLE_PHASES;
+		for(i=0; i<taps; ++i)
+		{
+			h[i] = rs_kernel(i-half+d, fc, rs_quality[quality].beta, half);
+			sum += h[i];
+		}
+		for(i=0; i<taps; ++i) h[i] /= sum;
+	}
+	for(p=0; p<RESAMPLE_PHASES; ++p)
+	{
+		double *h = row + p*taps;
+		real *t = fr->rs.table + p*2*taps;
+		for(i=0; i<taps; ++i)
+		{
+			t[i]      = DOUBLE_TO_REAL(h[i]);
+			t[taps+i] = DOUBLE_TO_REAL(h[taps+i]-h[i]);
+		}
+	}
+	free(row);
+
+	fr->rs.taps     = taps;
+	fr->rs.quality  = quality;
+	fr->rs.rate_in  = rate_in;
+	fr->rs.rate_out = rate_out;
+	debug4("resampler table for %li -> %li Hz, quality %i, %i taps", rate_in, rate_out, quality, taps);
+	return 0;
+}
+
+int resample_init(mpg123_handle *fr)
+{
+	long rate_in  = frame_freq(fr);
+	long rate_out = fr->af.rate;
+	int quality = (int)fr->p.resample;
+
+	if(  fr->rs.table == NULL || quality != fr->rs.quality
+	  || rate_in != fr->rs.rate_in || rate_out != fr->rs.rate_out )
+	{
+		if(rs_make_table(fr, rate_in, rate_out, quality) != 0) return -1;
+	}
+	else fr->rs.taps = rs_quality[quality].taps;
+
+	memset(fr->rs.hist, 0, sizeof(fr->rs.hist));
+	return 0;
+}
+
+off_t resample_delay(mpg123_handle *fr)
+{
+	if(fr->rs.taps == 0) return 0;
+	/* taps/2-1 input samples, in output samples. */
+	return ((off_t)(fr->rs.taps/2-1)*fr->ntom_step + (NTOM_MUL>>1))/NTOM_MUL;
+}
+
+/*
+	sums[0] = sum of x[i]*coef[i], sums[1] = sum of x[i]*coef[taps+i].
+	The additions are done in the order of the SIMD versions (eight
+	interleaved partial sums, then pairwise), so all decoders agree.
+	taps is a multiple of 8.
+*/
+void resample_dot(const real *x, const real *coef, int taps, real *sums)
+{
+	const real *dh = coef + taps;
+	real a[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	real b[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	int i, k;
+
+	for(i=0; i<taps; i+=8)
+	{
+		for(k=0; k<8; ++k)
+		{
+			a[k] += x[i+k]*coef[i+k];
+			b[k] += x[i+k]*dh[i+k];
+		}
+	}
+	for(k=0; k<4; ++k)
+	{
+		a[k] += a[k+4];
+		b[k] += b[k+4];
+	}
+	sums[0] = (a[0]+a[2]) + (a[1]+a[3]);
+	sums[1] = (b[0]+b[2]) + (b[1]+b[3]);
+}
+
+/* Store n filtered values from fr->rs.out in the output format, duplicating mono to stereo if needed. */
+static int rs_write(mpg123_handle *fr, int n, int channels)
+{
+	unsigned char *samples = fr->buffer.data + fr->buffer.fill;
+	int m2s = (channels == 1 && fr->af.channels == 2);
+	int step = m2s ? 2 : 1;
+	real *out = fr->rs.out;
+	int clip = 0;
+	int i;
+
+	switch(fr->rs.format)
+	{
+#ifndef NO_16BIT
+		case f_16:
+		{
+			short *s = (short*)samples;
+			for(i=0; i<n; ++i, s+=step)
+			{
+				real sum = out[i]*SHORT_SCALE;
+				WRITE_SHORT_SAMPLE(s, sum, clip);
+				if(m2s) s[1] = s[0];
+			}
+			fr->buffer.fill += n*step*sizeof(short);
+		}
+		break;
+#endif
+#ifndef NO_8BIT
+		case f_8:
+		{
+			unsigned char *s = samples;
+			for(i=0; i<n; ++i, s+=step)
+			{
+				real sum = out[i]*SHORT_SCALE;
+				WRITE_8BIT_SAMPLE(s, sum, clip);
+				if(m2s) s[1] = s[0];
+			}
+			fr->buffer.fill += n*step;
+		}
+		break;
+#endif
+#ifndef NO_32BIT
+		case f_32:
+		{
+			int32_t *s = (int32_t*)samples;
+			for(i=0; i<n; ++i, s+=step)
+			{
+				real sum = out[i]*SHORT_SCALE;
+				WRITE_S32_SAMPLE(s, sum, clip);
+				if(m2s) s[1] = s[0];
+			}
+			fr->buffer.fill += n*step*sizeof(int32_t);
+		}
+		break;
+#endif
+		default:
+		{
+			real *s = (real*)samples;
+			for(i=0; i<n; ++i, s+=step)
+			{
+				s[0] = out[i];
+				if(m2s) s[1] = s[0];
+			}
+			fr->buffer.fill += n*step*sizeof(real);
+		}
+	}
+	return clip;
+}
+
+/* Filter the 32 new samples per channel in fr->rs.block (interleaved if stereo). */
+static int rs_block(mpg123_handle *fr, int channels)
+{
+	int taps = fr->rs.taps;
+	unsigned long step = fr->ntom_step;
+	unsigned long ntom = fr->ntom_val[0];
+	real step_inv = (real)1./step;
+	int ch, j, n = 0;
+
+	for(ch=0; ch<channels; ++ch)
+	{
+		real *h = fr->rs.hist[ch] + taps-1;
+		for(j=0; j<SBLIMIT; ++j)
+		h[j] = fr->rs.block[j*channels+ch];
+	}
+
+	for(j=0; j<SBLIMIT; ++j)
+	{
+		ntom += step;
+		while(ntom >= NTOM_MUL)
+		{
+			unsigned long pos;
+			const real *coef;
+			real frac;
+
+			ntom -= NTOM_MUL;
+			/* The output position lies ntom/step input samples before input j. */
+			pos  = ntom*RESAMPLE_PHASES;
+			coef = fr->rs.table + (pos/step)*2*taps;
+			frac = (real)(pos%step)*step_inv;
+			for(ch=0; ch<channels; ++ch)
+			{
+				real sums[2];
+				opt_resample_dot(fr)(fr->rs.hist[ch]+j, coef, taps, sums);
+				fr->rs.out[n++] = sums[0] + frac*sums[1];
+			}
+		}
+	}
+	fr->ntom_val[0] = fr->ntom_val[1] = ntom;
+
+	for(ch=0; ch<channels; ++ch)
+	memmove(fr->rs.hist[ch], fr->rs.hist[ch]+SBLIMIT, sizeof(real)*(taps-1));
+
+	return rs_write(fr, n, channels);
+}
+
+/* Replacements for fr->synth_stereo and fr->synth_mono, running the real synth into fr->rs.block first. */
+int resample_stereo(real *bandPtr_l, real *bandPtr_r, mpg123_handle *fr)
+{
+	int clip;
+	unsigned char *samples = fr->buffer.data;
+	size_t pnt = fr->buffer.fill;
+
+	fr->buffer.data = (unsigned char*) fr->rs.block;
+	fr->buffer.fill = 0;
+	clip = (fr->rs.synth_stereo)(bandPtr_l, bandPtr_r, fr);
+	fr->buffer.data = samples;
+	fr->buffer.fill = pnt;
+
+	return clip + rs_block(fr, 2);
+}
+
+int resample_mono(real *bandPtr, mpg123_handle *fr)
+{
+	int clip;
+	unsigned char *samples = fr->buffer.data;
+	size_t pnt = fr->buffer.fill;
+
+	fr->buffer.data = (unsigned char*) fr->rs.block;
+	fr->buffer.fill = 0;
+	clip = (fr->rs.synth_mono)(bandPtr, fr);
+	fr->buffer.data = samples;
+	fr->buffer.fill = pnt;
+
+	return clip + rs_block(fr, 1);
+}
+
+#endif
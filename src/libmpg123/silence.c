@@ -0,0 +1,129 @@
+/*
+	silence.c: silence from the bitstream, see mpg123_silence() and MPG123_SILENCE_LEVEL
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The layer decoders give a bound on the subband samples of each block (a
+	Layer III granule, a third of a Layer II frame or a whole Layer I frame)
+	before dequantizing anything: for Layer III the largest value the Huffman
+	tables of the used regions can yield with the global gain, for Layer I
+	and II the largest scalefactor of the allocated subbands. A coefficient
+	or subband sample of 1 comes out as a full scale sine, so the bound
+	compares directly with the linear MPG123_SILENCE_LEVEL.
+
+	A block only comes out as zeros when the two before it were silent, too:
+	one for the overlap of the hybrid filter, both for the 16 slots of the
+	synthesis window. From the third block of a run on, silence_block() writes
+	the zeros itself and the decoder just steps over the bits. With the
+	default level, which only lets a bound of 0 pass, that is exactly what the
+	full decoding would have produced. Lower levels cut the quiet rest to
+	digital silence, with the filter state cleared once at the start.
+*/
+
+#include "mpg123lib_intern.h"
+#include "debug.h"
+
+/* The silent block and the two before it. */
+#define SILENCE_RUN 3
+
+void silence_reset(mpg123_handle *fr)
+{
+	fr->sil.run = 0;
+	fr->sil.clear = FALSE;
+	fr->sil.blocks = fr->sil.next = 0;
+	fr->sil.pos = fr->sil.len = 0;
+	fr->sil.span = FALSE;
+	fr->sil.begin = fr->sil.end = 0;
+}
+
+double silence_limit(mpg123_handle *fr)
+{
+	return fr->p.silence_level < 0. ? pow(10., fr->p.silence_level/20.) : 0.;
+}
+
+/* Only the plain synths produce zero bytes from silence and keep no other state. */
+static int sil_zeros(mpg123_handle *fr)
+{
+	if(fr->sp.handler != NULL || fr->synth_stereo == peaks_stereo)
+		return FALSE;
+	/* NtoM keeps its own position, 8 bit formats have other zeros. */
+	if(fr->down_sample == 3 || fr->af.dec_encsize < 2)
+		return FALSE;
+#ifdef RESAMPLE_SINC
+	if(fr->rs.taps)
+		return FALSE;
+#endif
+#ifdef OPT_DITHER
+	if(fr->cpu_opts.type == generic_dither || fr->cpu_opts.type == ifuenf_dither)
+		return FALSE;
+#endif
+#ifdef OPT_I486
+	/* Its own ring positions. */
+	if(fr->cpu_opts.type == ivier)
+		return FALSE;
+#endif
+	return TRUE;
+}
+
+int silence_block(mpg123_handle *fr, double bound, int slots)
+{
+	size_t bytes;
+
+	/* mpg123_silence() starts afresh after decoding. */
+	fr->sil.blocks = fr->sil.next = 0;
+	fr->sil.span = FALSE;
+	if(bound > silence_limit(fr))
+	{
+		fr->sil.run = 0;
+		fr->sil.clear = FALSE;
+		return FALSE;
+	}
+	if(fr->sil.run < SILENCE_RUN)
+		++fr->sil.run;
+	if(fr->sil.run < SILENCE_RUN || !sil_zeros(fr))
+		return FALSE;
+
+	if(!fr->sil.clear)
+	{
+		/* Zeros already with digital silence, but not below some level. */
+		if(fr->rawbuffs != NULL)
+			memset(fr->rawbuffs, 0, fr->rawbuffss);
+		memset(fr->hybrid_block, 0, sizeof(fr->hybrid_block));
+		fr->sil.clear = TRUE;
+	}
+	bytes = (size_t)((32>>fr->down_sample) * slots * fr->af.channels * fr->af.dec_encsize);
+	memset(fr->buffer.data+fr->buffer.fill, 0, bytes);
+	fr->buffer.fill += bytes;
+	/* Each slot of the synth steps the ring back. */
+	fr->bo = (fr->bo - slots) & 0xf;
+	return TRUE;
+}
+
+int silence_frame(mpg123_handle *fr, double *bound)
+{
+	/* The frame's filter state is not there afterwards. */
+	fr->sil.clear = FALSE;
+	switch(fr->lay)
+	{
+#ifndef NO_LAYER1
+		case 1: return silence_layer1(fr, bound);
+#endif
+#ifndef NO_LAYER2
+		case 2: return silence_layer2(fr, bound);
+#endif
+#ifndef NO_LAYER3
+		case 3: return silence_layer3(fr, bound);
+#endif
+	}
+	return 0;
+}
+
+int silence_count(mpg123_handle *fr, double bound)
+{
+	if(bound > silence_limit(fr))
+		fr->sil.run = 0;
+	else if(fr->sil.run < SILENCE_RUN)
+		++fr->sil.run;
+	return fr->sil.run >= SILENCE_RUN;
+}
@@ -89,7 +89,7 @@ int synth_1to1_i586(real *bandPtr, int channel, mpg123_handle *fr, int final)
 
 #ifdef OPT_I586_DITHER
 /* This is defined in assembler. */
-int synth_1to1_i586_asm_dither(real *bandPtr, int channel, unsigned char *out, unsigned char *buffs, int *bo, real *decwin, float *dithernoise);
+int synth_1to1_i586_asm_dither(real *bandPtr, int channel, unsigned char *out, unsigned char *buffs, int *bo, real *decwin, const float *dithernoise);
 /* This is just a hull to use the mpg123 handle. */
 int synth_1to1_i586_dither(real *bandPtr, int channel, mpg123_handle *fr, int final)
 {
@@ -448,6 +448,98 @@ int synth_1to1_stereo_x86_64(real *bandPtr_l,real *bandPtr_r, mpg123_handle *fr)
 #endif
 #endif
 
+#ifdef OPT_AVX512
+/* Assembler routines, always with float window and rounding. */
+int synth_1to1_avx512_asm(real *window, real *b0, short *samples, int bo1);
+int synth_1to1_s_avx512_asm(real *window, real *b0l, real *b0r, short *samples, int bo1);
+void dct64_real_avx(real *out0, real *out1, real *samples);
+/* Hull for C mpg123 API */
+int synth_1to1_avx512(real *bandPtr,int channel, mpg123_handle *fr, int final)
+{
+	short *samples = (short *) (fr->buffer.data+fr->buffer.fill);
+
+	real *b0, **buf;
+	int bo1;
+	int clip;
+#ifndef NO_EQUALIZER
+	if(fr->have_eq_settings) do_equalizer(bandPtr,channel,fr->equalizer);
+#endif
+	if(!channel)
+	{
+		fr->bo--;
+		fr->bo &= 0xf;
+		buf = fr->real_buffs[0];
+	}
+	else
+	{
+		samples++;
+		buf = fr->real_buffs[1];
+	}
+
+	if(fr->bo & 0x1)
+	{
+		b0 = buf[0];
+		bo1 = fr->bo;
+		dct64_real_avx(buf[1]+((fr->bo+1)&0xf),buf[0]+fr->bo,bandPtr);
+	}
+	else
+	{
+		b0 = buf[1];
+		bo1 = fr->bo+1;
+		dct64_real_avx(buf[0]+fr->bo,buf[1]+fr->bo+1,bandPtr);
+	}
+
+	clip = synth_1to1_avx512_asm(fr->decwin, b0, samples, bo1);
+
+	if(final) fr->buffer.fill += 128;
+
+	return clip;
+}
+
+int synth_1to1_stereo_avx512(real *bandPtr_l, real *bandPtr_r, mpg123_handle *fr)
+{
+	short *samples = (short *) (fr->buffer.data+fr->buffer.fill);
+
+	real *b0l, *b0r, **bufl, **bufr;
+	int bo1;
+	int clip;
+#ifndef NO_EQUALIZER
+	if(fr->have_eq_settings)
+	{
+		do_equalizer(bandPtr_l,0,fr->equalizer);
+		do_equalizer(bandPtr_r,1,fr->equalizer);
+	}
+#endif
+	fr->bo--;
+	fr->bo &= 0xf;
+	bufl = fr->real_buffs[0];
+	bufr = fr->real_buffs[1];
+
+	if(fr->bo & 0x1)
+	{
+		b0l = bufl[0];
+		b0r = bufr[0];
+		bo1 = fr->bo;
+		dct64_real_avx(bufl[1]+((fr->bo+1)&0xf),bufl[0]+fr->bo,bandPtr_l);
+		dct64_real_avx(bufr[1]+((fr->bo+1)&0xf),bufr[0]+fr->bo,bandPtr_r);
+	}
+	else
+	{
+		b0l = bufl[1];
+		b0r = bufr[1];
+		bo1 = fr->bo+1;
+		dct64_real_avx(bufl[0]+fr->bo,bufl[1]+fr->bo+1,bandPtr_l);
+		dct64_real_avx(bufr[0]+fr->bo,bufr[1]+fr->bo+1,bandPtr_r);
+	}
+
+	clip = synth_1to1_s_avx512_asm(fr->decwin, b0l, b0r, samples, bo1);
+
+	fr->buffer.fill += 128;
+
+	return clip;
+}
+#endif
+
 #ifdef OPT_AVX
 #ifdef ACCURATE_ROUNDING
 /* Assembler routines. */
@@ -1180,13 +1272,79 @@ int synth_1to1_stereo_neon64(real *bandPtr_l,real *bandPtr_r, mpg123_handle *fr)
 #define SYNTH_NAME       synth_ntom
 #define MONO_NAME        synth_ntom_mono
 #define MONO2STEREO_NAME synth_ntom_m2s
+#define PLAIN_NAME       fr->synths.plain[r_ntom][f_16]
 #include "synth_ntom.h"
 #undef SYNTH_NAME
+#undef PLAIN_NAME
 #undef MONO_NAME
 #undef MONO2STEREO_NAME
 
 #endif
 
+#if !defined(NO_DOWNSAMPLE) || !defined(NO_NTOM)
+/*
+	Part 1e: 2to1, 4to1 and ntom synths of the float SIMD decoders.
+	Optimized dct64 and window sums, the rest is plain C (see synth_window.h).
+*/
+
+#ifdef OPT_X86_64
+#define WINDOW_2TO1_NAME synth_2to1_x86_64
+#define WINDOW_4TO1_NAME synth_4to1_x86_64
+#define WINDOW_NTOM_NAME synth_ntom_x86_64
+#define WINDOW_DCT64     dct64_real_x86_64
+#define WINDOW_ASM       synth_window_x86_64_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_AVX
+#define WINDOW_2TO1_NAME synth_2to1_avx
+#define WINDOW_4TO1_NAME synth_4to1_avx
+#define WINDOW_NTOM_NAME synth_ntom_avx
+#define WINDOW_DCT64     dct64_real_avx
+#define WINDOW_ASM       synth_window_avx_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_NEON
+#define WINDOW_2TO1_NAME synth_2to1_neon
+#define WINDOW_4TO1_NAME synth_4to1_neon
+#define WINDOW_NTOM_NAME synth_ntom_neon
+#define WINDOW_DCT64     dct64_real_neon
+#define WINDOW_ASM       synth_window_neon_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_NEON64
+#define WINDOW_2TO1_NAME synth_2to1_neon64
+#define WINDOW_4TO1_NAME synth_4to1_neon64
+#define WINDOW_NTOM_NAME synth_ntom_neon64
+#define WINDOW_DCT64     dct64_real_neon64
+#define WINDOW_ASM       synth_window_neon64_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#endif
+
 /* Done with short output. */
 #undef SAMPLE_T
 #undef WRITE_SAMPLE
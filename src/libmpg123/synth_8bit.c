@@ -62,7 +62,7 @@
 #ifndef NO_DOWNSAMPLE
 
 /*
-	Part 2b: 2to1 synth. Only generic and i386.
+	Part 2b: 2to1 synth. Generic and i386 here, SIMD in part 2e.
 */
 #define BLOCK 0x20 /* One decoding block is 32 samples. */
 
@@ -91,7 +91,7 @@
 #undef BLOCK
 
 /*
-	Part 2c: 4to1 synth. Only generic and i386.
+	Part 2c: 4to1 synth. Generic and i386 here, SIMD in part 2e.
 */
 #define BLOCK 0x10 /* One decoding block is 16 samples. */
 
@@ -131,12 +131,78 @@
 #define SYNTH_NAME       synth_ntom_8bit
 #define MONO_NAME        synth_ntom_8bit_mono
 #define MONO2STEREO_NAME synth_ntom_8bit_m2s
+#define PLAIN_NAME       fr->synths.plain[r_ntom][f_8]
 #include "synth_ntom.h"
 #undef SYNTH_NAME
+#undef PLAIN_NAME
 #undef MONO_NAME
 #undef MONO2STEREO_NAME
 
 #endif
 
+#if !defined(NO_DOWNSAMPLE) || !defined(NO_NTOM)
+/*
+	Part 2e: 2to1, 4to1 and ntom synths of the float SIMD decoders.
+	Optimized dct64 and window sums, the rest is plain C (see synth_window.h).
+*/
+
+#ifdef OPT_X86_64
+#define WINDOW_2TO1_NAME synth_2to1_8bit_x86_64
+#define WINDOW_4TO1_NAME synth_4to1_8bit_x86_64
+#define WINDOW_NTOM_NAME synth_ntom_8bit_x86_64
+#define WINDOW_DCT64     dct64_real_x86_64
+#define WINDOW_ASM       synth_window_x86_64_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_AVX
+#define WINDOW_2TO1_NAME synth_2to1_8bit_avx
+#define WINDOW_4TO1_NAME synth_4to1_8bit_avx
+#define WINDOW_NTOM_NAME synth_ntom_8bit_avx
+#define WINDOW_DCT64     dct64_real_avx
+#define WINDOW_ASM       synth_window_avx_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_NEON
+#define WINDOW_2TO1_NAME synth_2to1_8bit_neon
+#define WINDOW_4TO1_NAME synth_4to1_8bit_neon
+#define WINDOW_NTOM_NAME synth_ntom_8bit_neon
+#define WINDOW_DCT64     dct64_real_neon
+#define WINDOW_ASM       synth_window_neon_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#ifdef OPT_NEON64
+#define WINDOW_2TO1_NAME synth_2to1_8bit_neon64
+#define WINDOW_4TO1_NAME synth_4to1_8bit_neon64
+#define WINDOW_NTOM_NAME synth_ntom_8bit_neon64
+#define WINDOW_DCT64     dct64_real_neon64
+#define WINDOW_ASM       synth_window_neon64_asm
+#include "synth_window.h"
+#undef WINDOW_2TO1_NAME
+#undef WINDOW_4TO1_NAME
+#undef WINDOW_NTOM_NAME
+#undef WINDOW_DCT64
+#undef WINDOW_ASM
+#endif
+
+#endif
+
 #undef SAMPLE_T
 #undef WRITE_SAMPLE
@@ -0,0 +1,174 @@
+/*
+	synth_window.h: downsampling synth functions on top of an optimized window routine
+
+	copyright 1995-2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+	initially written by Michael Hipp, generalized by Thomas Orgis
+
+	This header is used multiple times to create different variants of these functions.
+	Hint: WINDOW_2TO1_NAME, WINDOW_4TO1_NAME, WINDOW_NTOM_NAME, WINDOW_DCT64, WINDOW_ASM and SAMPLE_T as well as WRITE_SAMPLE do vary.
+
+	The 2to1, 4to1 and ntom synths only differ from the 1to1 one in which of the 32 window sums they use.
+	So the optimized float dct64 and one assembler routine that stores the plain sums of every
+	first, second or fourth output sample (in the table layout of the optimized decoder) serve them all.
+	Scaling and clipping for the output format are left to WRITE_SAMPLE here.
+*/
+
+void WINDOW_DCT64(real *out0, real *out1, real *samples);
+void WINDOW_ASM(real *window, real *b0, real *sums, int bo1, int step);
+
+#ifndef NO_DOWNSAMPLE
+int WINDOW_2TO1_NAME(real *bandPtr, int channel, mpg123_handle *fr, int final)
+{
+	SAMPLE_T *samples = (SAMPLE_T *) (fr->buffer.data + fr->buffer.fill);
+	ALIGNED(16) real sums[16];
+	real *b0, **buf;
+	int clip = 0;
+	int bo1;
+	int j;
+#ifndef NO_EQUALIZER
+	if(fr->have_eq_settings) do_equalizer(bandPtr,channel,fr->equalizer);
+#endif
+	if(!channel)
+	{
+		fr->bo--;
+		fr->bo &= 0xf;
+		buf = fr->real_buffs[0];
+	}
+	else
+	{
+		samples++;
+		buf = fr->real_buffs[1];
+	}
+
+	if(fr->bo & 0x1)
+	{
+		b0 = buf[0];
+		bo1 = fr->bo;
+		WINDOW_DCT64(buf[1]+((fr->bo+1)&0xf),buf[0]+fr->bo,bandPtr);
+	}
+	else
+	{
+		b0 = buf[1];
+		bo1 = fr->bo+1;
+		WINDOW_DCT64(buf[0]+fr->bo,buf[1]+fr->bo+1,bandPtr);
+	}
+
+	WINDOW_ASM(fr->decwin, b0, sums, bo1, 2);
+
+	for(j=0; j<16; ++j, samples+=2)
+	WRITE_SAMPLE(samples, sums[j], clip);
+
+	if(final) fr->buffer.fill += 0x20*sizeof(SAMPLE_T);
+
+	return clip;
+}
+
+int WINDOW_4TO1_NAME(real *bandPtr, int channel, mpg123_handle *fr, int final)
+{
+	SAMPLE_T *samples = (SAMPLE_T *) (fr->buffer.data + fr->buffer.fill);
+	ALIGNED(16) real sums[8];
+	real *b0, **buf;
+	int clip = 0;
+	int bo1;
+	int j;
+#ifndef NO_EQUALIZER
+	if(fr->have_eq_settings) do_equalizer(bandPtr,channel,fr->equalizer);
+#endif
+	if(!channel)
+	{
+		fr->bo--;
+		fr->bo &= 0xf;
+		buf = fr->real_buffs[0];
+	}
+	else
+	{
+		samples++;
+		buf = fr->real_buffs[1];
+	}
+
+	if(fr->bo & 0x1)
+	{
+		b0 = buf[0];
+		bo1 = fr->bo;
+		WINDOW_DCT64(buf[1]+((fr->bo+1)&0xf),buf[0]+fr->bo,bandPtr);
+	}
+	else
+	{
+		b0 = buf[1];
+		bo1 = fr->bo+1;
+		WINDOW_DCT64(buf[0]+fr->bo,buf[1]+fr->bo+1,bandPtr);
+	}
+
+	WINDOW_ASM(fr->decwin, b0, sums, bo1, 4);
+
+	for(j=0; j<8; ++j, samples+=2)
+	WRITE_SAMPLE(samples, sums[j], clip);
+
+	if(final) fr->buffer.fill += 0x10*sizeof(SAMPLE_T);
+
+	return clip;
+}
+#endif
+
+#ifndef NO_NTOM
+/* Computing all 32 sums is cheaper than skipping single ones in the vector loop;
+   the step logic is the same as in synth_ntom.h . */
+int WINDOW_NTOM_NAME(real *bandPtr, int channel, mpg123_handle *fr, int final)
+{
+	SAMPLE_T *samples = (SAMPLE_T *) (fr->buffer.data + fr->buffer.fill);
+	ALIGNED(16) real sums[32];
+	real *b0, **buf;
+	int clip = 0;
+	int bo1;
+	int ntom;
+	int j;
+#ifndef NO_EQUALIZER
+	if(fr->have_eq_settings) do_equalizer(bandPtr,channel,fr->equalizer);
+#endif
+	if(!channel)
+	{
+		fr->bo--;
+		fr->bo &= 0xf;
+		buf = fr->real_buffs[0];
+		ntom = fr->ntom_val[1] = fr->ntom_val[0];
+	}
+	else
+	{
+		samples++;
+		buf = fr->real_buffs[1];
+		ntom = fr->ntom_val[1];
+	}
+
+	if(fr->bo & 0x1)
+	{
+		b0 = buf[0];
+		bo1 = fr->bo;
+		WINDOW_DCT64(buf[1]+((fr->bo+1)&0xf),buf[0]+fr->bo,bandPtr);
+	}
+	else
+	{
+		b0 = buf[1];
+		bo1 = fr->bo+1;
+		WINDOW_DCT64(buf[0]+fr->bo,buf[1]+fr->bo+1,bandPtr);
+	}
+
+	WINDOW_ASM(fr->decwin, b0, sums, bo1, 1);
+
+	for(j=0; j<32; ++j)
+	{
+		ntom += fr->ntom_step;
+		while(ntom >= NTOM_MUL)
+		{
+			WRITE_SAMPLE(samples, sums[j], clip);
+			samples += 2;
+			ntom -= NTOM_MUL;
+		}
+	}
+
+	fr->ntom_val[channel] = ntom;
+	if(final) fr->buffer.fill = ((unsigned char *) samples - fr->buffer.data - (channel ? sizeof(SAMPLE_T) : 0));
+
+	return clip;
+}
+#endif
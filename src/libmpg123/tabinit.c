@@ -249,7 +249,11 @@ void make_decode_tables(mpg123_handle *fr)
 	  || fr->cpu_opts.type == arm
 	  || fr->cpu_opts.type == neon
 	  || fr->cpu_opts.type == neon64
-	  || fr->cpu_opts.type == avx )
+	  || fr->cpu_opts.type == avx
+#ifdef OPT_AVX512
+	  || fr->cpu_opts.type == avx512
+#endif
+	  )
 	{ /* for float SSE / AltiVec / ARM decoder */
 		for(i=512; i<512+32; i++)
 		{
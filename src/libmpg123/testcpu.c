@@ -28,6 +28,8 @@ int main()
 		if(cpu_sse(flags)) printf(" sse");
 		if(cpu_sse2(flags)) printf(" sse2");
 		if(cpu_sse3(flags)) printf(" sse3");
+		if(cpu_avx(flags)) printf(" avx");
+		if(cpu_avx512(flags)) printf(" avx512");
 		printf("\n");
 	}
 	else printf("I guess you have some i486\n");
@@ -0,0 +1,856 @@
+/*
+	mpg123-cut: cut and join MPEG Layer III streams at frame boundaries without decoding
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The inputs are only parsed frame by frame with libmpg123, nothing is decoded.
+	Each frame's main data is taken out of the bit reservoir of its input and laid
+	out again in the output, as early as the 511 (255) bytes of main_data_begin
+	allow. Within one piece this reproduces the original layout. At a joint, a
+	frame that relied on reservoir space that is not there any more gets the
+	next higher bitrate so its data fits (main_data_begin is kept valid, never
+	pointing to data of the other stream). A frame whose data is missing in the
+	input itself is written with zeroed side info, decoding to silence.
+
+	The output starts with a fresh Info/Xing frame carrying the LAME tag. Its
+	encoder delay and padding make the very start and end sample-exact: two
+	granules before the wanted start are included to prime the decoder and then
+	skipped as encoder delay, the end is trimmed by padding. Joints between
+	pieces are at the nearest frame boundary.
+*/
+
+#include "config.h"
+#include "compat.h"
+#include <mpg123.h>
+
+#include "getlopt.h"
+
+/* Samples of delay of a standard decoder, skipped in addition to the encoder delay. */
+#define GAPLESS_DELAY 529
+/* Main data bytes kept from an input, covering the largest main_data_begin. */
+#define HISTORY 512
+/* Output frames waiting for main data of later frames. The reservoir reaches
+   back 511 bytes at most, that is never more than a dozen of the smallest frames. */
+#define PENDING 32
+/* Xing part (up to and including quality) and LAME extension of the Info frame. */
+#define XING_BYTES 120
+#define LAME_BYTES 36
+#define OUTBUF 65536
+
+static struct
+{
+	char *outfile;
+	int samples;
+	int verbose;
+} param =
+{
+	 NULL
+	,FALSE
+	,0
+};
+
+static const char* progname;
+
+static void usage(int err)
+{
+	FILE* o = stdout;
+	if(err)
+	{
+		o = stderr;
+		fprintf(o, "You made some mistake in program usage... let me briefly remind you:\n\n");
+	}
+	fprintf(o, "Cut and join MPEG Layer III streams without decoding using libmpg123\n");
+	fprintf(o, "\tversion %s; written and copyright by the mpg123 project\n", PACKAGE_VERSION);
+	fprintf(o,"\nusage: %s [option(s)] -o output input[@[from][-to]] ...\n", progname);
+	fprintf(o,"\nThe pieces are written one after another. Positions are seconds (also\n");
+	fprintf(o,"as [h:]m:s) into the gapless stream, missing ones mean start or end.\n");
+	fprintf(o,"The start of the first and end of the last piece are sample-exact, the\n");
+	fprintf(o,"joints are cut at the nearest frame boundary.\n");
+	fprintf(o,"\noptions:\n");
+	fprintf(o," -h     --help              give usage help\n");
+	fprintf(o," -o <f> --output <f>        write to file f (needs to be seekable)\n");
+	fprintf(o," -S     --samples           positions are given in samples\n");
+	fprintf(o," -v[*]  --verbose           increase verbosity level\n");
+	exit(err);
+}
+
+static void want_usage(char* bla)
+{
+	usage(0);
+}
+
+static void set_verbose (char *arg)
+{
+    param.verbose++;
+}
+
+static topt opts[] =
+{
+	 {'h', "help", 0, want_usage, 0, 0}
+	,{'o', "output", GLO_ARG|GLO_CHAR, 0, &param.outfile, 0}
+	,{'S', "samples", GLO_INT, 0, &param.samples, TRUE}
+	,{'v', "verbose", 0, set_verbose, 0, 0}
+	,{0, 0, 0, 0, 0, 0}
+};
+
+/* One piece of input as given on the command line. */
+struct segment
+{
+	char *path;
+	double from;
+	double to; /* < 0 for end of stream */
+};
+
+/* The parts of a Layer III header we need. */
+struct frame
+{
+	int lsf;    /* MPEG 2 or 2.5 */
+	int stereo;
+	int crc;    /* bytes of CRC after the header */
+	int ssize;  /* side info bytes */
+	long spf;
+	long rate;
+};
+
+static const int bitrates[2][15] =
+{
+	 { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 }
+	,{ 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160 }
+};
+
+static const long samplerates[3][3] =
+{
+	 { 44100, 48000, 32000 }
+	,{ 22050, 24000, 16000 }
+	,{ 11025, 12000,  8000 }
+};
+
+/* Everything about the output stream. */
+struct out
+{
+	int fd;
+	unsigned char buf[OUTBUF];
+	size_t fill;
+	off_t bytes;   /* file position of buf[0] plus fill */
+	unsigned short music_crc;
+	unsigned long first;  /* header of the first audio frame, 0 before */
+	int info_size;
+	off_t *offsets;  /* file position of each audio frame, for the TOC */
+	size_t frames;
+	size_t offsets_size;
+	int bitrate;     /* bitrate index of all frames, -1 if varying */
+	long delay;
+	long padding;
+	int lame;        /* LAME extension of the first input to take over */
+	unsigned char lame_ext[LAME_BYTES];
+	/* The main data stream, md[0] being at position md_base. */
+	unsigned char *md;
+	size_t md_size;
+	off_t md_base;
+	off_t md_end;    /* end of the main data placed so far */
+	off_t area_end;  /* end of the main data space of all frames so far */
+	long maxback;    /* largest main_data_begin */
+	struct pending
+	{
+		unsigned long header;
+		unsigned char si[32];
+		off_t area;
+		long cap;
+	} pend[PENDING];
+	int npend;
+	long resized;
+	long silenced;
+};
+
+/* What the Info frame of an input tells. */
+struct tag
+{
+	int present;
+	long frames;  /* 0 if unknown */
+	long delay;
+	long padding;
+	int lame;
+	unsigned char lame_ext[LAME_BYTES];
+};
+
+static int frame_parse(unsigned long header, struct frame *f)
+{
+	int ver = (header >> 19) & 3;
+	int sfreq = (header >> 10) & 3;
+	if( (header & 0xffe00000UL) != 0xffe00000UL || ver == 1
+	||  ((header >> 17) & 3) != 1 || ((header >> 12) & 0xf) == 0
+	||  ((header >> 12) & 0xf) == 15 || sfreq == 3 )
+		return -1;
+	f->lsf = ver != 3;
+	f->stereo = ((header >> 6) & 3) == 3 ? 1 : 2;
+	f->crc = (header & 0x10000UL) ? 0 : 2;
+	f->ssize = f->lsf
+	?	(f->stereo == 1 ? 9 : 17)
+	:	(f->stereo == 1 ? 17 : 32);
+	f->spf = f->lsf ? 576 : 1152;
+	f->rate = samplerates[ver == 3 ? 0 : (ver == 2 ? 1 : 2)][sfreq];
+	return 0;
+}
+
+static long frame_size(unsigned long header, const struct frame *f)
+{
+	return (f->lsf ? 72000L : 144000L)
+	*	bitrates[f->lsf][(header >> 12) & 0xf] / f->rate
+	+	((header >> 9) & 1);
+}
+
+static unsigned long get_bits(const unsigned char *buf, long pos, int n)
+{
+	unsigned long val = 0;
+	for(; n > 0; --n, ++pos)
+		val = (val << 1) | ((buf[pos>>3] >> (7-(pos&7))) & 1);
+	return val;
+}
+
+static void put_bits(unsigned char *buf, long pos, int n, unsigned long val)
+{
+	for(; n > 0; --n, ++pos)
+	{
+		int bit = (val >> (n-1)) & 1;
+		buf[pos>>3] = (buf[pos>>3] & ~(0x80 >> (pos&7))) | (bit << (7-(pos&7)));
+	}
+}
+
+static long main_data_begin(const unsigned char *si, const struct frame *f)
+{
+	return get_bits(si, 0, f->lsf ? 8 : 9);
+}
+
+/* Sum of part2_3_length over all granules and channels. */
+static long main_data_bits(const unsigned char *si, const struct frame *f)
+{
+	long pos = f->lsf
+	?	8 + (f->stereo == 1 ? 1 : 2)
+	:	9 + (f->stereo == 1 ? 5 : 3) + 4*f->stereo;
+	int blocks = f->stereo * (f->lsf ? 1 : 2);
+	long bits = 0;
+	for(; blocks > 0; --blocks, pos += f->lsf ? 63 : 59)
+		bits += get_bits(si, pos, 12);
+	return bits;
+}
+
+/* The CRC of a protected frame, over the last two header bytes and the side info. */
+static unsigned int frame_crc(unsigned long header, const unsigned char *si, int ssize)
+{
+	unsigned int crc = 0xffff;
+	unsigned char data[34];
+	int i, j;
+	data[0] = (header >> 8) & 0xff;
+	data[1] = header & 0xff;
+	memcpy(data+2, si, ssize);
+	for(i=0; i<ssize+2; ++i)
+	for(j=7; j>=0; --j)
+	{
+		int bit = ((crc >> 15) ^ (data[i] >> j)) & 1;
+		crc = (crc << 1) & 0xffff;
+		if(bit) crc ^= 0x8005;
+	}
+	return crc;
+}
+
+/* The CRC-16 of the LAME tag and the music data (reflected 0x8005). */
+static unsigned short crc_table[256];
+
+static void lame_crc_init(void)
+{
+	unsigned int i;
+	int j;
+	for(i=0; i<256; ++i)
+	{
+		unsigned short crc = i;
+		for(j=0; j<8; ++j)
+			crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+		crc_table[i] = crc;
+	}
+}
+
+static unsigned short lame_crc(unsigned short crc, const unsigned char *data, size_t size)
+{
+	size_t i;
+	for(i=0; i<size; ++i)
+		crc = (crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xff];
+	return crc;
+}
+
+static int out_flush(struct out *o)
+{
+	if(o->fill && unintr_write(o->fd, o->buf, o->fill) != o->fill)
+	{
+		fprintf(stderr, "%s: Cannot write output: %s\n", progname, strerror(errno));
+		return -1;
+	}
+	o->fill = 0;
+	return 0;
+}
+
+static int out_write(struct out *o, const unsigned char *data, size_t size)
+{
+	if(o->fill + size > OUTBUF && out_flush(o)) return -1;
+	memcpy(o->buf+o->fill, data, size);
+	o->fill += size;
+	o->bytes += size;
+	return 0;
+}
+
+/* Write the oldest pending frame, its main data space being complete. */
+static int out_emit(struct out *o)
+{
+	struct pending *p = &o->pend[0];
+	struct frame f;
+	unsigned char head[6];
+	size_t hsize = 4;
+	off_t start = o->bytes;
+
+	frame_parse(p->header, &f);
+	head[0] = (p->header >> 24) & 0xff;
+	head[1] = (p->header >> 16) & 0xff;
+	head[2] = (p->header >> 8)  & 0xff;
+	head[3] =  p->header        & 0xff;
+	if(f.crc)
+	{
+		unsigned int crc = frame_crc(p->header, p->si, f.ssize);
+		head[4] = crc >> 8;
+		head[5] = crc & 0xff;
+		hsize += 2;
+	}
+	if( out_write(o, head, hsize) || out_write(o, p->si, f.ssize)
+	||  out_write(o, o->md + (p->area - o->md_base), p->cap) )
+		return -1;
+	o->music_crc = lame_crc(o->music_crc, head, hsize);
+	o->music_crc = lame_crc(o->music_crc, p->si, f.ssize);
+	o->music_crc = lame_crc(o->music_crc, o->md + (p->area - o->md_base), p->cap);
+
+	if(o->frames == o->offsets_size)
+	{
+		size_t size = o->offsets_size ? 2*o->offsets_size : 1024;
+		off_t *offsets = realloc(o->offsets, size*sizeof(off_t));
+		if(offsets == NULL)
+		{
+			fprintf(stderr, "%s: Out of memory.\n", progname);
+			return -1;
+		}
+		o->offsets = offsets;
+		o->offsets_size = size;
+	}
+	o->offsets[o->frames++] = start;
+
+	--o->npend;
+	memmove(o->pend, o->pend+1, o->npend*sizeof(struct pending));
+	return 0;
+}
+
+/* Write out all frames that cannot receive any more main data, or all of them. */
+static int out_drain(struct out *o, int all)
+{
+	/* Later main data starts after the placed one and not before the reservoir. */
+	off_t done = o->md_end > o->area_end - o->maxback ? o->md_end : o->area_end - o->maxback;
+	off_t base;
+	while(o->npend && (all || o->pend[0].area + o->pend[0].cap <= done))
+		if(out_emit(o)) return -1;
+	/* Forget the main data of written frames, keeping the rest zero. */
+	base = o->npend ? o->pend[0].area : o->area_end;
+	if(base > o->md_base)
+	{
+		size_t keep = (size_t)(o->area_end - base);
+		memmove(o->md, o->md + (base - o->md_base), keep);
+		memset(o->md + keep, 0, o->md_size - keep);
+		o->md_base = base;
+	}
+	return 0;
+}
+
+static void put_long(unsigned char *buf, unsigned long val)
+{
+	buf[0] = (val >> 24) & 0xff;
+	buf[1] = (val >> 16) & 0xff;
+	buf[2] = (val >> 8)  & 0xff;
+	buf[3] =  val        & 0xff;
+}
+
+/* The Info frame: smallest frame like the first one that holds the whole tag. */
+static unsigned long info_header(unsigned long first, int *size)
+{
+	struct frame f;
+	unsigned long header = (first & 0xfffe0ccfUL) | 0x10000UL;
+	int bri;
+	frame_parse(first, &f);
+	for(bri=1; bri<14; ++bri)
+		if(frame_size(header | ((unsigned long)bri << 12), &f)
+		>= 4 + f.ssize + XING_BYTES + LAME_BYTES)
+			break;
+	header |= (unsigned long)bri << 12;
+	*size = (int)frame_size(header, &f);
+	return header;
+}
+
+/* Lay out one frame with the given main data. NULL data means to
+   write the frame with empty side info, decoding to silence. */
+static int out_frame( struct out *o, unsigned long header, const unsigned char *si
+,	const unsigned char *data, long size )
+{
+	struct frame f;
+	struct pending *p;
+	unsigned long orig = header;
+	long cap;
+	off_t pos;
+	int bri;
+
+	frame_parse(header, &f);
+	o->maxback = f.lsf ? 255 : 511;
+	pos = o->md_end > o->area_end - o->maxback ? o->md_end : o->area_end - o->maxback;
+	if(data)
+	{
+		/* Take a bigger frame if there is less reservoir than in the input. */
+		for(bri = (orig >> 12) & 0xf; bri < 15; ++bri)
+		{
+			header = (orig & ~0xf000UL) | ((unsigned long)bri << 12);
+			if(pos + size <= o->area_end + frame_size(header, &f) - 4 - f.crc - f.ssize)
+				break;
+		}
+		if(bri == 15)
+			data = NULL;
+		else if(header != orig)
+			++o->resized;
+	}
+	if(!data)
+	{
+		header = orig;
+		++o->silenced;
+	}
+
+	if(!o->first)
+	{
+		/* Leave room for the Info frame, written at the end. */
+		o->first = header;
+		o->bitrate = (header >> 12) & 0xf;
+		info_header(header, &o->info_size);
+		memset(o->buf, 0, o->info_size);
+		o->fill = o->info_size;
+		o->bytes = o->info_size;
+	}
+	else if(o->bitrate != (int)((header >> 12) & 0xf)) o->bitrate = -1;
+
+	cap = frame_size(header, &f) - 4 - f.crc - f.ssize;
+	if((size_t)(o->area_end + cap - o->md_base) > o->md_size)
+	{
+		size_t need = (size_t)(o->area_end + cap - o->md_base);
+		unsigned char *md = realloc(o->md, need);
+		if(md == NULL)
+		{
+			fprintf(stderr, "%s: Out of memory.\n", progname);
+			return -1;
+		}
+		memset(md + o->md_size, 0, need - o->md_size);
+		o->md = md;
+		o->md_size = need;
+	}
+
+	p = &o->pend[o->npend++];
+	p->header = header;
+	p->area = o->area_end;
+	p->cap = cap;
+	if(data)
+	{
+		memcpy(p->si, si, f.ssize);
+		put_bits(p->si, 0, f.lsf ? 8 : 9, (unsigned long)(o->area_end - pos));
+		memcpy(o->md + (pos - o->md_base), data, size);
+		o->md_end = pos + size;
+	}
+	else memset(p->si, 0, f.ssize);
+	o->area_end += cap;
+	return out_drain(o, FALSE);
+}
+
+/* Write the Info frame in the space left for it at the beginning. */
+static int out_finish(struct out *o)
+{
+	unsigned char info[2048];
+	unsigned char *x, *l;
+	unsigned long header;
+	unsigned int crc;
+	struct frame f;
+	long delay, padding;
+	int i;
+
+	if(out_drain(o, TRUE) || out_flush(o)) return -1;
+	header = info_header(o->first, &o->info_size);
+	frame_parse(header, &f);
+	memset(info, 0, o->info_size);
+	put_long(info, header);
+
+	x = info + 4 + f.ssize;
+	memcpy(x, o->bitrate < 0 ? "Xing" : "Info", 4);
+	put_long(x+4, 0xf); /* frames, bytes, TOC, quality */
+	put_long(x+8, (unsigned long)o->frames);
+	put_long(x+12, (unsigned long)o->bytes);
+	for(i=0; i<100; ++i)
+	{
+		double pos = (double)o->offsets[(size_t)((double)i*o->frames/100)];
+		x[16+i] = (unsigned char)(pos*256/o->bytes > 255 ? 255 : pos*256/o->bytes);
+	}
+
+	l = x + XING_BYTES;
+	if(o->lame)
+	{
+		memcpy(l, o->lame_ext, LAME_BYTES);
+		/* A constant bitrate is not true anymore after resizing frames. */
+		if(o->bitrate < 0 && ((l[9] & 0xf) == 1 || (l[9] & 0xf) == 8))
+			l[9] &= 0xf0;
+		/* Peak and gain values are not valid for the new stream. */
+		memset(l+11, 0, 8);
+		l[25] = 0;
+	}
+	else
+	{
+		memcpy(l, "LAME", 4);
+		l[9] = 0x10 | (o->bitrate < 0 ? 0 : 1);
+	}
+	delay   = o->delay   > 4095 ? 4095 : o->delay;
+	padding = o->padding > 4095 ? 4095 : o->padding;
+	l[21] = (delay >> 4) & 0xff;
+	l[22] = ((delay & 0xf) << 4) | ((padding >> 8) & 0xf);
+	l[23] = padding & 0xff;
+	put_long(l+28, (unsigned long)o->bytes);
+	l[32] = (o->music_crc >> 8) & 0xff;
+	l[33] = o->music_crc & 0xff;
+	crc = lame_crc(0, info, l+34-info);
+	l[34] = (crc >> 8) & 0xff;
+	l[35] = crc & 0xff;
+
+	if( lseek(o->fd, 0, SEEK_SET) != 0
+	||  unintr_write(o->fd, info, o->info_size) != (size_t)o->info_size )
+	{
+		fprintf(stderr, "%s: Cannot write Info frame: %s\n", progname, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static void tag_parse(struct tag *t, const unsigned char *body, size_t bytes, const struct frame *f)
+{
+	size_t pos = f->ssize;
+	unsigned long flags;
+	size_t i;
+
+	memset(t, 0, sizeof(*t));
+	/* Same check as libmpg123: zeros before the tag, apart from a CRC. */
+	if(bytes < pos+8) return;
+	for(i=2; i<pos; ++i) if(body[i]) return;
+	if(memcmp(body+pos, "Xing", 4) && memcmp(body+pos, "Info", 4)) return;
+	t->present = TRUE;
+	flags = get_bits(body+pos+4, 0, 32);
+	pos += 8;
+	if(flags & 0x1)
+	{
+		if(bytes < pos+4) return;
+		t->frames = (long)get_bits(body+pos, 0, 32);
+		pos += 4;
+	}
+	if(flags & 0x2) pos += 4;
+	if(flags & 0x4) pos += 100;
+	if(flags & 0x8) pos += 4;
+	if(bytes < pos+24 || !body[pos]) return;
+	t->lame = TRUE;
+	memcpy(t->lame_ext, body+pos, bytes-pos < LAME_BYTES ? bytes-pos : LAME_BYTES);
+	t->delay = (long)get_bits(body+pos+21, 0, 12);
+	t->padding = (long)get_bits(body+pos+21, 12, 12);
+}
+
+static off_t position(double pos, long rate)
+{
+	return param.samples ? (off_t)pos : (off_t)(pos*rate+0.5);
+}
+
+/* Append one piece of input to the output. */
+static int cut_segment(mpg123_handle *m, struct out *o, struct segment *seg, int last)
+{
+	unsigned char history[HISTORY];
+	unsigned char data[HISTORY+2048];
+	size_t hfill = 0;
+	struct tag tag;
+	int checked = FALSE;
+	long idx = -1;    /* current audio frame, not counting the Info frame */
+	long begin = 0;   /* first frame to take */
+	long end = -1;    /* last frame to take, -1 for all */
+	long taken = -1;  /* last frame taken */
+	off_t rend = -1;  /* end in samples of the decoder output */
+	long spf = 0;
+	int ret;
+
+	if(mpg123_open(m, seg->path) != MPG123_OK)
+	{
+		fprintf(stderr, "%s: Cannot open %s: %s\n", progname, seg->path, mpg123_strerror(m));
+		return -1;
+	}
+	while( (ret = mpg123_framebyframe_next(m)) == MPG123_OK || ret == MPG123_NEW_FORMAT )
+	{
+		unsigned long header;
+		unsigned char *body;
+		size_t bytes;
+		struct frame f;
+		const unsigned char *si, *area;
+		size_t asize;
+
+		if(mpg123_framedata(m, &header, &body, &bytes) != MPG123_OK)
+			continue;
+		if(frame_parse(header, &f) || bytes < (size_t)(f.crc + f.ssize))
+		{
+			fprintf(stderr, "%s: %s is not a Layer III stream with fixed bitrates.\n"
+			,	progname, seg->path);
+			goto cut_segment_error;
+		}
+		if(!checked)
+		{
+			checked = TRUE;
+			tag_parse(&tag, body, bytes, &f);
+			if(tag.present) continue;
+		}
+		if(++idx == 0)
+		{
+			int gapless = tag.present && tag.frames > 0;
+			off_t skip = gapless ? tag.delay + GAPLESS_DELAY : 0;
+			off_t from = position(seg->from, f.rate) + skip;
+			struct frame of;
+
+			if(o->first && (frame_parse(o->first, &of), of.rate != f.rate))
+			{
+				fprintf(stderr, "%s: %s has another sampling rate than the first piece.\n"
+				,	progname, seg->path);
+				goto cut_segment_error;
+			}
+			spf = f.spf;
+			if(gapless)
+			{
+				rend = (off_t)tag.frames*spf - tag.padding + GAPLESS_DELAY;
+				if(rend > (off_t)tag.frames*spf) rend = (off_t)tag.frames*spf;
+			}
+			if(seg->to >= 0)
+			{
+				off_t to = position(seg->to, f.rate) + skip;
+				if(rend < 0 || to < rend) rend = to;
+			}
+			if(!o->first)
+			{
+				/* Start two granules early to have the decoder primed (overlap
+				   and filterbank), skip those as delay. */
+				begin = (long)(from/spf) - (f.lsf ? 2 : 1);
+				if(begin < 0) begin = 0;
+				o->delay = (long)(from - (off_t)begin*spf - GAPLESS_DELAY);
+				if(o->delay < 0)
+				{
+					fprintf(stderr, "%s: Note: Cannot start before the decoder delay, losing %li samples.\n"
+					,	progname, -o->delay);
+					o->delay = 0;
+				}
+				if((o->lame = tag.lame))
+					memcpy(o->lame_ext, tag.lame_ext, LAME_BYTES);
+			}
+			else begin = (long)((from + spf/2)/spf);
+			if(rend >= 0)
+				end = (long)(last ? (rend + spf - 1)/spf : (rend + spf/2)/spf) - 1;
+			if(param.verbose)
+				fprintf(stderr, "%s: frames %li to %li\n", seg->path, begin, end);
+			if(end >= 0 && end < begin)
+				break;
+		}
+
+		si = body + f.crc;
+		area = si + f.ssize;
+		asize = bytes - f.crc - f.ssize;
+		if(idx >= begin)
+		{
+			size_t back = (size_t)main_data_begin(si, &f);
+			size_t size = (size_t)(main_data_bits(si, &f)+7)/8;
+			const unsigned char *d = NULL;
+			/* The main data, if the input has all of it. */
+			if(back <= hfill && size <= back + asize)
+			{
+				if(size <= back)
+					d = history + hfill - back;
+				else
+				{
+					memcpy(data, history + hfill - back, back);
+					memcpy(data + back, area, size - back);
+					d = data;
+				}
+			}
+			if(out_frame(o, header, si, d, (long)size))
+				goto cut_segment_error;
+			taken = idx;
+		}
+		if(asize >= HISTORY)
+		{
+			memcpy(history, area + asize - HISTORY, HISTORY);
+			hfill = HISTORY;
+		}
+		else
+		{
+			if(hfill + asize > HISTORY)
+			{
+				size_t drop = hfill + asize - HISTORY;
+				memmove(history, history + drop, hfill - drop);
+				hfill -= drop;
+			}
+			memcpy(history + hfill, area, asize);
+			hfill += asize;
+		}
+		if(end >= 0 && idx >= end)
+			break;
+	}
+	if(ret != MPG123_OK && ret != MPG123_NEW_FORMAT && ret != MPG123_DONE)
+		fprintf(stderr, "%s: Error reading %s (non-fatal?): %s\n"
+		,	progname, seg->path, mpg123_strerror(m));
+	mpg123_close(m);
+
+	if(taken < 0)
+		fprintf(stderr, "%s: Note: Nothing taken from %s.\n", progname, seg->path);
+	else if(last)
+	{
+		/* Trim the end with padding, the decoder delay applies there, too. */
+		off_t total = (off_t)(taken+1)*spf;
+		if(rend < 0 || rend > total) rend = total;
+		o->padding = (long)(total - rend + GAPLESS_DELAY);
+	}
+	return 0;
+
+cut_segment_error:
+	mpg123_close(m);
+	return -1;
+}
+
+/* file[@[from][-to]], positions in seconds, [h:]m:s or samples */
+static int parse_position(const char *s, const char *end, double *val)
+{
+	double v = 0;
+	*val = -1;
+	if(s == end) return 0;
+	for(;;)
+	{
+		char *e;
+		double part = strtod(s, &e);
+		if(e == s || e > end || part < 0) return -1;
+		v += part;
+		if(e == end) break;
+		if(*e != ':' || param.samples) return -1;
+		v *= 60;
+		s = e+1;
+	}
+	*val = v;
+	return 0;
+}
+
+static int parse_segment(char *arg, struct segment *seg)
+{
+	char *at = strrchr(arg, '@');
+	seg->path = arg;
+	seg->from = 0;
+	seg->to = -1;
+	if(at)
+	{
+		char *end = at + strlen(at);
+		char *dash = strchr(at+1, '-');
+		if( parse_position(at+1, dash ? dash : end, &seg->from)
+		||  (dash && parse_position(dash+1, end, &seg->to)) )
+			return -1;
+		if(seg->from < 0) seg->from = 0;
+		if(seg->to >= 0 && seg->to <= seg->from)
+			return -1;
+		*at = 0;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret = 0;
+	int i, nseg;
+	struct segment *seg;
+	struct out *o;
+	mpg123_handle *m;
+
+	progname = argv[0];
+
+	while ((ret = getlopt(argc, argv, opts)))
+	switch (ret) {
+		case GLO_UNKNOWN:
+			fprintf (stderr, "%s: Unknown option \"%s\".\n", 
+				progname, loptarg);
+			usage(1);
+		case GLO_NOARG:
+			fprintf (stderr, "%s: Missing argument for option \"%s\".\n",
+				progname, loptarg);
+			usage(1);
+	}
+	if(param.outfile == NULL || loptind >= argc)
+		usage(1);
+
+	nseg = argc - loptind;
+	seg = malloc(nseg*sizeof(struct segment));
+	o = calloc(1, sizeof(struct out));
+	if(seg == NULL || o == NULL)
+	{
+		fprintf(stderr, "%s: Out of memory.\n", progname);
+		return 1;
+	}
+	for(i=0; i<nseg; ++i)
+	if(parse_segment(argv[loptind+i], &seg[i]))
+	{
+		fprintf(stderr, "%s: Bad piece specification: %s\n", progname, argv[loptind+i]);
+		usage(1);
+	}
+	lame_crc_init();
+	o->padding = GAPLESS_DELAY;
+	o->fd = compat_open(param.outfile, O_CREAT|O_WRONLY|O_TRUNC);
+	if(o->fd < 0)
+	{
+		fprintf(stderr, "%s: Cannot open %s: %s\n", progname, param.outfile, strerror(errno));
+		return 1;
+	}
+
+	mpg123_init();
+	m = mpg123_new(NULL, &ret);
+	if(m == NULL)
+	{
+		fprintf(stderr, "Cannot create handle: %s", mpg123_plain_strerror(ret));
+		ret = -1;
+	}
+	else
+	{
+		/* The Info frames are parsed here, libmpg123 shall hand them out. */
+		ret = mpg123_param(m, MPG123_VERBOSE, param.verbose, 0.);
+		if(ret == MPG123_OK)
+			ret = mpg123_param(m, MPG123_ADD_FLAGS, MPG123_IGNORE_INFOFRAME|MPG123_MMAP, 0.);
+		if(ret != MPG123_OK)
+			fprintf(stderr, "Some error occured: %s\n", mpg123_strerror(m));
+		for(i=0; ret == MPG123_OK && i<nseg; ++i)
+			ret = cut_segment(m, o, &seg[i], i == nseg-1);
+		if(ret == MPG123_OK && !o->first)
+		{
+			fprintf(stderr, "%s: Nothing to write.\n", progname);
+			ret = -1;
+		}
+		if(ret == MPG123_OK)
+			ret = out_finish(o);
+		if(ret == MPG123_OK && o->silenced)
+			fprintf(stderr, "%s: Note: %li frames without usable main data written as silence.\n"
+			,	progname, o->silenced);
+		if(ret == MPG123_OK && param.verbose)
+			fprintf(stderr, "%"SIZE_P" frames, %li enlarged, delay %li, padding %li\n"
+			,	(size_p)o->frames, o->resized, o->delay, o->padding);
+		mpg123_delete(m);
+	}
+	mpg123_exit();
+
+	compat_close(o->fd);
+	free(o->md);
+	free(o->offsets);
+	free(o);
+	free(seg);
+	return ret == MPG123_OK ? 0 : 1;
+}
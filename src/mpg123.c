@@ -116,6 +116,11 @@ struct parameter param = {
 	,0 /* ICY interval */
 	,"mpg123" /* name */
 	,0. /* device buffer */
+	,0 /* resample */
+	,0 /* readahead */
+	,0 /* read_thread */
+	,0 /* band_limit */
+	,0. /* silence_level */
 };
 
 mpg123_handle *mh = NULL;
@@ -522,6 +527,11 @@ topt opts[] = {
 	{0,   "reopen",      GLO_INT,  0, &param.force_reopen, 1},
 	{'g', "gain",        GLO_ARG | GLO_LONG, 0, &param.gain,    0},
 	{'r', "rate",        GLO_ARG | GLO_LONG, 0, &param.force_rate,  0},
+	{0,   "resample",    GLO_ARG | GLO_LONG, 0, &param.resample,  0},
+	{0,   "readahead",   GLO_ARG | GLO_LONG, 0, &param.readahead, 0},
+	{0,   "read-thread", GLO_ARG | GLO_LONG, 0, &param.read_thread, 0},
+	{0,   "band-limit",  GLO_ARG | GLO_LONG, 0, &param.band_limit, 0},
+	{0,   "silence-level", GLO_ARG | GLO_DOUBLE, 0, &param.silence_level, 0},
 	{0,   "8bit",        GLO_INT,  set_frameflag, &frameflag, MPG123_FORCE_8BIT},
 	{0,   "float",       GLO_INT,  set_frameflag, &frameflag, MPG123_FORCE_FLOAT},
 	{0,   "headphones",  0,                  set_output_h, 0,0},
@@ -568,6 +578,7 @@ topt opts[] = {
 	{0, "cpu", GLO_ARG | GLO_CHAR, 0, &param.cpu,  0},
 	{0, "test-cpu",  GLO_INT,  0, &param.test_cpu, TRUE},
 	{0, "list-cpu", GLO_INT,  0, &param.list_cpu , 1},
+	{0, "tree-huffman", GLO_INT, set_frameflag, &frameflag, MPG123_TREE_HUFFMAN},
 #ifdef NETWORK
 	{'u', "auth",        GLO_ARG | GLO_CHAR, 0, &httpauth,   0},
 #endif
@@ -596,6 +607,7 @@ topt opts[] = {
 	{0, "rva-radio",         GLO_INT,  0, &param.rva, 1 },
 	{0, "rva-album",         GLO_INT,  0, &param.rva, 2 },
 	{0, "rva-audiophile",         GLO_INT,  0, &param.rva, 2 },
+	{0, "loudness", GLO_INT, set_frameflag, &frameflag, MPG123_LOUDNESS},
 	{0, "no-icy-meta",      GLO_INT,  0, &param.talk_icy, 0 },
 	{0, "long-tag",         GLO_INT,  0, &param.long_id3, 1 },
 #ifdef FIFO
@@ -615,6 +627,8 @@ topt opts[] = {
 	{0, "utf8", GLO_INT, 0, &param.force_utf8, 1},
 	{0, "fuzzy", GLO_INT,  set_frameflag, &frameflag, MPG123_FUZZY},
 	{0, "index-size", GLO_ARG|GLO_LONG, 0, &param.index_size, 0},
+	{0, "full-index", GLO_INT, set_frameflag, &frameflag, MPG123_FULL_INDEX},
+	{0, "mmap", GLO_INT, set_frameflag, &frameflag, MPG123_MMAP},
 	{0, "no-seekbuffer", GLO_INT, unset_frameflag, &frameflag, MPG123_SEEKBUFFER},
 	{'e', "encoding", GLO_ARG|GLO_CHAR, 0, &param.force_encoding, 0},
 	{0, "preframes", GLO_ARG|GLO_LONG, 0, &param.preframes, 0},
@@ -1001,6 +1015,11 @@ int main(int sys_argc, char ** sys_argv)
 	param.flags |= MPG123_SEEKBUFFER; /* Default on, for HTTP streams. */
 	mpg123_getpar(mp, MPG123_RESYNC_LIMIT, &param.resync_limit, NULL);
 	mpg123_getpar(mp, MPG123_PREFRAMES, &param.preframes, NULL);
+	mpg123_getpar(mp, MPG123_RESAMPLE, &param.resample, NULL);
+	mpg123_getpar(mp, MPG123_READAHEAD, &param.readahead, NULL);
+	mpg123_getpar(mp, MPG123_READ_THREAD, &param.read_thread, NULL);
+	mpg123_getpar(mp, MPG123_BAND_LIMIT, &param.band_limit, NULL);
+	mpg123_getpar(mp, MPG123_SILENCE_LEVEL, NULL, &param.silence_level);
 	/* Also need proper default flags from libout123. */
 	{
 		out123_handle *paro = out123_new();
@@ -1102,6 +1121,16 @@ int main(int sys_argc, char ** sys_argv)
 	    && MPG123_OK == (result = mpg123_par(mp, MPG123_OUTSCALE, param.outscale, 0))
 	    && ++libpar
 	    && MPG123_OK == (result = mpg123_par(mp, MPG123_PREFRAMES, param.preframes, 0))
+	    && ++libpar
+	    && MPG123_OK == (result = mpg123_par(mp, MPG123_RESAMPLE, param.resample, 0))
+	    && ++libpar
+	    && MPG123_OK == (result = mpg123_par(mp, MPG123_READAHEAD, param.readahead, 0))
+	    && ++libpar
+	    && MPG123_OK == (result = mpg123_par(mp, MPG123_READ_THREAD, param.read_thread, 0))
+	    && ++libpar
+	    && MPG123_OK == (result = mpg123_par(mp, MPG123_BAND_LIMIT, param.band_limit, 0))
+	    && ++libpar
+	    && MPG123_OK == (result = mpg123_par(mp, MPG123_SILENCE_LEVEL, 0, param.silence_level))
 			))
 	{
 		error2("Cannot set library parameter %i: %s", libpar, mpg123_plain_strerror(result));
@@ -1398,6 +1427,15 @@ int main(int sys_argc, char ** sys_argv)
 		if(mpg123_getstate(mh, MPG123_FRANKENSTEIN, &frank, NULL) == MPG123_OK && frank)
 		fprintf(stderr, "This was a Frankenstein track.\n");
 
+		if(frameflag & MPG123_LOUDNESS)
+		{
+			long blocks, peak;
+			double lufs, tp;
+			if(  mpg123_getstate(mh, MPG123_LOUDNESS_INTEGRATED, &blocks, &lufs) == MPG123_OK && blocks
+			  && mpg123_getstate(mh, MPG123_LOUDNESS_PEAK, &peak, &tp) == MPG123_OK && peak )
+			fprintf(stderr, "Loudness: %.1f LUFS, true peak %.1f dBTP\n", lufs, 20.*log10(tp));
+		}
+
 		mpg123_position(mh, 0, 0, NULL, NULL, &secs, NULL);
 		fprintf(stderr,"[%d:%02d] Decoding of %s finished.\n", (int)(secs / 60), ((int)secs) % 60, filename);
 	}
@@ -1522,6 +1560,8 @@ static void long_usage(int err)
 	fprintf(o,"        --no-icy-meta      Do not accept ICY meta data\n");
 	fprintf(o," -i     --index            index / scan through the track before playback\n");
 	fprintf(o,"        --index-size <n>   change size of frame index\n");
+	fprintf(o,"        --full-index       also index every single frame (compact, for exact seeks in long streams)\n");
+	fprintf(o,"        --mmap             map input files into memory instead of reading them\n");
 	fprintf(o,"        --preframes  <n>   number of frames to decode in advance after seeking (to keep layer 3 bit reservoir happy)\n");
 	fprintf(o,"        --resync-limit <n> Set number of bytes to search for valid MPEG data; <0 means search whole stream.\n");
 	fprintf(o,"        --streamdump <f>   Dump a copy of input data (as read by libmpg123) to given file.\n");
@@ -1542,6 +1582,7 @@ static void long_usage(int err)
 	fprintf(o,"        --test-cpu         list optimizations possible with cpu and exit\n");
 	fprintf(o,"        --list-cpu         list builtin optimizations and exit\n");
 	#endif
+	fprintf(o,"        --tree-huffman     decode Layer III Huffman codes the old way (same output)\n");
 	#ifdef OPT_3DNOW
 	fprintf(o,"        --test-3dnow       display result of 3DNow! autodetect and exit (obsoleted by --cpu)\n");
 	fprintf(o,"        --force-3dnow      force use of 3DNow! optimized routine (obsoleted by --test-cpu)\n");
@@ -1553,13 +1594,19 @@ static void long_usage(int err)
 	fprintf(o,"        --rva-radio        use RVA2/ReplayGain values for mix/radio mode\n");
 	fprintf(o,"        --rva-album,\n");
 	fprintf(o,"        --rva-audiophile   use RVA2/ReplayGain values for album/audiophile mode\n");
+	fprintf(o,"        --loudness         measure EBU R128 loudness and true peak of each track\n");
 	fprintf(o," -0     --left --single0   play only left channel\n");
 	fprintf(o," -1     --right --single1  play only right channel\n");
 	fprintf(o," -m     --mono --mix       mix stereo to mono\n");
 	fprintf(o,"        --stereo           duplicate mono channel\n");
 	fprintf(o," -r     --rate             force a specific audio output rate\n");
+	fprintf(o,"        --resample <n>     rate conversion quality: 0 nearest sample (fast), 1-3 filtered (low to high)\n");
+	fprintf(o,"        --readahead <n>    keep n reads of 64 KiB in flight for files (io_uring, Linux)\n");
+	fprintf(o,"        --read-thread <b>  read input in a separate thread, buffering b bytes ahead\n");
 	fprintf(o," -2     --2to1             2:1 downsampling\n");
 	fprintf(o," -4     --4to1             4:1 downsampling\n");
+	fprintf(o,"        --band-limit <n>   decode only the lowest n of 32 subbands (fast preview)\n");
+	fprintf(o,"        --silence-level <dB> treat blocks below this level (e.g. -90) as digital silence\n");
   fprintf(o,"        --pitch <value>    set hardware pitch (speedup/down, 0 is neutral; 0.05 is 5%%)\n");
 	fprintf(o,"        --8bit             force 8 bit output\n");
 	fprintf(o,"        --float            force floating point output (internal precision)\n");
@@ -108,6 +108,11 @@ struct parameter
 	long icy_interval;
 	const char* name; /* name for this player instance */
 	double device_buffer; /* output device buffer */
+	long resample; /* MPG123_RESAMPLE quality for rate conversion */
+	long readahead; /* MPG123_READAHEAD reads in flight */
+	long read_thread; /* MPG123_READ_THREAD buffer bytes */
+	long band_limit; /* MPG123_BAND_LIMIT subbands */
+	double silence_level; /* MPG123_SILENCE_LEVEL dBFS */
 };
 
 enum mpg123app_flags
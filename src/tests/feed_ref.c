@@ -0,0 +1,361 @@
+/*
+	feed_ref: mpg123_feed_ref() against mpg123_feed()
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The stream is fed in pieces of several sizes, each piece in its own block
+	of memory that the release callback frees again, so that any access after
+	the hand-back shows up with a memory checker. Small pieces make frames
+	straddle buffers and get copied, a single piece has the Layer I and II
+	bodies decoded in place. The output has to be the same as with copied
+	input, also after seeks, and every piece has to be handed back when a
+	seek back starts the input chain over, and after mpg123_close() or
+	mpg123_delete().
+*/
+
+#include "compat.h"
+#include <mpg123.h>
+#include "debug.h"
+
+#define OUTCHUNK 16384
+
+static long given, released;
+
+static void release_piece(void *handle)
+{
+	++released;
+	free(handle);
+}
+
+struct output
+{
+	unsigned char *data;
+	size_t fill;
+};
+
+static mpg123_handle* open_feed(void)
+{
+	mpg123_handle *mh = mpg123_new(NULL, NULL);
+	if(mh == NULL) return NULL;
+	mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0.);
+	if(mpg123_open_feed(mh) != MPG123_OK)
+	{
+		error1("cannot open feed: %s", mpg123_strerror(mh));
+		mpg123_delete(mh);
+		return NULL;
+	}
+	return mh;
+}
+
+/* One piece, copied or in fresh memory by reference. */
+static int feed_piece(mpg123_handle *mh, const unsigned char *in, size_t n, int ref)
+{
+	unsigned char *piece;
+	if(!ref) return mpg123_feed(mh, in, n);
+	if((piece = malloc(n)) == NULL) return MPG123_ERR;
+	memcpy(piece, in, n);
+	if(mpg123_feed_ref(mh, piece, n, release_piece, piece) != MPG123_OK)
+	{
+		free(piece);
+		return MPG123_ERR;
+	}
+	++given;
+	return MPG123_OK;
+}
+
+static int feed_pieces(mpg123_handle *mh, const unsigned char *in, size_t n, size_t piece, int ref)
+{
+	size_t pos;
+	for(pos=0; pos<n; pos+=piece)
+	if(feed_piece(mh, in+pos, pos+piece > n ? n-pos : piece, ref) != MPG123_OK)
+		return MPG123_ERR;
+	return MPG123_OK;
+}
+
+/* Decode what the fed data gives, up to limit bytes more. */
+static int drain(mpg123_handle *mh, struct output *out, size_t limit)
+{
+	size_t got = 0;
+	int ret;
+	do
+	{
+		size_t done = 0;
+		unsigned char *ndata = realloc(out->data, out->fill+OUTCHUNK);
+		if(ndata == NULL) return MPG123_ERR;
+		out->data = ndata;
+		ret = mpg123_read(mh, out->data+out->fill, OUTCHUNK, &done);
+		out->fill += done;
+		got += done;
+	} while((ret == MPG123_OK || ret == MPG123_NEW_FORMAT) && got < limit);
+	return ret == MPG123_NEED_MORE || ret == MPG123_OK || ret == MPG123_NEW_FORMAT
+	?	MPG123_OK : MPG123_ERR;
+}
+
+/* Feed and decode all of it, piece by piece. */
+static int decode_all(mpg123_handle *mh, const unsigned char *in, size_t n
+,	size_t piece, int ref, struct output *out )
+{
+	size_t pos;
+	for(pos=0; pos<n; pos+=piece)
+	{
+		if(  feed_piece(mh, in+pos, pos+piece > n ? n-pos : piece, ref) != MPG123_OK
+		  || drain(mh, out, (size_t)-1) != MPG123_OK )
+		{
+			error1("decoding failed: %s", mpg123_strerror(mh));
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int same_output(struct output *a, struct output *b)
+{
+	if(a->fill != b->fill || memcmp(a->data, b->data, a->fill))
+	{
+		error2("%lu bytes of output instead of %lu, or different samples"
+		,	(unsigned long)b->fill, (unsigned long)a->fill);
+		return 0;
+	}
+	return 1;
+}
+
+/* Every piece has to be back after closing. */
+static int all_back(const char *when)
+{
+	if(released != given)
+	{
+		error3("%s: %ld of %ld pieces handed back", when, released, given);
+		return 0;
+	}
+	return 1;
+}
+
+static int test_pieces(const unsigned char *in, size_t n, struct output *ref, size_t piece)
+{
+	mpg123_handle *mh;
+	struct output out = { NULL, 0 };
+	int ok = 0;
+
+	given = released = 0;
+	if((mh = open_feed()) == NULL) return -1;
+	if(decode_all(mh, in, n, piece, 1, &out) == 0)
+		ok = same_output(ref, &out);
+	mpg123_delete(mh);
+	ok = all_back("after mpg123_delete()") && ok;
+	free(out.data);
+	return ok ? 0 : -1;
+}
+
+/* With all data in, decode a part and close. */
+static int test_close(const unsigned char *in, size_t n, size_t piece)
+{
+	mpg123_handle *mh;
+	struct output out = { NULL, 0 };
+	int ok = 0;
+
+	given = released = 0;
+	if((mh = open_feed()) == NULL) return -1;
+	if(  feed_pieces(mh, in, n, piece, 1) == MPG123_OK
+	  && drain(mh, &out, 4*OUTCHUNK) == MPG123_OK )
+	{
+		mpg123_close(mh);
+		ok = all_back("after mpg123_close()");
+	}
+	mpg123_delete(mh);
+	free(out.data);
+	return ok ? 0 : -1;
+}
+
+/*
+	Feed half of the stream, decode it and seek. When mpg123_feedseek() does not
+	want the input continued after the fed half, it has started the input chain
+	over and all pieces have to be back. Then feed from the offset it tells and
+	decode the rest.
+*/
+static int seek_run(const unsigned char *in, size_t n, size_t piece, int ref
+,	off_t sample, struct output *out, int *reset )
+{
+	mpg123_handle *mh;
+	off_t inoff;
+	int ok = 0;
+
+	*reset = 0;
+	if((mh = open_feed()) == NULL) return 0;
+	if(decode_all(mh, in, n/2, piece, ref, out) != 0)
+		goto seek_end;
+	if(mpg123_feedseek(mh, sample, SEEK_SET, &inoff) < 0)
+	{
+		error1("feedseek failed: %s", mpg123_strerror(mh));
+		goto seek_end;
+	}
+	if(inoff < 0 || inoff > (off_t)n)
+	{
+		error1("feedseek wants input at %"OFF_P, (off_p)inoff);
+		goto seek_end;
+	}
+	if(inoff != (off_t)(n/2))
+	{
+		*reset = 1;
+		if(ref && !all_back("after mpg123_feedseek()"))
+			goto seek_end;
+	}
+	if(decode_all(mh, in+inoff, n-(size_t)inoff, piece, ref, out) == 0)
+		ok = 1;
+seek_end:
+	mpg123_delete(mh);
+	return ok;
+}
+
+/* Seeking back before the kept input has to start the chain over. */
+static int test_seek(const unsigned char *in, size_t n, off_t sample, size_t piece, int back)
+{
+	struct output a = { NULL, 0 }, b = { NULL, 0 };
+	int ok, reset;
+
+	given = released = 0;
+	ok = seek_run(in, n, piece, 0, sample, &a, &reset) && seek_run(in, n, piece, 1, sample, &b, &reset)
+	&&	same_output(&a, &b);
+	if(ok && back && !reset)
+	{
+		error1("seek back to %"OFF_P" kept the input chain", (off_p)sample);
+		ok = 0;
+	}
+	ok = all_back("after mpg123_delete()") && ok;
+	free(a.data);
+	free(b.data);
+	return ok ? 0 : -1;
+}
+
+/* Fed as one piece, Layer I and II bodies are used where they are. Layer III
+   takes its bit reservoir from the body before, so it is always copied. */
+static int test_inplace(const unsigned char *in, size_t n)
+{
+	mpg123_handle *mh;
+	unsigned char *piece;
+	long frames[2] = { 0, 0 }, inplace[2] = { 0, 0 };
+	int ret, ok = 0;
+
+	given = released = 0;
+	if((mh = open_feed()) == NULL) return -1;
+	if((piece = malloc(n)) == NULL)
+		goto inplace_end;
+	memcpy(piece, in, n);
+	if(mpg123_feed_ref(mh, piece, n, release_piece, piece) != MPG123_OK)
+	{
+		free(piece);
+		goto inplace_end;
+	}
+	++given;
+	while((ret = mpg123_framebyframe_next(mh)) == MPG123_OK || ret == MPG123_NEW_FORMAT)
+	{
+		struct mpg123_frameinfo fi;
+		unsigned char *body, *audio;
+		size_t bytes;
+		if(  mpg123_info(mh, &fi) == MPG123_OK
+		  && mpg123_framedata(mh, NULL, &body, NULL) == MPG123_OK )
+		{
+			int l3 = fi.layer == 3;
+			++frames[l3];
+			if(body >= piece && body < piece+n) ++inplace[l3];
+		}
+		mpg123_framebyframe_decode(mh, NULL, &audio, &bytes);
+	}
+	if(frames[0] + frames[1] == 0)
+		error("no frames");
+	else if(inplace[1] != 0)
+		error2("%ld of %ld Layer III bodies decoded in place", inplace[1], frames[1]);
+	else if(frames[0] != 0 && inplace[0] == 0)
+		error1("none of %ld Layer I/II bodies decoded in place", frames[0]);
+	else
+		ok = 1;
+inplace_end:
+	mpg123_delete(mh);
+	ok = all_back("after mpg123_delete()") && ok;
+	return ok ? 0 : -1;
+}
+
+static unsigned char* slurp(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	unsigned char *data = NULL;
+	size_t got;
+	*size = 0;
+	if(f == NULL) return NULL;
+	do
+	{
+		unsigned char *ndata = realloc(data, *size+OUTCHUNK);
+		if(ndata == NULL) break;
+		data = ndata;
+		got = fread(data+*size, 1, OUTCHUNK, f);
+		*size += got;
+	} while(got == OUTCHUNK);
+	fclose(f);
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	size_t pieces[] = { 1, 7, 100, 1441, 4096, 65536, 0 };
+	size_t i, size;
+	unsigned char *data;
+	struct output ref = { NULL, 0 };
+	mpg123_handle *mh;
+	off_t samples;
+	int channels = 2, encoding = MPG123_ENC_SIGNED_16;
+	int err = 0, errsum = 0;
+
+	if(argc < 2)
+	{
+		printf("Gimme a MPEG file name...\n");
+		return 0;
+	}
+	if((data = slurp(argv[1], &size)) == NULL || size == 0)
+	{
+		error1("cannot read %s", argv[1]);
+		return -1;
+	}
+	pieces[sizeof(pieces)/sizeof(*pieces)-1] = size;
+	mpg123_init();
+	if((mh = open_feed()) == NULL || decode_all(mh, data, size, 4096, 0, &ref) != 0)
+	{
+		if(mh) mpg123_delete(mh);
+		mpg123_exit();
+		free(data);
+		return -1;
+	}
+	mpg123_getformat(mh, NULL, &channels, &encoding);
+	mpg123_delete(mh);
+	samples = (off_t)(ref.fill/(channels*mpg123_encsize(encoding)));
+	for(i=0; i<sizeof(pieces)/sizeof(*pieces); ++i)
+	{
+		fprintf(stderr, "Fed by reference in pieces of %lu bytes: ", (unsigned long)pieces[i]);
+		err = test_pieces(data, size, &ref, pieces[i]);
+		fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+		errsum += err;
+	}
+	fprintf(stderr, "Handed back on mpg123_close(): ");
+	err = test_close(data, size, 1441);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	for(i=3; i<5; ++i)
+	{
+		fprintf(stderr, "Seek beyond the fed data, pieces of %lu bytes: ", (unsigned long)pieces[i]);
+		err = test_seek(data, size, samples/4*3, pieces[i], 0);
+		fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+		errsum += err;
+		fprintf(stderr, "Seek back before the kept data, pieces of %lu bytes: ", (unsigned long)pieces[i]);
+		err = test_seek(data, size, samples/8, pieces[i], 1);
+		fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+		errsum += err;
+	}
+	fprintf(stderr, "Bodies in place with one piece: ");
+	err = test_inplace(data, size);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	mpg123_exit();
+	free(ref.data);
+	free(data);
+	printf("%s\n", errsum ? "FAIL" : "PASS");
+	return errsum;
+}
@@ -0,0 +1,259 @@
+/*
+	index_data: mpg123_index_save() and mpg123_index_load()
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The seek state of a scanned stream is saved and loaded into a fresh handle,
+	which then has to report the same index and length and decode the same
+	samples after seeks. Data with any single byte changed and data for a file
+	that grew by a byte have to be refused with MPG123_BAD_INDEX_DATA.
+*/
+
+#include "compat.h"
+#include <mpg123.h>
+#include "debug.h"
+
+#define SEEKS 6
+#define CHUNK 8192
+
+static mpg123_handle* open_quiet(const char *path)
+{
+	mpg123_handle *mh = mpg123_new(NULL, NULL);
+	if(mh == NULL) return NULL;
+	mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0.);
+	if(path != NULL && mpg123_open(mh, path) != MPG123_OK)
+	{
+		error1("cannot open: %s", mpg123_strerror(mh));
+		mpg123_delete(mh);
+		return NULL;
+	}
+	return mh;
+}
+
+/* The seek state, as a freshly allocated block. */
+static unsigned char* save_index(mpg123_handle *mh, size_t *size)
+{
+	unsigned char *data;
+	*size = 0;
+	if(mpg123_index_save(mh, NULL, size) != MPG123_OK) return NULL;
+	if((data = malloc(*size)) == NULL) return NULL;
+	if(mpg123_index_save(mh, data, size) != MPG123_OK)
+	{
+		error1("saving failed: %s", mpg123_strerror(mh));
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+static int same_index(mpg123_handle *a, mpg123_handle *b)
+{
+	off_t *oa, *ob, sa, sb;
+	size_t fa, fb;
+	if(  mpg123_index(a, &oa, &sa, &fa) != MPG123_OK
+	  || mpg123_index(b, &ob, &sb, &fb) != MPG123_OK )
+	return 0;
+	return sa == sb && fa == fb && !memcmp(oa, ob, fa*sizeof(off_t));
+}
+
+/* Decode a bit at some positions and see that both handles agree. */
+static int same_seeks(mpg123_handle *a, mpg123_handle *b, off_t length)
+{
+	unsigned char ba[CHUNK], bb[CHUNK];
+	off_t pos[SEEKS];
+	int i;
+
+	pos[0] = length/2;
+	pos[1] = 1;
+	pos[2] = length - length/10;
+	pos[3] = length/3;
+	pos[4] = 0;
+	pos[5] = length > 1152 ? length-1152 : 0;
+	for(i=0; i<SEEKS; ++i)
+	{
+		size_t da = 0, db = 0;
+		off_t sa = mpg123_seek(a, pos[i], SEEK_SET);
+		off_t sb = mpg123_seek(b, pos[i], SEEK_SET);
+		if(sa != sb || sa < 0)
+		{
+			error2("seek to %"OFF_P" gave %"OFF_P, (off_p)pos[i], (off_p)sb);
+			return 0;
+		}
+		mpg123_read(a, ba, CHUNK, &da);
+		mpg123_read(b, bb, CHUNK, &db);
+		if(da != db || memcmp(ba, bb, da))
+		{
+			error1("different samples after seek to %"OFF_P, (off_p)pos[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int test_roundtrip(const char *path)
+{
+	mpg123_handle *ref, *mh;
+	unsigned char *data;
+	size_t size;
+	off_t length;
+	int ok = 0;
+
+	if((ref = open_quiet(path)) == NULL) return -1;
+	if(mpg123_scan(ref) != MPG123_OK || (data = save_index(ref, &size)) == NULL)
+	{
+		mpg123_delete(ref);
+		return -1;
+	}
+	length = mpg123_length(ref);
+	if((mh = open_quiet(path)) != NULL)
+	{
+		if(mpg123_index_load(mh, data, size) != MPG123_OK)
+			error1("loading failed: %s", mpg123_strerror(mh));
+		else if(mpg123_length(mh) != length)
+			error2("length %"OFF_P" instead of %"OFF_P, (off_p)mpg123_length(mh), (off_p)length);
+		else if(!same_index(ref, mh))
+			error("frame index differs");
+		else ok = same_seeks(ref, mh, length);
+		mpg123_delete(mh);
+	}
+	mpg123_delete(ref);
+	free(data);
+	return ok ? 0 : -1;
+}
+
+static int test_corruption(const char *path)
+{
+	mpg123_handle *mh;
+	unsigned char *data;
+	size_t size, i;
+	int bad = 0;
+
+	if((mh = open_quiet(path)) == NULL) return -1;
+	if(mpg123_scan(mh) != MPG123_OK || (data = save_index(mh, &size)) == NULL)
+	{
+		mpg123_delete(mh);
+		return -1;
+	}
+	mpg123_close(mh);
+	if(mpg123_open(mh, path) != MPG123_OK) bad = 1;
+	for(i=0; i<size && !bad; ++i)
+	{
+		int ret;
+		data[i] ^= 0x10;
+		ret = mpg123_index_load(mh, data, size);
+		data[i] ^= 0x10;
+		if(ret != MPG123_ERR || mpg123_errcode(mh) != MPG123_BAD_INDEX_DATA)
+		{
+			error1("accepted data with byte %lu changed", (unsigned long)i);
+			bad = 1;
+		}
+	}
+	if(!bad && mpg123_index_load(mh, data, size) != MPG123_OK)
+	{
+		error1("refused the intact data: %s", mpg123_strerror(mh));
+		bad = 1;
+	}
+	mpg123_delete(mh);
+	free(data);
+	return bad ? -1 : 0;
+}
+
+/* Handle I/O on stdio, which leaves the modification time out of the game. */
+static ssize_t file_read(void *handle, void *buf, size_t count)
+{
+	size_t got = fread(buf, 1, count, handle);
+	return got == 0 && ferror((FILE*)handle) ? -1 : (ssize_t)got;
+}
+
+static off_t file_lseek(void *handle, off_t offset, int whence)
+{
+	if(fseek(handle, (long)offset, whence)) return -1;
+	return (off_t)ftell(handle);
+}
+
+static mpg123_handle* open_file(FILE *f)
+{
+	mpg123_handle *mh = open_quiet(NULL);
+	if(mh == NULL) return NULL;
+	if(  mpg123_replace_reader_handle(mh, file_read, file_lseek, NULL) != MPG123_OK
+	  || mpg123_open_handle(mh, f) != MPG123_OK )
+	{
+		mpg123_delete(mh);
+		return NULL;
+	}
+	return mh;
+}
+
+static int test_grown(const char *path)
+{
+	FILE *in, *grown;
+	mpg123_handle *mh = NULL;
+	unsigned char *data = NULL;
+	unsigned char buf[CHUNK];
+	size_t size, got;
+	int ret = -1;
+
+	in = fopen(path, "rb");
+	grown = tmpfile();
+	if(in == NULL || grown == NULL) goto grown_end;
+	while((got = fread(buf, 1, sizeof(buf), in)) > 0)
+	fwrite(buf, 1, got, grown);
+	fputc(0, grown);
+	rewind(in);
+	rewind(grown);
+
+	if((mh = open_file(in)) == NULL) goto grown_end;
+	if(mpg123_scan(mh) != MPG123_OK || (data = save_index(mh, &size)) == NULL)
+		goto grown_end;
+	mpg123_delete(mh);
+	/* The same file again takes it, as control. */
+	rewind(in);
+	if((mh = open_file(in)) == NULL) goto grown_end;
+	if(mpg123_index_load(mh, data, size) != MPG123_OK)
+	{
+		error1("refused data for the same file: %s", mpg123_strerror(mh));
+		goto grown_end;
+	}
+	mpg123_delete(mh);
+	if((mh = open_file(grown)) == NULL) goto grown_end;
+	if(  mpg123_index_load(mh, data, size) != MPG123_ERR
+	  || mpg123_errcode(mh) != MPG123_BAD_INDEX_DATA )
+	{
+		error("accepted data for a file of different size");
+		goto grown_end;
+	}
+	ret = 0;
+grown_end:
+	if(mh) mpg123_delete(mh);
+	free(data);
+	if(grown) fclose(grown);
+	if(in) fclose(in);
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	int err = 0, errsum = 0;
+	if(argc < 2)
+	{
+		printf("Gimme a MPEG file name...\n");
+		return 0;
+	}
+	mpg123_init();
+	fprintf(stderr, "Saved and loaded index, compared after seeks: ");
+	err = test_roundtrip(argv[1]);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	fprintf(stderr, "Refusing damaged data: ");
+	err = test_corruption(argv[1]);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	fprintf(stderr, "Refusing data for a grown file: ");
+	err = test_grown(argv[1]);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	mpg123_exit();
+	printf("%s\n", errsum ? "FAIL" : "PASS");
+	return errsum;
+}
@@ -0,0 +1,151 @@
+/*
+	planar: MPG123_PLANAR output via mpg123_read() against the interleaved one
+
+	copyright 2017 by the mpg123 project - free software under the terms of the LGPL 2.1
+	see COPYING and AUTHORS files in distribution or http://mpg123.org
+
+	The stream is decoded to forced stereo once interleaved, then planar with
+	buffer sizes that do not fit the sample frames, putting the two halves of
+	each piece back together for comparison. A buffer smaller than one sample
+	frame has to give MPG123_BAD_BUFFER instead of endless empty reads.
+*/
+
+#include "compat.h"
+#include <mpg123.h>
+#include "debug.h"
+
+static mpg123_handle* open_stereo(const char *path, int encoding, int planar)
+{
+	mpg123_handle *mh;
+	const long *rates;
+	size_t rate_count, i;
+
+	mh = mpg123_new(NULL, NULL);
+	if(mh == NULL) return NULL;
+	mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0.);
+	if(planar) mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_PLANAR, 0.);
+	mpg123_format_none(mh);
+	mpg123_rates(&rates, &rate_count);
+	for(i=0; i<rate_count; ++i)
+	mpg123_format(mh, rates[i], MPG123_STEREO, encoding);
+	if(mpg123_open(mh, path) != MPG123_OK)
+	{
+		error1("cannot open: %s", mpg123_strerror(mh));
+		mpg123_delete(mh);
+		return NULL;
+	}
+	return mh;
+}
+
+/* The whole stream interleaved, in one piece. */
+static unsigned char* decode_all(const char *path, int encoding, size_t *size)
+{
+	mpg123_handle *mh;
+	unsigned char *data = NULL;
+	size_t fill = 0, done;
+	int ret;
+
+	*size = 0;
+	if((mh = open_stereo(path, encoding, 0)) == NULL) return NULL;
+	do
+	{
+		unsigned char *ndata = realloc(data, fill+16384);
+		if(ndata == NULL) break;
+		data = ndata;
+		ret = mpg123_read(mh, data+fill, 16384, &done);
+		fill += done;
+	} while(ret == MPG123_OK || ret == MPG123_NEW_FORMAT);
+	if(ret != MPG123_DONE) error1("decoding failed: %s", mpg123_strerror(mh));
+	mpg123_delete(mh);
+	*size = fill;
+	return data;
+}
+
+static int test_planar(const char *path, int encoding)
+{
+	static const size_t sizes[] = { 9, 13, 23, 100, 1001, 4097, 16383 };
+	mpg123_handle *mh;
+	unsigned char *ref, *buf;
+	size_t ref_size, pos = 0, n = 0, done;
+	int ss = mpg123_encsize(encoding);
+	int ret, errors = 0;
+
+	if((ref = decode_all(path, encoding, &ref_size)) == NULL) return -1;
+	mh = open_stereo(path, encoding, 1);
+	buf = malloc(16383);
+	if(mh == NULL || buf == NULL)
+	{
+		free(ref);
+		free(buf);
+		if(mh) mpg123_delete(mh);
+		return -1;
+	}
+	/* Know the format, so that the first read already counts. */
+	mpg123_getformat(mh, NULL, NULL, NULL);
+	ret = mpg123_read(mh, buf, 2*ss-1, &done);
+	if(ret != MPG123_ERR || mpg123_errcode(mh) != MPG123_BAD_BUFFER || done != 0)
+	{
+		error2("buffer below a sample frame: %i (%s)", ret, mpg123_plain_strerror(mpg123_errcode(mh)));
+		++errors;
+	}
+	do
+	{
+		size_t i, frames;
+		ret = mpg123_read(mh, buf, sizes[n++ % (sizeof(sizes)/sizeof(*sizes))], &done);
+		if(done % (2*ss))
+		{
+			error1("planar read of %lu bytes is not in sample frames", (unsigned long)done);
+			++errors;
+			break;
+		}
+		frames = done/(2*ss);
+		for(i=0; i<frames && pos+2*ss <= ref_size; ++i, pos += 2*ss)
+		{
+			if(  memcmp(ref+pos,    buf+i*ss,          ss)
+			  || memcmp(ref+pos+ss, buf+(frames+i)*ss, ss) )
+			{
+				error1("planar sample differs at byte %lu", (unsigned long)pos);
+				++errors;
+				break;
+			}
+		}
+		if(errors) break;
+		if(i < frames)
+		{
+			error("more planar than interleaved samples");
+			++errors;
+			break;
+		}
+	} while(ret == MPG123_OK || ret == MPG123_NEW_FORMAT);
+	if(!errors && (ret != MPG123_DONE || pos != ref_size))
+	{
+		error2("planar decoding ended at %lu of %lu bytes", (unsigned long)pos, (unsigned long)ref_size);
+		++errors;
+	}
+	mpg123_delete(mh);
+	free(buf);
+	free(ref);
+	return errors ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int err = 0, errsum = 0;
+	if(argc < 2)
+	{
+		printf("Gimme a MPEG file name...\n");
+		return 0;
+	}
+	mpg123_init();
+	fprintf(stderr, "Planar vs. interleaved, signed 16 bit: ");
+	err = test_planar(argv[1], MPG123_ENC_SIGNED_16);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	fprintf(stderr, "Planar vs. interleaved, 32 bit float: ");
+	err = test_planar(argv[1], MPG123_ENC_FLOAT_32);
+	fprintf(stdout, "%s\n", err == 0 ? "PASS" : "FAIL");
+	errsum += err;
+	mpg123_exit();
+	printf("%s\n", errsum ? "FAIL" : "PASS");
+	return errsum;
+}